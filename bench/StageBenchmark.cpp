@@ -0,0 +1,583 @@
+// Per-stage microbenchmarks for AdvancedFaceSwapper.
+//
+// Runs the individual pipeline steps (preprocess, detect, align, mask, blend,
+// INSwapper pre/post-processing and, with models, embedding and swap) on
+// synthetic frames across resolutions and face counts, and optionally on
+// frames from a recorded image or video. Needs no camera or display.
+
+#include "AdvancedFaceSwapper.hpp"
+#include "AllocationTracker.hpp"
+#include "FaceAnonymizer.hpp"
+#include "Logger.hpp"
+#include "SourceBank.hpp"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct BenchResult {
+    std::string stage;
+    std::string input;      // "synthetic" or "recorded"
+    cv::Size resolution;
+    int faces = 0;
+    int iterations = 0;
+    double meanMs = 0.0;
+    double p50Ms = 0.0;
+    double p95Ms = 0.0;
+    double p99Ms = 0.0;
+    double minMs = 0.0;
+    double maxMs = 0.0;
+    double allocsPerIter = 0.0;     // ALLOC_TRACKING builds only
+    double bytesPerIter = 0.0;
+};
+
+struct BenchOptions {
+    int iterations = 200;
+    int warmup = 20;
+    int recordedFrames = 30;
+    std::vector<cv::Size> resolutions = {{640, 480}, {1280, 720}, {1920, 1080}};
+    std::vector<int> faceCounts = {1, 2, 4, 8};
+    std::string inputPath;
+    std::string sourcePath;
+    std::string detectionModel;
+    std::string arcFaceModel;
+    std::string inSwapperModel;
+    std::string jsonPath;
+    std::string csvPath;
+};
+
+// Friend of AdvancedFaceSwapper: times its private pipeline steps directly
+class StageBenchmark {
+public:
+    explicit StageBenchmark(const BenchOptions& options) : options(options) {}
+
+    bool setup();
+    void run();
+    const std::vector<BenchResult>& getResults() const { return results; }
+
+private:
+    const BenchOptions& options;
+    AdvancedFaceSwapper swapper;
+    bool haveDetector = false;
+    std::vector<BenchResult> results;
+
+    // Runs `body(i)` warmup + iterations times and records the distribution
+    void measure(const std::string& stage, const std::string& input, cv::Size resolution, int faces,
+                 const std::function<void(int)>& body);
+
+    void runFrameStages(const std::string& input, const std::vector<cv::Mat>& frames);
+    void runFaceStages(const std::string& input, const cv::Mat& frame, const cv::Mat& faces);
+    void runModelStages();
+    void runAnonymizerStages();
+};
+
+namespace {
+// Keeps results observable so the compiler cannot drop the work
+const void* volatile benchSink = nullptr;
+void consume(const cv::Mat& result) {
+    benchSink = result.data;
+}
+volatile int benchIndexSink = 0;
+void consume(int result) {
+    benchIndexSink = result;
+}
+
+// Textured frame so CLAHE, resizing and blending do representative work
+cv::Mat makeSyntheticFrame(cv::Size size, int seed) {
+    cv::Mat frame(size, CV_8UC3);
+    cv::RNG rng(seed);
+    rng.fill(frame, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(255));
+    cv::GaussianBlur(frame, frame, cv::Size(0, 0), 3.0);
+    return frame;
+}
+
+// YuNet-style detection rows laid out on a grid, landmarks at typical
+// positions inside each box
+cv::Mat makeSyntheticFaces(cv::Size frameSize, int count) {
+    int columns = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(count))));
+    int rows = (count + columns - 1) / columns;
+    float cellW = static_cast<float>(frameSize.width) / columns;
+    float cellH = static_cast<float>(frameSize.height) / rows;
+    float size = std::min(cellW, cellH) * 0.6f;
+
+    cv::Mat faces(count, 15, CV_32F, cv::Scalar(0));
+    for (int i = 0; i < count; i++) {
+        float x = (i % columns) * cellW + (cellW - size) / 2;
+        float y = (i / columns) * cellH + (cellH - size) / 2;
+        float* row = faces.ptr<float>(i);
+        row[0] = x; row[1] = y; row[2] = size; row[3] = size;
+        row[4] = x + 0.68f * size; row[5] = y + 0.40f * size;    // right eye
+        row[6] = x + 0.32f * size; row[7] = y + 0.40f * size;    // left eye
+        row[8] = x + 0.50f * size; row[9] = y + 0.58f * size;    // nose tip
+        row[10] = x + 0.63f * size; row[11] = y + 0.78f * size;  // right mouth corner
+        row[12] = x + 0.37f * size; row[13] = y + 0.78f * size;  // left mouth corner
+        row[14] = 0.99f;
+    }
+    return faces;
+}
+
+std::string sizeLabel(cv::Size size) {
+    std::ostringstream os;
+    os << size.width << "x" << size.height;
+    return os.str();
+}
+
+bool parseResolutions(const std::string& spec, std::vector<cv::Size>& sizes) {
+    sizes.clear();
+    std::stringstream stream(spec);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        int w = 0, h = 0;
+        char x = 0;
+        std::istringstream parser(item);
+        if (!(parser >> w >> x >> h) || x != 'x' || w <= 0 || h <= 0 || parser.peek() != EOF) {
+            std::cerr << "Error: Invalid resolution: " << item << std::endl;
+            return false;
+        }
+        sizes.push_back(cv::Size(w, h));
+    }
+    return !sizes.empty();
+}
+
+// Whole-string integer of at least `minValue`
+bool parseInteger(const std::string& text, int minValue, int& value) {
+    try {
+        size_t used = 0;
+        value = std::stoi(text, &used);
+        return used == text.size() && value >= minValue;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+bool parseCounts(const std::string& spec, std::vector<int>& counts) {
+    counts.clear();
+    std::stringstream stream(spec);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        int count = 0;
+        if (!parseInteger(item, 1, count)) {
+            std::cerr << "Error: Invalid face count: " << item << std::endl;
+            return false;
+        }
+        counts.push_back(count);
+    }
+    return !counts.empty();
+}
+}
+
+bool StageBenchmark::setup() {
+    if (!options.detectionModel.empty()) {
+        haveDetector = swapper.loadFaceDetectionModel(options.detectionModel);
+    }
+    if (!options.arcFaceModel.empty()) {
+        swapper.loadArcFaceModel(options.arcFaceModel);
+    }
+    if (!options.inSwapperModel.empty()) {
+        swapper.loadInSwapperModel(options.inSwapperModel);
+    }
+    if (!options.sourcePath.empty()) {
+        if (!haveDetector) {
+            std::cerr << "Error: --source needs --detection-model" << std::endl;
+            return false;
+        }
+        if (!swapper.loadSourceFace(options.sourcePath)) {
+            return false;
+        }
+    }
+    // Stabilization history would make iterations depend on each other
+    swapper.setTemporalStabilization(false);
+    return true;
+}
+
+void StageBenchmark::measure(const std::string& stage, const std::string& input, cv::Size resolution, int faces,
+                             const std::function<void(int)>& body) {
+    for (int i = 0; i < options.warmup; i++) {
+        body(i);
+    }
+
+    std::vector<double> samples;
+    samples.reserve(options.iterations);
+    AllocationTracker::Counts before = AllocationTracker::snapshot();
+    for (int i = 0; i < options.iterations; i++) {
+        auto start = std::chrono::steady_clock::now();
+        body(i);
+        samples.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    // The samples vector was reserved up front, so this is the body's own churn
+    AllocationTracker::Counts after = AllocationTracker::snapshot();
+    if (samples.empty()) {
+        return;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&samples](double q) {
+        return samples[static_cast<size_t>(q * (samples.size() - 1) + 0.5)];
+    };
+
+    BenchResult result;
+    result.stage = stage;
+    result.input = input;
+    result.resolution = resolution;
+    result.faces = faces;
+    result.iterations = static_cast<int>(samples.size());
+    double sum = 0.0;
+    for (double s : samples) sum += s;
+    result.meanMs = sum / samples.size();
+    result.p50Ms = percentile(0.50);
+    result.p95Ms = percentile(0.95);
+    result.p99Ms = percentile(0.99);
+    result.minMs = samples.front();
+    result.maxMs = samples.back();
+    result.allocsPerIter = static_cast<double>(after.allocations - before.allocations) / samples.size();
+    result.bytesPerIter = static_cast<double>(after.bytes - before.bytes) / samples.size();
+    results.push_back(result);
+
+    std::cout << "  " << std::left << std::setw(12) << stage << std::setw(11) << input
+              << std::setw(11) << sizeLabel(resolution) << std::right << std::setw(3) << faces
+              << std::fixed << std::setprecision(3)
+              << std::setw(10) << result.meanMs << std::setw(10) << result.p50Ms
+              << std::setw(10) << result.p95Ms << std::setw(10) << result.maxMs;
+    if (AllocationTracker::isAvailable()) {
+        std::cout << std::setprecision(1) << std::setw(10) << result.allocsPerIter
+                  << std::setw(12) << result.bytesPerIter / 1024.0;
+    }
+    std::cout << std::endl;
+}
+
+void StageBenchmark::runFrameStages(const std::string& input, const std::vector<cv::Mat>& frames) {
+    cv::Size size = frames.front().size();
+    size_t n = frames.size();
+
+    measure("preprocess", input, size, 0, [&](int i) {
+        consume(swapper.preprocessFrame(frames[i % n]));
+    });
+
+    if (haveDetector) {
+        measure("detect", input, size, 0, [&](int i) {
+            consume(swapper.detectFaces(frames[i % n]));
+        });
+    }
+
+    if (swapper.isReadyToSwap()) {
+        measure("frame", input, size, 0, [&](int i) {
+            cv::Mat frame = frames[i % n].clone();
+            swapper.detectAndSwap(frame);
+            consume(frame);
+        });
+    }
+}
+
+void StageBenchmark::runFaceStages(const std::string& input, const cv::Mat& frame, const cv::Mat& faces) {
+    int count = faces.rows;
+    std::vector<cv::Rect> rects;
+    std::vector<std::vector<cv::Point2f>> landmarks;
+    std::vector<std::vector<cv::Point2f>> relativeLandmarks;
+    cv::Rect bounds(0, 0, frame.cols, frame.rows);
+    for (int i = 0; i < count; i++) {
+        cv::Rect rect = cv::Rect(cv::Point(static_cast<int>(faces.at<float>(i, 0)), static_cast<int>(faces.at<float>(i, 1))),
+                                 cv::Size(static_cast<int>(faces.at<float>(i, 2)), static_cast<int>(faces.at<float>(i, 3)))) & bounds;
+        if (rect.area() <= 0) continue;
+        std::vector<cv::Point2f> points = FaceSwapEngine::extractLandmarks(faces, i);
+        std::vector<cv::Point2f> relative = points;
+        for (auto& pt : relative) {
+            pt.x -= rect.x;
+            pt.y -= rect.y;
+        }
+        rects.push_back(rect);
+        landmarks.push_back(points);
+        relativeLandmarks.push_back(relative);
+    }
+    if (rects.empty()) {
+        return;
+    }
+    count = static_cast<int>(rects.size());
+
+    measure("align", input, frame.size(), count, [&](int) {
+        for (int f = 0; f < count; f++) {
+            consume(FaceSwapEngine::alignFace(frame, landmarks[f], rects[f], 512));
+        }
+    });
+
+    std::vector<cv::Mat> masks(count);
+    measure("mask", input, frame.size(), count, [&](int) {
+        for (int f = 0; f < count; f++) {
+            masks[f] = swapper.generateFaceMask(rects[f].size(), relativeLandmarks[f]);
+        }
+    });
+
+    // Blend a 128x128 model-sized face into every box, as compositeFaces() does
+    cv::Mat swappedFace = makeSyntheticFrame(cv::Size(128, 128), 7);
+    measure("blend", input, frame.size(), count, [&](int) {
+        cv::Mat result = frame;
+        for (int f = 0; f < count; f++) {
+            result = swapper.blendFace(swappedFace, result, rects[f], masks[f]);
+        }
+        consume(result);
+    });
+}
+
+void StageBenchmark::runModelStages() {
+    // INSwapper pre/post-processing needs no model
+    cv::Mat alignedFace = makeSyntheticFrame(cv::Size(512, 512), 11);
+    cv::Mat embedding(1, 512, CV_32F);
+    cv::randn(embedding, 0.0, 1.0);
+    cv::normalize(embedding, embedding);
+
+    cv::Mat faceBlob;
+    cv::Mat embeddingInput;
+    measure("swap_prep", "synthetic", alignedFace.size(), 1, [&](int) {
+        swapper.prepareSwapInputs(alignedFace, embedding, faceBlob, embeddingInput);
+    });
+
+    int outputShape[] = {1, 3, 128, 128};
+    cv::Mat modelOutput(4, outputShape, CV_32F);
+    cv::randu(modelOutput, -1.0, 1.0);
+    measure("decode", "synthetic", cv::Size(128, 128), 1, [&](int) {
+        consume(swapper.decodeSwapOutput(modelOutput));
+    });
+
+    // Target identity lookup against a source bank; the size column is the
+    // embedding matrix (512 x identities)
+    for (int identities : {16, 256, 1024}) {
+        SourceBank bank;
+        bank.addSource("source", std::make_shared<SourceFace>());
+        cv::Mat targetEmbedding(1, 512, CV_32F);
+        for (int t = 0; t < identities; t++) {
+            cv::randn(targetEmbedding, 0.0, 1.0);
+            bank.addRule("target" + std::to_string(t), targetEmbedding, "source");
+        }
+        std::shared_ptr<const SourceBankSnapshot> snapshot = bank.snapshot();
+        measure("bank_match", "synthetic", cv::Size(512, identities), 1, [&](int) {
+            consume(snapshot->match(embedding));
+        });
+    }
+
+    InferenceContext& context = swapper.inference;
+    if (swapper.engine->hasArcFace()) {
+        measure("embed", "synthetic", alignedFace.size(), 1, [&](int) {
+            consume(FaceSwapEngine::extractFaceEmbedding(alignedFace, context));
+        });
+    }
+    if (swapper.engine->hasInSwapper()) {
+        measure("swap", "synthetic", alignedFace.size(), 1, [&](int) {
+            consume(swapper.swapFaceWithModel(alignedFace, embedding, context));
+        });
+    }
+}
+
+void StageBenchmark::runAnonymizerStages() {
+    // Each anonymize mode on one face at several sizes, at full intensity
+    // where the Gaussian kernel is largest; the size column is the face box
+    cv::Mat frame = makeSyntheticFrame(cv::Size(1280, 720), 13);
+    const std::pair<const char*, AnonymizeMode> modes[] = {
+        {"anon_gauss", AnonymizeMode::Gaussian},
+        {"anon_box", AnonymizeMode::BoxBlur},
+        {"anon_down", AnonymizeMode::Downsample},
+        {"anon_pixel", AnonymizeMode::Pixelate}
+    };
+    for (int faceSize : {64, 128, 256, 512}) {
+        cv::Rect faceRect((frame.cols - faceSize) / 2, (frame.rows - faceSize) / 2, faceSize, faceSize);
+        for (const auto& mode : modes) {
+            FaceAnonymizer anonymizer;
+            anonymizer.setBlurIntensity(1.0f);
+            anonymizer.setMode(mode.second);
+            cv::Mat work = frame.clone();
+            measure(mode.first, "synthetic", faceRect.size(), 1, [&](int) {
+                anonymizer.anonymizeRegion(work, faceRect);
+                consume(work);
+            });
+        }
+    }
+}
+
+void StageBenchmark::run() {
+    std::cout << "  stage       input      size       faces   mean_ms   p50_ms    p95_ms    max_ms";
+    if (AllocationTracker::isAvailable()) {
+        std::cout << "    allocs   KB/iter";
+    }
+    std::cout << std::endl;
+
+    // Synthetic inputs across resolutions and face counts
+    for (const cv::Size& size : options.resolutions) {
+        std::vector<cv::Mat> frames = {makeSyntheticFrame(size, 1), makeSyntheticFrame(size, 2)};
+        runFrameStages("synthetic", frames);
+        for (int count : options.faceCounts) {
+            runFaceStages("synthetic", frames.front(), makeSyntheticFaces(size, count));
+        }
+    }
+
+    runModelStages();
+    runAnonymizerStages();
+
+    // Recorded input: an image or a video file
+    if (!options.inputPath.empty()) {
+        cv::VideoCapture capture(options.inputPath);
+        std::vector<cv::Mat> frames;
+        cv::Mat frame;
+        while (static_cast<int>(frames.size()) < options.recordedFrames && capture.read(frame)) {
+            frames.push_back(frame.clone());
+        }
+        if (frames.empty()) {
+            std::cerr << "Warning: Could not read any frames from: " << options.inputPath << std::endl;
+            return;
+        }
+
+        runFrameStages("recorded", frames);
+        if (haveDetector) {
+            cv::Mat faces = swapper.detectFaces(frames.front());
+            if (faces.rows > 0) {
+                runFaceStages("recorded", frames.front(), faces);
+            } else {
+                std::cerr << "Warning: No faces detected in the recorded input" << std::endl;
+            }
+        }
+    }
+}
+
+namespace {
+bool writeJson(const std::string& path, const std::vector<BenchResult>& results) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not write " << path << std::endl;
+        return false;
+    }
+    out << std::fixed << std::setprecision(4) << "[\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        out << "  {\"stage\":\"" << r.stage << "\",\"input\":\"" << r.input
+            << "\",\"width\":" << r.resolution.width << ",\"height\":" << r.resolution.height
+            << ",\"faces\":" << r.faces << ",\"iterations\":" << r.iterations
+            << ",\"mean_ms\":" << r.meanMs << ",\"p50_ms\":" << r.p50Ms << ",\"p95_ms\":" << r.p95Ms
+            << ",\"p99_ms\":" << r.p99Ms << ",\"min_ms\":" << r.minMs << ",\"max_ms\":" << r.maxMs;
+        if (AllocationTracker::isAvailable()) {
+            out << ",\"allocs_per_iter\":" << r.allocsPerIter << ",\"bytes_per_iter\":" << r.bytesPerIter;
+        }
+        out << "}"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "]\n";
+    return true;
+}
+
+bool writeCsv(const std::string& path, const std::vector<BenchResult>& results) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not write " << path << std::endl;
+        return false;
+    }
+    bool allocations = AllocationTracker::isAvailable();
+    out << "stage,input,width,height,faces,iterations,mean_ms,p50_ms,p95_ms,p99_ms,min_ms,max_ms"
+        << (allocations ? ",allocs_per_iter,bytes_per_iter" : "") << "\n";
+    out << std::fixed << std::setprecision(4);
+    for (const BenchResult& r : results) {
+        out << r.stage << "," << r.input << "," << r.resolution.width << "," << r.resolution.height << ","
+            << r.faces << "," << r.iterations << "," << r.meanMs << "," << r.p50Ms << "," << r.p95Ms << ","
+            << r.p99Ms << "," << r.minMs << "," << r.maxMs;
+        if (allocations) {
+            out << "," << r.allocsPerIter << "," << r.bytesPerIter;
+        }
+        out << "\n";
+    }
+    return true;
+}
+
+void printUsage(const char* programName) {
+    std::cout << "Usage: " << programName << " [options]" << std::endl;
+    std::cout << "\nPer-stage benchmarks of the face swap pipeline (no camera or display needed)" << std::endl;
+    std::cout << "\nOptions:" << std::endl;
+    std::cout << "  --iterations <n>          Timed runs per benchmark (default: 200)" << std::endl;
+    std::cout << "  --warmup <n>              Untimed runs first (default: 20)" << std::endl;
+    std::cout << "  --resolutions <list>      Synthetic frame sizes (default: 640x480,1280x720,1920x1080)" << std::endl;
+    std::cout << "  --faces <list>            Synthetic face counts (default: 1,2,4,8)" << std::endl;
+    std::cout << "  --input <file>            Recorded image or video to benchmark as well" << std::endl;
+    std::cout << "  --frames <n>              Frames read from --input (default: 30)" << std::endl;
+    std::cout << "  --detection-model <path>  YuNet model; enables detect and recorded-face stages" << std::endl;
+    std::cout << "  --arcface <path>          ArcFace model; enables the embed stage" << std::endl;
+    std::cout << "  --inswapper <path>        INSwapper model; enables the swap stage" << std::endl;
+    std::cout << "  --source <image>          Source face; enables the end-to-end frame stage" << std::endl;
+    std::cout << "  --json <file>             Write results as JSON" << std::endl;
+    std::cout << "  --csv <file>              Write results as CSV" << std::endl;
+}
+}
+
+int main(int argc, char** argv) {
+    AllocationTracker::install();
+    BenchOptions options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--iterations" && i + 1 < argc) {
+            if (!parseInteger(argv[++i], 1, options.iterations)) {
+                std::cerr << "Error: --iterations needs a positive number: " << argv[i] << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--warmup" && i + 1 < argc) {
+            if (!parseInteger(argv[++i], 0, options.warmup)) {
+                std::cerr << "Error: --warmup needs a number of at least 0: " << argv[i] << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--resolutions" && i + 1 < argc) {
+            if (!parseResolutions(argv[++i], options.resolutions)) return 1;
+        } else if (arg == "--faces" && i + 1 < argc) {
+            if (!parseCounts(argv[++i], options.faceCounts)) return 1;
+        } else if (arg == "--input" && i + 1 < argc) {
+            options.inputPath = argv[++i];
+        } else if (arg == "--frames" && i + 1 < argc) {
+            if (!parseInteger(argv[++i], 1, options.recordedFrames)) {
+                std::cerr << "Error: --frames needs a positive number: " << argv[i] << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--detection-model" && i + 1 < argc) {
+            options.detectionModel = argv[++i];
+        } else if (arg == "--arcface" && i + 1 < argc) {
+            options.arcFaceModel = argv[++i];
+        } else if (arg == "--inswapper" && i + 1 < argc) {
+            options.inSwapperModel = argv[++i];
+        } else if (arg == "--source" && i + 1 < argc) {
+            options.sourcePath = argv[++i];
+        } else if (arg == "--json" && i + 1 < argc) {
+            options.jsonPath = argv[++i];
+        } else if (arg == "--csv" && i + 1 < argc) {
+            options.csvPath = argv[++i];
+        } else if (arg == "--help" || arg == "-h") {
+            printUsage(argv[0]);
+            return 0;
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    // Keep per-call diagnostics out of the measurements
+    Logger::instance().setLevel(LogLevel::Error);
+
+    StageBenchmark benchmark(options);
+    if (!benchmark.setup()) {
+        return 1;
+    }
+    benchmark.run();
+    Logger::instance().flush();
+
+    bool ok = true;
+    if (!options.jsonPath.empty()) {
+        ok = writeJson(options.jsonPath, benchmark.getResults()) && ok;
+    }
+    if (!options.csvPath.empty()) {
+        ok = writeCsv(options.csvPath, benchmark.getResults()) && ok;
+    }
+    return ok ? 0 : 1;
+}
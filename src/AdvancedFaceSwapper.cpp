@@ -1,19 +1,66 @@
 #include "AdvancedFaceSwapper.hpp"
+#include "ThreadPool.hpp"
+#include "InferenceScheduler.hpp"
+#include "AllocationTracker.hpp"
+#include "Logger.hpp"
+#include "StageProfiler.hpp"
+#include "TraceRecorder.hpp"
 #include <iostream>
 #include <algorithm>
 #include <cmath>
+#include <chrono>
+#include <numeric>
+#include <iomanip>
+
+namespace {
+// Adds the lifetime of the scope to `total` (milliseconds) and, if given a
+// stage, records it with the StageProfiler and the TraceRecorder and charges
+// the scope's allocations to it
+class ScopedStageTimer {
+public:
+    explicit ScopedStageTimer(double& total, ProfileStage stage = ProfileStage::Count)
+        : total(total)
+        , stage(stage)
+        , allocationStage(stage == ProfileStage::Count ? AllocationTracker::getThreadStage() : stage)
+        , start(std::chrono::steady_clock::now()) {}
+    ~ScopedStageTimer() {
+        auto end = std::chrono::steady_clock::now();
+        auto elapsed = end - start;
+        total += std::chrono::duration<double, std::milli>(elapsed).count();
+        if (stage != ProfileStage::Count) {
+            if (StageProfiler::instance().isEnabled()) {
+                StageProfiler::instance().record(stage, elapsed);
+            }
+            TraceRecorder::instance().record(StageProfiler::stageName(stage), start, end);
+        }
+    }
+private:
+    double& total;
+    ProfileStage stage;
+    AllocationStage allocationStage;
+    std::chrono::steady_clock::time_point start;
+};
+}
 
 AdvancedFaceSwapper::AdvancedFaceSwapper() 
-    : arcFaceLoaded(false)
-    , inSwapperLoaded(false)
-    , gfpganLoaded(false)
-    , sourceFaceLoaded(false)
+    : AdvancedFaceSwapper(std::make_shared<FaceSwapEngine>())
+{
+}
+
+AdvancedFaceSwapper::AdvancedFaceSwapper(std::shared_ptr<FaceSwapEngine> engine, int inferenceStream)
+    : engine(std::move(engine))
+    , inferenceStream(inferenceStream)
     , blendStrength(0.95f)
     , enableGFPGAN(false)
     , useTemporalStabilization(true)
     , stabilizationStrength(0.7f)
     , lastFaceCount(0)
+    , frameSourceGeneration(0)
+    , framesUntilDetection(0)
+    , nextTrackId(0)
 {
+    faceDetector = this->engine->createDetector();
+    this->engine->completeInferenceContext(inference, inferenceStream);
 }
 
 AdvancedFaceSwapper::~AdvancedFaceSwapper() {
@@ -21,76 +68,29 @@ AdvancedFaceSwapper::~AdvancedFaceSwapper() {
 }
 
 bool AdvancedFaceSwapper::loadFaceDetectionModel(const std::string& modelPath) {
-    try {
-        faceDetector = cv::FaceDetectorYN::create(modelPath, "", cv::Size(320, 320), 0.9f, 0.3f, 5000);
-        if (faceDetector.empty()) {
-            std::cerr << "Error: Could not load YuNet face detection model." << std::endl;
-            return false;
-        }
-        std::cout << "Face detection model loaded successfully." << std::endl;
-        return true;
-    } catch (const cv::Exception& e) {
-        std::cerr << "Exception loading face detection model: " << e.what() << std::endl;
+    if (!engine->loadFaceDetectionModel(modelPath)) {
         return false;
     }
+    faceDetector = engine->createDetector();
+    return !faceDetector.empty();
 }
 
 bool AdvancedFaceSwapper::loadArcFaceModel(const std::string& modelPath) {
-    try {
-        arcFaceNet = cv::dnn::readNetFromONNX(modelPath);
-        if (arcFaceNet.empty()) {
-            std::cerr << "Warning: Could not load ArcFace model from: " << modelPath << std::endl;
-            std::cerr << "Face embedding extraction will use fallback method." << std::endl;
-            return false;
-        }
-        
-        // Set backend (prefer CPU for compatibility, can be changed to CUDA)
-        arcFaceNet.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
-        arcFaceNet.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
-        
-        arcFaceLoaded = true;
-        std::cout << "ArcFace model loaded successfully." << std::endl;
-        return true;
-    } catch (const cv::Exception& e) {
-        std::cerr << "Exception loading ArcFace model: " << e.what() << std::endl;
+    if (!engine->loadArcFaceModel(modelPath)) {
         return false;
     }
+    inference.arcFaceNet = cv::dnn::Net();
+    engine->completeInferenceContext(inference, inferenceStream);
+    return inference.scheduler || !inference.arcFaceNet.empty();
 }
 
 bool AdvancedFaceSwapper::loadInSwapperModel(const std::string& modelPath) {
-    try {
-        inSwapperNet = cv::dnn::readNetFromONNX(modelPath);
-        if (inSwapperNet.empty()) {
-            std::cerr << "Warning: Could not load INSwapper model from: " << modelPath << std::endl;
-            std::cerr << "Face swapping will use fallback affine transformation." << std::endl;
-            return false;
-        }
-        
-        inSwapperNet.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
-        inSwapperNet.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
-        
-        inSwapperLoaded = true;
-        std::cout << "INSwapper model loaded successfully." << std::endl;
-        std::cout << "  Expected inputs: [target] (1,3,128,128) and [source] (1,512)" << std::endl;
-        return true;
-    } catch (const cv::Exception& e) {
-        std::cerr << "Exception loading INSwapper model: " << e.what() << std::endl;
-        return false;
-    }
-}
-
-bool AdvancedFaceSwapper::loadGFPGANModel(const std::string& modelPath) {
-    try {
-        // GFPGAN models are typically PyTorch format, not ONNX
-        // For now, we'll skip this and add support later
-        std::cerr << "Warning: GFPGAN model loading not yet implemented." << std::endl;
-        std::cerr << "GFPGAN restoration will be skipped." << std::endl;
-        gfpganLoaded = false;
-        return false;
-    } catch (const cv::Exception& e) {
-        std::cerr << "Exception loading GFPGAN model: " << e.what() << std::endl;
+    if (!engine->loadInSwapperModel(modelPath)) {
         return false;
     }
+    inference.inSwapperNet = cv::dnn::Net();
+    engine->completeInferenceContext(inference, inferenceStream);
+    return inference.scheduler || !inference.inSwapperNet.empty();
 }
 
 bool AdvancedFaceSwapper::loadSourceFace(const std::string& imagePath) {
@@ -103,76 +103,16 @@ bool AdvancedFaceSwapper::loadSourceFace(const std::string& imagePath) {
 }
 
 bool AdvancedFaceSwapper::loadSourceFace(const cv::Mat& image) {
-    if (image.empty() || faceDetector.empty()) {
-        return false;
-    }
-    
-    sourceFaceImage = image.clone();
-    
-    // Set input size for face detection
-    faceDetector->setInputSize(image.size());
-    
-    // Detect face in source image
-    cv::Mat faces;
-    faceDetector->detect(image, faces);
-    
-    if (faces.rows == 0) {
-        std::cerr << "Error: No face detected in source image." << std::endl;
-        return false;
-    }
-    
-    // Use the first detected face
-    float x = faces.at<float>(0, 0);
-    float y = faces.at<float>(0, 1);
-    float w = faces.at<float>(0, 2);
-    float h = faces.at<float>(0, 3);
-    
-    sourceFaceRect = cv::Rect(
-        std::max(0, static_cast<int>(x)),
-        std::max(0, static_cast<int>(y)),
-        std::min(image.cols - static_cast<int>(x), static_cast<int>(w)),
-        std::min(image.rows - static_cast<int>(y), static_cast<int>(h))
-    );
-    
-    // Extract landmarks
-    sourceLandmarks = extractLandmarks(faces, 0);
-    
-    if (sourceLandmarks.empty()) {
-        std::cerr << "Error: Could not extract landmarks from source face." << std::endl;
+    std::shared_ptr<const SourceFace> source = prepareSourceFace(image);
+    if (!source) {
         return false;
     }
-    
-    // Align source face
-    sourceFaceAligned = alignFace(sourceFaceImage, sourceLandmarks, sourceFaceRect, 512);
-    
-    // Extract face embedding if ArcFace is loaded
-    if (arcFaceLoaded && !sourceFaceAligned.empty()) {
-        sourceFaceEmbedding = extractFaceEmbedding(sourceFaceAligned);
-    }
-    
-    sourceFaceLoaded = true;
+    setSourceFace(source);
     std::cout << "Source face loaded successfully! Face size: " 
-              << sourceFaceRect.width << "x" << sourceFaceRect.height << std::endl;
+              << source->faceRect.width << "x" << source->faceRect.height << std::endl;
     return true;
 }
 
-std::vector<cv::Point2f> AdvancedFaceSwapper::extractLandmarks(const cv::Mat& faces, int faceIndex) {
-    std::vector<cv::Point2f> landmarks;
-    
-    if (faceIndex >= faces.rows) {
-        return landmarks;
-    }
-    
-    // YuNet format: [x, y, w, h, x_re, y_re, x_le, y_le, x_nt, y_nt, x_rcm, y_rcm, x_lcm, y_lcm, confidence]
-    landmarks.push_back(cv::Point2f(faces.at<float>(faceIndex, 6), faces.at<float>(faceIndex, 7))); // Left eye
-    landmarks.push_back(cv::Point2f(faces.at<float>(faceIndex, 4), faces.at<float>(faceIndex, 5))); // Right eye
-    landmarks.push_back(cv::Point2f(faces.at<float>(faceIndex, 8), faces.at<float>(faceIndex, 9))); // Nose tip
-    landmarks.push_back(cv::Point2f(faces.at<float>(faceIndex, 12), faces.at<float>(faceIndex, 13))); // Left mouth corner
-    landmarks.push_back(cv::Point2f(faces.at<float>(faceIndex, 10), faces.at<float>(faceIndex, 11))); // Right mouth corner
-    
-    return landmarks;
-}
-
 cv::Mat AdvancedFaceSwapper::preprocessFrame(const cv::Mat& frame) {
     // Apply any preprocessing: denoising, contrast enhancement, etc.
     cv::Mat processed = frame.clone();
@@ -189,227 +129,183 @@ cv::Mat AdvancedFaceSwapper::preprocessFrame(const cv::Mat& frame) {
     return processed;
 }
 
-cv::Mat AdvancedFaceSwapper::alignFace(const cv::Mat& image, const std::vector<cv::Point2f>& landmarks, 
-                                       const cv::Rect& faceRect, int outputSize) {
-    if (landmarks.size() < 5) {
-        return cv::Mat();
+bool AdvancedFaceSwapper::prepareSwapInputs(const cv::Mat& targetFace, const cv::Mat& sourceEmbedding,
+                                            cv::Mat& faceBlob, cv::Mat& embeddingInput) {
+    // INSwapper model expects:
+    // - Input 1: target face image (512x512, BGR, normalized to [-1, 1])
+    // - Input 2: source face embedding (512-dim vector, normalized)
+    // - Output: swapped face (512x512, BGR, normalized to [-1, 1])
+    
+    // Make sure target face is the right size
+    cv::Mat inputFace = targetFace.clone();
+    if (inputFace.size() != cv::Size(512, 512)) {
+        cv::resize(inputFace, inputFace, cv::Size(512, 512));
     }
     
-    // Standard face alignment points (for 512x512 output)
-    std::vector<cv::Point2f> dstPoints = {
-        cv::Point2f(0.31556875f * outputSize, 0.46157407f * outputSize), // Left eye
-        cv::Point2f(0.68262292f * outputSize, 0.46157407f * outputSize), // Right eye
-        cv::Point2f(0.50026250f * outputSize, 0.64050537f * outputSize), // Nose tip
-        cv::Point2f(0.37015179f * outputSize, 0.82469196f * outputSize), // Left mouth corner
-        cv::Point2f(0.63151667f * outputSize, 0.82469196f * outputSize)  // Right mouth corner
-    };
+    // Convert to float and normalize to [-1, 1]
+    if (inputFace.type() != CV_32F) {
+        inputFace.convertTo(inputFace, CV_32F);
+    }
+    inputFace = (inputFace - 127.5) / 127.5;
     
-    // Adjust source landmarks to be relative to face rect
-    std::vector<cv::Point2f> srcPoints;
-    for (const auto& pt : landmarks) {
-        srcPoints.push_back(cv::Point2f(pt.x - faceRect.x, pt.y - faceRect.y));
+    LOG_DEBUG("Prepared face - size: " << inputFace.size() << ", channels: " << inputFace.channels());
+    LOG_DEBUG("Face type: " << inputFace.type());
+    
+    // Prepare for blob creation - convert to uint8 if needed
+    cv::Mat blobInput;
+    
+    if (inputFace.type() == CV_32F) {
+        // Denormalize from [-1, 1] to [0, 255]
+        cv::Mat temp = (inputFace + 1.0) * 127.5;
+        temp.convertTo(blobInput, CV_8U);
+    } else {
+        blobInput = inputFace.clone();
+        if (blobInput.type() != CV_8U) {
+            blobInput.convertTo(blobInput, CV_8U);
+        }
     }
     
-    // Calculate similarity transformation
-    cv::Mat transform = cv::estimateAffinePartial2D(srcPoints, dstPoints);
+    // Ensure it's 128x128 for INSwapper_128
+    if (blobInput.rows != 128 || blobInput.cols != 128) {
+        cv::resize(blobInput, blobInput, cv::Size(128, 128));
+    }
+    
+    // Ensure continuous memory
+    blobInput = blobInput.clone();
     
-    if (transform.empty()) {
-        return cv::Mat();
+    // Create blob using standard method - uint8 input, scale to [0, 1]
+    faceBlob = cv::dnn::blobFromImage(
+        blobInput,
+        1.0 / 255.0,           // scalefactor to convert [0, 255] to [0, 1]
+        cv::Size(128, 128),    // target size
+        cv::Scalar(0, 0, 0),
+        true,                  // swapRB
+        false                  // crop
+    );
+    
+    if (faceBlob.empty()) {
+        LOG_ERROR("Failed to create blob from image");
+        return false;
     }
     
-    // Extract face region
-    cv::Mat faceROI = image(faceRect);
+    // Print blob shape CORRECTLY for 4D tensor
+    LOG_DEBUG("Face blob dims: " << faceBlob.dims << ", shape: " << faceBlob.size);
+    
+    // Prepare embedding with CORRECT shape [1 x 512]. A prepared source latent
+    // already has it and is used as is.
+    if (sourceEmbedding.type() == CV_32F && sourceEmbedding.rows == 1 && sourceEmbedding.cols == 512
+        && sourceEmbedding.isContinuous()) {
+        embeddingInput = sourceEmbedding;
+        return true;
+    }
+    embeddingInput = sourceEmbedding.clone();
+    if (embeddingInput.type() != CV_32F) {
+        embeddingInput.convertTo(embeddingInput, CV_32F);
+    }
     
-    // Warp face
-    cv::Mat aligned;
-    cv::warpAffine(faceROI, aligned, transform, cv::Size(outputSize, outputSize));
+    // FIX: Reshape to [1 x 512] not [512 x 1]
+    if (embeddingInput.rows != 1 || embeddingInput.cols != 512) {
+        embeddingInput = embeddingInput.reshape(1, 1);
+    }
     
-    return aligned;
+    if (embeddingInput.cols != 512) {
+        LOG_ERROR("Embedding has wrong dimension: " << embeddingInput.cols);
+        return false;
+    }
+    
+    LOG_DEBUG("Embedding shape - " << embeddingInput.rows << " x " << embeddingInput.cols);
+    return true;
 }
 
-cv::Mat AdvancedFaceSwapper::extractFaceEmbedding(const cv::Mat& alignedFace) {
-    if (!arcFaceLoaded || alignedFace.empty()) {
-        // Fallback: return empty embedding (will use fallback swapping)
-        return cv::Mat();
-    }
+cv::Mat AdvancedFaceSwapper::decodeSwapOutput(const cv::Mat& swapped) {
+    ScopedProfile profile(ProfileStage::Decode);
     
-    try {
-        // Preprocess for ArcFace (normalize to [-1, 1] and resize to 112x112)
-        cv::Mat input;
-        cv::resize(alignedFace, input, cv::Size(112, 112));
-        input.convertTo(input, CV_32F, 1.0/127.5, -1.0); // Normalize to [-1, 1]
-        
-        // Create blob
-        cv::Mat blob = cv::dnn::blobFromImage(input, 1.0, cv::Size(112, 112), cv::Scalar(), true, false);
-        
-        // Set input
-        arcFaceNet.setInput(blob);
-        
-        // Forward pass
-        std::vector<cv::Mat> outputs;
-        arcFaceNet.forward(outputs);
-        
-        if (!outputs.empty()) {
-            // Normalize embedding
-            cv::Mat embedding = outputs[0];
-            
-            // Ensure embedding is 1D
-            if (embedding.dims > 1 && embedding.rows > 1) {
-                embedding = embedding.reshape(1, 1);
-            }
-            
-            if (embedding.empty() || embedding.total() == 0) {
-                std::cerr << "Error: Invalid embedding from ArcFace" << std::endl;
-                return cv::Mat();
-            }
-            
-            // Reshape to 1x512 if needed
-            if (embedding.cols != 512) {
-                embedding = embedding.reshape(0, 1);
-                if (embedding.cols != 512) {
-                    std::cerr << "Warning: Embedding dimension mismatch. Expected 512, got " << embedding.cols << std::endl;
-                    // Still return it, might work
-                }
-            }
-            
-            // Normalize using safe method
-            cv::Mat norm = embedding.clone();
-            double normVal = cv::norm(norm, cv::NORM_L2);
-            if (normVal > 0) {
-                norm = norm / normVal;
-            }
-            
-            return norm;
-        }
-    } catch (const cv::Exception& e) {
-        std::cerr << "Error extracting face embedding: " << e.what() << std::endl;
-    } catch (...) {
-        std::cerr << "Unknown error in extractFaceEmbedding" << std::endl;
+    // Remove batch dimension: [1,3,128,128] → [3,128,128]
+    cv::Mat outputReshaped = swapped.reshape(1, {3, 128, 128});
+    LOG_DEBUG("Reshaped to: 3 x 128 x 128");
+    
+    // Split channels from CHW to separate C matrices
+    std::vector<cv::Mat> channels(3);
+    for (int i = 0; i < 3; i++) {
+        channels[i] = cv::Mat(128, 128, CV_32F, outputReshaped.ptr<float>(i));
     }
+    LOG_DEBUG("Channels extracted");
     
-    return cv::Mat();
+    // Merge channels into HWC format
+    cv::Mat swappedFaceFloat;
+    cv::merge(channels, swappedFaceFloat);
+    LOG_DEBUG("Merged to HWC, shape: " << swappedFaceFloat.size());
+    
+    // Convert range [-1,1] → [0,255]
+    swappedFaceFloat = (swappedFaceFloat + 1.0) * 127.5;
+    LOG_DEBUG("Denormalized range [-1,1] to [0,255]");
+    
+    // Convert float32 → uint8
+    cv::Mat swappedFaceUint8;
+    swappedFaceFloat.convertTo(swappedFaceUint8, CV_8UC3);
+    LOG_DEBUG("Converted to uint8, channels: " << swappedFaceUint8.channels());
+    
+    // Convert RGB → BGR (model outputs RGB, OpenCV expects BGR)
+    cv::Mat swappedFaceBGR;
+    cv::cvtColor(swappedFaceUint8, swappedFaceBGR, cv::COLOR_RGB2BGR);
+    LOG_DEBUG("Converted RGB→BGR");
+    
+    // Now it's ready: [128, 128, 3] uint8 BGR
+    LOG_DEBUG("INSwapper output conversion successful, final shape: " << swappedFaceBGR.size()
+           << ", type: " << swappedFaceBGR.type());
+    return swappedFaceBGR;
 }
 
-cv::Mat AdvancedFaceSwapper::swapFaceWithModel(const cv::Mat& targetFace, const cv::Mat& sourceEmbedding) {
+cv::Mat AdvancedFaceSwapper::swapFaceWithModel(const cv::Mat& targetFace, const cv::Mat& sourceEmbedding,
+                                               InferenceContext& context) {
     // If no embedding provided or model not loaded, use fallback
-    if (!inSwapperLoaded || sourceEmbedding.empty() || targetFace.empty()) {
+    if (!engine->hasInSwapper() || sourceEmbedding.empty() || targetFace.empty()) {
         return cv::Mat(); // Return empty to trigger fallback
     }
     
     try {
-        // INSwapper model expects:
-        // - Input 1: target face image (512x512, BGR, normalized to [-1, 1])
-        // - Input 2: source face embedding (512-dim vector, normalized)
-        // - Output: swapped face (512x512, BGR, normalized to [-1, 1])
-        
-        // Make sure target face is the right size
-        cv::Mat inputFace = targetFace.clone();
-        if (inputFace.size() != cv::Size(512, 512)) {
-            cv::resize(inputFace, inputFace, cv::Size(512, 512));
-        }
-        
-        // Convert to float and normalize to [-1, 1]
-        if (inputFace.type() != CV_32F) {
-            inputFace.convertTo(inputFace, CV_32F);
-        }
-        inputFace = (inputFace - 127.5) / 127.5;
-        
-        std::cout << "DEBUG: Prepared face - size: " << inputFace.size() << ", channels: " << inputFace.channels() << std::endl;
-        std::cout << "DEBUG: Face type: " << inputFace.type() << std::endl;
-        
-        // Prepare for blob creation - convert to uint8 if needed
-        cv::Mat blobInput;
-        
-        if (inputFace.type() == CV_32F) {
-            // Denormalize from [-1, 1] to [0, 255]
-            cv::Mat temp = (inputFace + 1.0) * 127.5;
-            temp.convertTo(blobInput, CV_8U);
-        } else {
-            blobInput = inputFace.clone();
-            if (blobInput.type() != CV_8U) {
-                blobInput.convertTo(blobInput, CV_8U);
-            }
-        }
-        
-        // Ensure it's 128x128 for INSwapper_128
-        if (blobInput.rows != 128 || blobInput.cols != 128) {
-            cv::resize(blobInput, blobInput, cv::Size(128, 128));
-        }
-        
-        // Ensure continuous memory
-        blobInput = blobInput.clone();
-        
-        // Create blob using standard method - uint8 input, scale to [0, 1]
-        cv::Mat faceBlob = cv::dnn::blobFromImage(
-            blobInput,
-            1.0 / 255.0,           // scalefactor to convert [0, 255] to [0, 1]
-            cv::Size(128, 128),    // target size
-            cv::Scalar(0, 0, 0),
-            true,                  // swapRB
-            false                  // crop
-        );
-        
-        if (faceBlob.empty()) {
-            std::cerr << "Error: Failed to create blob from image" << std::endl;
-            return cv::Mat();
-        }
-        
-        // Print blob shape CORRECTLY for 4D tensor
-        std::cout << "DEBUG: Face blob dims: " << faceBlob.dims << std::endl;
-        for (int i = 0; i < faceBlob.dims; i++) {
-            std::cout << "  dim " << i << ": " << faceBlob.size[i] << std::endl;
-        }
-        
-        // Prepare embedding with CORRECT shape [1 x 512]
-        cv::Mat embeddingInput = sourceEmbedding.clone();
-        if (embeddingInput.type() != CV_32F) {
-            embeddingInput.convertTo(embeddingInput, CV_32F);
-        }
-        
-        // FIX: Reshape to [1 x 512] not [512 x 1]
-        if (embeddingInput.rows != 1 || embeddingInput.cols != 512) {
-            embeddingInput = embeddingInput.reshape(1, 1);
-        }
-        
-        if (embeddingInput.cols != 512) {
-            std::cerr << "Error: Embedding has wrong dimension: " << embeddingInput.cols << std::endl;
+        cv::Mat faceBlob;
+        cv::Mat embeddingInput;
+        if (!prepareSwapInputs(targetFace, sourceEmbedding, faceBlob, embeddingInput)) {
             return cv::Mat();
         }
         
-        std::cout << "DEBUG: Embedding shape - " << embeddingInput.rows << " x " << embeddingInput.cols << std::endl;
-        
         // INSwapper requires TWO inputs with EXACT names: "target" and "source"
         // target: [1, 3, 128, 128] - face image
         // source: [1, 512] - embedding vector
         try {
-            // Set the target face image input
-            inSwapperNet.setInput(faceBlob, "target");
-            std::cout << "DEBUG: Face blob set to 'target' layer: " << faceBlob.size << std::endl;
-            
-            // Set the source embedding input
-            inSwapperNet.setInput(embeddingInput, "source");
-            std::cout << "DEBUG: Embedding set to 'source' layer: " << embeddingInput.size << std::endl;
-            
-            // Forward pass
-            cv::Mat swapped = inSwapperNet.forward();
+            cv::Mat swapped;
+            {
+                ScopedProfile profile(ProfileStage::Swap);
+                
+                if (context.scheduler) {
+                    // Queued with other streams' swaps; may run batched
+                    swapped = context.scheduler->forwardSwap(context.stream, faceBlob, embeddingInput);
+                } else {
+                    cv::dnn::Net& net = context.inSwapperNet;
+                    
+                    // Set the target face image input
+                    net.setInput(faceBlob, "target");
+                    LOG_DEBUG("Face blob set to 'target' layer: " << faceBlob.size);
+                    
+                    // Set the source embedding input
+                    net.setInput(embeddingInput, "source");
+                    LOG_DEBUG("Embedding set to 'source' layer: " << embeddingInput.size);
+                    
+                    // Forward pass
+                    swapped = net.forward();
+                }
+            }
             
-            std::cout << "DEBUG: Forward pass completed" << std::endl;
+            LOG_DEBUG("Forward pass completed");
             
             // Print output shape
             if (!swapped.empty()) {
-                std::cout << "DEBUG: Output dims: " << swapped.dims << std::endl;
-                if (swapped.dims > 0) {
-                    std::cout << "  Shape: ";
-                    for (int i = 0; i < swapped.dims; i++) {
-                        std::cout << swapped.size[i];
-                        if (i < swapped.dims - 1) std::cout << " x ";
-                    }
-                    std::cout << std::endl;
-                }
+                LOG_DEBUG("Output dims: " << swapped.dims << ", shape: " << swapped.size);
             }
             
             if (swapped.empty()) {
-                std::cerr << "INSwapper model: empty output, using geometric fallback" << std::endl;
+                LOG_ERROR("INSwapper model: empty output, using geometric fallback");
                 return cv::Mat();
             }
             
@@ -418,63 +314,27 @@ cv::Mat AdvancedFaceSwapper::swapFaceWithModel(const cv::Mat& targetFace, const
             // Output needed: [128, 128, 3] uint8 in range [0, 255]
             
             try {
-                // Remove batch dimension: [1,3,128,128] → [3,128,128]
-                cv::Mat outputReshaped = swapped.reshape(1, {3, 128, 128});
-                std::cout << "DEBUG: Reshaped to: 3 x 128 x 128" << std::endl;
-                
-                // Split channels from CHW to separate C matrices
-                std::vector<cv::Mat> channels(3);
-                for (int i = 0; i < 3; i++) {
-                    channels[i] = cv::Mat(128, 128, CV_32F, outputReshaped.ptr<float>(i));
-                }
-                std::cout << "DEBUG: Channels extracted" << std::endl;
-                
-                // Merge channels into HWC format
-                cv::Mat swappedFaceFloat;
-                cv::merge(channels, swappedFaceFloat);
-                std::cout << "DEBUG: Merged to HWC, shape: " << swappedFaceFloat.size() << std::endl;
-                
-                // Convert range [-1,1] → [0,255]
-                swappedFaceFloat = (swappedFaceFloat + 1.0) * 127.5;
-                std::cout << "DEBUG: Denormalized range [-1,1] to [0,255]" << std::endl;
-                
-                // Convert float32 → uint8
-                cv::Mat swappedFaceUint8;
-                swappedFaceFloat.convertTo(swappedFaceUint8, CV_8UC3);
-                std::cout << "DEBUG: Converted to uint8, channels: " << swappedFaceUint8.channels() << std::endl;
-                
-                // Convert RGB → BGR (model outputs RGB, OpenCV expects BGR)
-                cv::Mat swappedFaceBGR;
-                cv::cvtColor(swappedFaceUint8, swappedFaceBGR, cv::COLOR_RGB2BGR);
-                std::cout << "DEBUG: Converted RGB→BGR" << std::endl;
-                
-                // Now it's ready: [128, 128, 3] uint8 BGR
-                std::cout << "✓ INSwapper output conversion successful!" << std::endl;
-                std::cout << "  Final shape: " << swappedFaceBGR.size() << ", type: " << swappedFaceBGR.type() << std::endl;
-                return swappedFaceBGR;
+                return decodeSwapOutput(swapped);
                 
             } catch (const cv::Exception& e) {
-                std::cerr << "Error in INSwapper output conversion: " << e.what() << std::endl;
-                std::cerr << "Falling back to geometric transformation." << std::endl;
+                LOG_ERROR("Error in INSwapper output conversion: " << e.what() << ". Falling back to geometric transformation.");
                 return cv::Mat();
             }
         } catch (const cv::Exception& e) {
-            std::cerr << "Error in INSwapper inference: " << e.what() << std::endl;
-            std::cerr << "Falling back to geometric transformation." << std::endl;
+            LOG_ERROR("Error in INSwapper inference: " << e.what() << ". Falling back to geometric transformation.");
             return cv::Mat();
         }
     } catch (const cv::Exception& e) {
-        std::cerr << "Error in face swap model: " << e.what() << std::endl;
-        std::cerr << "Falling back to geometric transformation." << std::endl;
+        LOG_ERROR("Error in face swap model: " << e.what() << ". Falling back to geometric transformation.");
         return cv::Mat(); // Return empty to trigger fallback
     } catch (...) {
-        std::cerr << "Unknown error in face swap model. Falling back." << std::endl;
+        LOG_ERROR("Unknown error in face swap model. Falling back.");
         return cv::Mat(); // Return empty to trigger fallback
     }
 }
 
 cv::Mat AdvancedFaceSwapper::restoreFace(const cv::Mat& swappedFace) {
-    if (!enableGFPGAN || !gfpganLoaded || swappedFace.empty()) {
+    if (!enableGFPGAN || !engine->hasGFPGAN() || swappedFace.empty()) {
         return swappedFace.clone();
     }
     
@@ -535,17 +395,17 @@ cv::Mat AdvancedFaceSwapper::blendFace(const cv::Mat& swappedFace, const cv::Mat
     
     // Validate inputs
     if (swappedFace.empty() || originalFrame.empty() || mask.empty()) {
-        std::cerr << "Error: Invalid input to blendFace" << std::endl;
+        LOG_ERROR("Invalid input to blendFace");
         return result;
     }
     
-    std::cout << "DEBUG blendFace: swappedFace size " << swappedFace.size() << ", rect " << faceRect << std::endl;
+    LOG_DEBUG("blendFace: swappedFace size " << swappedFace.size() << ", rect " << faceRect);
     
     // Check if face rect is valid
     if (faceRect.x < 0 || faceRect.y < 0 || 
         faceRect.x + faceRect.width > originalFrame.cols ||
         faceRect.y + faceRect.height > originalFrame.rows) {
-        std::cerr << "Error: Face rect out of bounds: rect=" << faceRect << ", frame=" << originalFrame.size() << std::endl;
+        LOG_ERROR("Face rect out of bounds: rect=" << faceRect << ", frame=" << originalFrame.size());
         return result;
     }
     
@@ -588,20 +448,22 @@ cv::Mat AdvancedFaceSwapper::blendFace(const cv::Mat& swappedFace, const cv::Mat
     // Extract face region
     cv::Mat faceROI = result(faceRect).clone();
     
-    std::cout << "DEBUG: faceROI size " << faceROI.size() << ", resizedFace size " << resizedFace.size() 
-              << ", mask3Channel size " << mask3Channel.size() << std::endl;
+    LOG_DEBUG("faceROI size " << faceROI.size() << ", resizedFace size " << resizedFace.size() 
+           << ", mask3Channel size " << mask3Channel.size());
     
     // Blend
     cv::Mat faceFloat, swappedFloat;
     faceROI.convertTo(faceFloat, CV_32F);
     resizedFace.convertTo(swappedFloat, CV_32F);
     
-    // Compute blend
-    cv::Mat blended = faceFloat * 0.5f + swappedFloat * 0.5f;  // Simple 50/50 blend for now
+    // Feathered mask scaled by the blend strength: alpha = mask * strength
+    cv::Mat alpha = mask3Channel * blendStrength;
+    cv::Mat inverseAlpha = cv::Scalar::all(1.0) - alpha;
+    cv::Mat blended = swappedFloat.mul(alpha) + faceFloat.mul(inverseAlpha);
     
     blended.convertTo(result(faceRect), CV_8U);
     
-    std::cout << "DEBUG: Blending completed successfully" << std::endl;
+    LOG_DEBUG("Blending completed successfully");
     
     return result;
 }
@@ -639,7 +501,7 @@ cv::Mat AdvancedFaceSwapper::stabilizeFace(const cv::Mat& currentFace, const std
         try {
             stabilized = stabilized + prevFloat * (stabilizationStrength * weight);
         } catch (const cv::Exception& e) {
-            std::cerr << "Warning: Skipping frame stabilization due to size mismatch: " << e.what() << std::endl;
+            LOG_WARN("Skipping frame stabilization due to size mismatch: " << e.what());
             continue;
         }
     }
@@ -652,84 +514,424 @@ void AdvancedFaceSwapper::setBlendStrength(float strength) {
     blendStrength = std::max(0.0f, std::min(1.0f, strength));
 }
 
-void AdvancedFaceSwapper::detectAndSwap(cv::Mat& frame) {
-    if (frame.empty() || faceDetector.empty() || !sourceFaceLoaded) {
+void AdvancedFaceSwapper::applyRuntimeSettings(const RuntimeSettings& settings) {
+    setBlendStrength(settings.blendStrength);
+    setTemporalStabilization(settings.temporalStabilization);
+    setEnableGFPGAN(settings.enableGFPGAN);
+}
+
+bool AdvancedFaceSwapper::setFaceWorkers(int count) {
+    count = std::max(1, count);
+    faceWorkers.reset();
+    workerContexts.clear();
+    
+    if (count == 1) {
+        return true;
+    }
+    
+    // Worker 0 shares this swapper's networks, the others get their own
+    workerContexts.resize(count);
+    workerContexts[0] = inference;
+    for (int i = 1; i < count; i++) {
+        InferenceContext& context = workerContexts[i];
+        engine->completeInferenceContext(context, inferenceStream);
+        if (!context.scheduler && ((engine->hasArcFace() && context.arcFaceNet.empty())
+                                   || (engine->hasInSwapper() && context.inSwapperNet.empty()))) {
+            std::cerr << "Error: Could not load networks for face worker " << i << std::endl;
+            workerContexts.clear();
+            return false;
+        }
+    }
+    
+    faceWorkers = std::make_unique<ThreadPool>(count, PipelineStage::SwapInference);
+    std::cout << "Per-face workers: " << count << std::endl;
+    return true;
+}
+
+int AdvancedFaceSwapper::getFaceWorkerCount() const {
+    return faceWorkers ? static_cast<int>(faceWorkers->size()) : 1;
+}
+
+void AdvancedFaceSwapper::printFaceScalingReport(std::ostream& os) const {
+    double singleFaceMs = faceScaling[1].frames > 0 ? faceScaling[1].totalMs / faceScaling[1].frames : 0.0;
+    
+    os << "Per-face scaling (" << (faceWorkers ? faceWorkers->size() : 1) << " face worker(s)):" << std::endl;
+    os << "  faces  frames   ms/frame   ms/face   speedup vs serial" << std::endl;
+    for (size_t faces = 1; faces < faceScaling.size(); faces++) {
+        const FaceScalingSample& sample = faceScaling[faces];
+        if (sample.frames == 0) continue;
+        
+        double frameMs = sample.totalMs / sample.frames;
+        os << "  " << std::setw(5) << faces << "  " << std::setw(6) << sample.frames
+           << std::fixed << std::setprecision(2)
+           << "  " << std::setw(9) << frameMs << "  " << std::setw(8) << frameMs / faces;
+        if (singleFaceMs > 0.0) {
+            os << "  " << std::setw(8) << (singleFaceMs * faces) / frameMs << "x";
+        }
+        os << std::endl;
+    }
+}
+
+void AdvancedFaceSwapper::setQualitySettings(const QualitySettings& settings) {
+    quality = settings;
+    quality.detectionInterval = std::max(1, quality.detectionInterval);
+    quality.detectionScale = std::max(0.1f, std::min(1.0f, quality.detectionScale));
+    framesUntilDetection = std::min(framesUntilDetection, quality.detectionInterval - 1);
+}
+
+void AdvancedFaceSwapper::resetTemporalState() {
+    trackedFaces.clear();
+    trackIdentities.clear();
+    previousFaces.clear();
+    previousLandmarks.clear();
+    lastDetections.release();
+    framesUntilDetection = 0;
+}
+
+cv::Mat AdvancedFaceSwapper::detectFaces(const cv::Mat& image) {
+    cv::Mat input = image;
+    float scale = quality.detectionScale;
+    if (scale < 1.0f) {
+        cv::resize(image, input, cv::Size(), scale, scale, cv::INTER_AREA);
+    }
+    
+    faceDetector->setInputSize(input.size());
+    
+    cv::Mat faces;
+    faceDetector->detect(input, faces);
+    
+    // Map boxes and landmarks (columns 0-13) back to full resolution
+    if (scale < 1.0f && faces.rows > 0) {
+        cv::Mat coords = faces.colRange(0, 14);
+        coords *= 1.0 / scale;
+    }
+    
+    return faces;
+}
+
+std::vector<int> AdvancedFaceSwapper::assignTrackIds(const cv::Mat& faces) {
+    // Greedy IoU matching: each face takes the best unclaimed track of the
+    // previous frame, or starts a new one
+    const float minOverlap = 0.3f;
+    std::vector<int> ids(faces.rows, -1);
+    std::vector<std::pair<int, cv::Rect2f>> current;
+    std::vector<bool> claimed(trackedFaces.size(), false);
+    
+    for (int i = 0; i < faces.rows; i++) {
+        cv::Rect2f box(faces.at<float>(i, 0), faces.at<float>(i, 1), faces.at<float>(i, 2), faces.at<float>(i, 3));
+        float bestOverlap = minOverlap;
+        int best = -1;
+        for (size_t t = 0; t < trackedFaces.size(); t++) {
+            if (claimed[t]) continue;
+            const cv::Rect2f& previous = trackedFaces[t].second;
+            float intersection = (box & previous).area();
+            float overlap = intersection / (box.area() + previous.area() - intersection + 1e-6f);
+            if (overlap > bestOverlap) {
+                bestOverlap = overlap;
+                best = static_cast<int>(t);
+            }
+        }
+        if (best >= 0) {
+            claimed[best] = true;
+            ids[i] = trackedFaces[best].first;
+        } else {
+            ids[i] = nextTrackId++;
+        }
+        current.emplace_back(ids[i], box);
+    }
+    
+    trackedFaces.swap(current);
+    return ids;
+}
+
+void AdvancedFaceSwapper::detectAndSwap(cv::Mat& frame, const cv::Mat* knownFaces) {
+    if (frame.empty() || !isReadyToSwap()) {
         return;
     }
     
+    FrameTimings timings;
+    auto frameStart = std::chrono::steady_clock::now();
+    
     try {
-        // Preprocess frame
-        cv::Mat processedFrame = preprocessFrame(frame);
-        
-        // Set input size if it changed
-        faceDetector->setInputSize(processedFrame.size());
-        
-        // Detect faces
-        cv::Mat faces;
-        faceDetector->detect(processedFrame, faces);
-        
-        std::cout << "DEBUG: Detected " << faces.rows << " faces" << std::endl;
-        lastFaceCount = faces.rows;
+        FrameAnalysis analysis = analyzeFrame(frame, timings, knownFaces);
+        std::vector<SwappedFace> swapped = swapFaces(analysis, timings);
+        compositeFaces(frame, swapped, timings);
+    } catch (const cv::Exception& e) {
+        LOG_ERROR("Exception in detectAndSwap: " << e.what());
+    } catch (const std::exception& e) {
+        LOG_ERROR("Standard exception in detectAndSwap: " << e.what());
+    } catch (...) {
+        LOG_ERROR("Unknown exception in detectAndSwap");
+    }
+    
+    auto frameEnd = std::chrono::steady_clock::now();
+    auto frameElapsed = frameEnd - frameStart;
+    timings.totalMs = std::chrono::duration<double, std::milli>(frameElapsed).count();
+    lastTimings = timings;
+    
+    if (StageProfiler::instance().isEnabled()) {
+        StageProfiler::instance().record(ProfileStage::Frame, frameElapsed);
+    }
+    TraceRecorder::instance().record(StageProfiler::stageName(ProfileStage::Frame), frameStart, frameEnd);
+}
+
+FrameAnalysis AdvancedFaceSwapper::analyzeFrame(const cv::Mat& frame, FrameTimings& timings, const cv::Mat* knownFaces) {
+    FrameAnalysis analysis;
+    analysis.quality = quality;
+    
+    // Preprocess frame
+    {
+        ScopedStageTimer timer(timings.preprocessMs, ProfileStage::Preprocess);
+        analysis.processedFrame = preprocessFrame(frame);
+    }
+    
+    // Detect faces, reusing the previous result between detector runs
+    if (knownFaces) {
+        // Replayed detections stand in for the detector
+        analysis.faces = knownFaces->clone();
+        lastDetections = analysis.faces;
+    } else if (framesUntilDetection <= 0 || lastDetections.cols < 14) {
+        ScopedStageTimer timer(timings.detectMs, ProfileStage::Detect);
+        analysis.faces = detectFaces(analysis.processedFrame);
+        lastDetections = analysis.faces;
+        framesUntilDetection = quality.detectionInterval - 1;
+        timings.detectionRan = true;
+    } else {
+        analysis.faces = lastDetections;
+        framesUntilDetection--;
+    }
     
-    // Process each detected face
+    LOG_DEBUG("Detected " << analysis.faces.rows << " faces");
+    lastFaceCount = analysis.faces.rows;
+    analysis.trackIds = assignTrackIds(analysis.faces);
+    
+    return analysis;
+}
+
+std::vector<SwappedFace> AdvancedFaceSwapper::swapFaces(const FrameAnalysis& analysis, FrameTimings& timings) {
+    std::vector<SwappedFace> results;
+    const cv::Mat& faces = analysis.faces;
+    const QualitySettings& limits = analysis.quality;
+    auto start = std::chrono::steady_clock::now();
+    
+    // The whole frame uses one source face and one bank snapshot, even if
+    // new ones are published meanwhile. Unless something was published since
+    // the last frame, that is two atomic loads and no lock.
+    uint64_t sourceGeneration = engine->getSourceGeneration();
+    if (sourceGeneration != frameSourceGeneration) {
+        frameSource = engine->getSourceFace();
+        frameSourceGeneration = sourceGeneration;
+    }
+    const SourceBank& sourceBank = engine->getSourceBank();
+    if (!frameBank || frameBank->version != sourceBank.getVersion()) {
+        frameBank = sourceBank.snapshot();
+    }
+    std::shared_ptr<const SourceFace> source = frameSource;
+    std::shared_ptr<const SourceBankSnapshot> bank = frameBank;
+    if (!source && !bank->hasRules()) {
+        return results;
+    }
+    
+    // Identities already matched for these tracks; forget tracks that ended
+    std::unordered_map<int, TrackIdentity> liveIdentities;
+    if (bank->hasRules()) {
+        for (int trackId : analysis.trackIds) {
+            auto it = trackIdentities.find(trackId);
+            if (it != trackIdentities.end() && it->second.bankVersion == bank->version) {
+                liveIdentities.insert(*it);
+            }
+        }
+    }
+    trackIdentities.swap(liveIdentities);
+    
+    // Model swaps go to the largest faces when the quality limit caps them
+    std::vector<bool> modelSwapAllowed(faces.rows, true);
+    if (limits.maxModelSwapFaces >= 0 && faces.rows > limits.maxModelSwapFaces) {
+        std::vector<int> order(faces.rows);
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&faces](int a, int b) {
+            return faces.at<float>(a, 2) * faces.at<float>(a, 3) > faces.at<float>(b, 2) * faces.at<float>(b, 3);
+        });
+        for (size_t r = limits.maxModelSwapFaces; r < order.size(); r++) {
+            modelSwapAllowed[order[r]] = false;
+        }
+    }
+    
+    // Independent per-face work (align, embed, swap, restore, mask), spread
+    // over the face workers when there is more than one face
+    std::vector<FaceWork> work(faces.rows);
+    std::vector<char> faceOk(faces.rows, 0);
+    for (int i = 0; i < faces.rows; i++) {
+        int trackId = i < static_cast<int>(analysis.trackIds.size()) ? analysis.trackIds[i] : -1;
+        auto it = trackIdentities.find(trackId);
+        if (it != trackIdentities.end()) {
+            work[i].identityKnown = true;
+            work[i].rule = it->second.rule;
+        }
+    }
+    bool parallel = faceWorkers && faces.rows > 1;
+    
+    if (parallel) {
+        uint64_t traceFrame = TraceRecorder::getThreadFrame();
+        faceWorkers->parallelFor(faces.rows, [&](size_t i, size_t worker) {
+            TraceFrame frameTag(traceFrame);
+            faceOk[i] = processFace(analysis, source.get(), *bank, static_cast<int>(i),
+                                    modelSwapAllowed[i], workerContexts[worker], work[i]);
+        });
+    } else {
+        for (int i = 0; i < faces.rows; i++) {
+            faceOk[i] = processFace(analysis, source.get(), *bank, i, modelSwapAllowed[i], inference, work[i]);
+        }
+    }
+    
+    // Remember newly matched identities for the following frames
+    for (const FaceWork& face : work) {
+        if (face.identityMatched && face.trackId >= 0) {
+            trackIdentities[face.trackId] = TrackIdentity{bank->version, face.rule};
+        }
+    }
+    
+    // Ordered part: stabilization history is shared by all faces, so it is
+    // applied in detection order exactly as in the serial pipeline
     for (int i = 0; i < faces.rows; i++) {
-        float x = faces.at<float>(i, 0);
-        float y = faces.at<float>(i, 1);
-        float w = faces.at<float>(i, 2);
-        float h = faces.at<float>(i, 3);
+        if (!faceOk[i]) continue;
+        FaceWork& face = work[i];
+        TraceTrack trackTag(face.trackId);
         
-        cv::Rect faceRect(
-            std::max(0, static_cast<int>(x)),
-            std::max(0, static_cast<int>(y)),
-            std::min(processedFrame.cols - static_cast<int>(x), static_cast<int>(w)),
-            std::min(processedFrame.rows - static_cast<int>(y), static_cast<int>(h))
-        );
+        // Concurrent faces overlap, so the slowest one is what the frame waits for
+        if (parallel) {
+            timings.swapMs = std::max(timings.swapMs, face.timings.swapMs);
+            timings.restoreMs = std::max(timings.restoreMs, face.timings.restoreMs);
+            timings.blendMs = std::max(timings.blendMs, face.timings.blendMs);
+        } else {
+            timings.swapMs += face.timings.swapMs;
+            timings.restoreMs += face.timings.restoreMs;
+            timings.blendMs += face.timings.blendMs;
+        }
         
-        if (faceRect.width <= 0 || faceRect.height <= 0) continue;
+        if (face.modelSwap) {
+            timings.modelSwaps++;
+        } else {
+            timings.fallbackSwaps++;
+        }
         
-        // Extract landmarks
-        std::vector<cv::Point2f> targetLandmarks = extractLandmarks(faces, i);
-        if (targetLandmarks.empty()) continue;
+        // 5. Temporal stabilization
+        if (useTemporalStabilization && limits.allowStabilization) {
+            ScopedStageTimer timer(timings.stabilizeMs, ProfileStage::Stabilize);
+            face.face = stabilizeFace(face.face, face.landmarks);
+            
+            // Update history
+            previousFaces.push_back(face.face.clone());
+            previousLandmarks.push_back(face.landmarks);
+            if (previousFaces.size() > MAX_HISTORY) {
+                previousFaces.pop_front();
+                previousLandmarks.pop_front();
+            }
+        }
         
-        // === FULL PIPELINE ===
+        results.push_back({face.faceRect, face.face, face.mask, face.trackId});
+    }
+    
+    // Per-face-count wall time of this stage, for the scaling report
+    if (faces.rows > 0 && faces.rows < static_cast<int>(faceScaling.size())) {
+        FaceScalingSample& sample = faceScaling[faces.rows];
+        sample.frames++;
+        sample.totalMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    
+    return results;
+}
+
+bool AdvancedFaceSwapper::processFace(const FrameAnalysis& analysis, const SourceFace* defaultSource,
+                                      const SourceBankSnapshot& bank, int faceIndex, bool allowModelSwap,
+                                      InferenceContext& context, FaceWork& work) {
+    const cv::Mat& processedFrame = analysis.processedFrame;
+    const cv::Mat& faces = analysis.faces;
+    const QualitySettings& limits = analysis.quality;
+    const bool arcFaceLoaded = engine->hasArcFace();
+    const bool inSwapperLoaded = engine->hasInSwapper();
+    
+    work.trackId = faceIndex < static_cast<int>(analysis.trackIds.size()) ? analysis.trackIds[faceIndex] : -1;
+    TraceTrack trackTag(work.trackId);
+    
+    float x = faces.at<float>(faceIndex, 0);
+    float y = faces.at<float>(faceIndex, 1);
+    float w = faces.at<float>(faceIndex, 2);
+    float h = faces.at<float>(faceIndex, 3);
+    
+    cv::Rect faceRect(
+        std::max(0, static_cast<int>(x)),
+        std::max(0, static_cast<int>(y)),
+        std::min(processedFrame.cols - static_cast<int>(x), static_cast<int>(w)),
+        std::min(processedFrame.rows - static_cast<int>(y), static_cast<int>(h))
+    );
+    
+    if (faceRect.width <= 0 || faceRect.height <= 0) return false;
+    
+    // Extract landmarks
+    std::vector<cv::Point2f> targetLandmarks = FaceSwapEngine::extractLandmarks(faces, faceIndex);
+    if (targetLandmarks.empty()) return false;
+    
+    // === FULL PIPELINE ===
+    
+    cv::Mat swappedFace;
+    bool useModelSwap = false;
+    {
+        ScopedStageTimer swapTimer(work.timings.swapMs);
         
         // 1. Align target face
-        cv::Mat targetFaceAligned = alignFace(processedFrame, targetLandmarks, faceRect, 512);
-        if (targetFaceAligned.empty()) continue;
+        cv::Mat targetFaceAligned;
+        {
+            ScopedProfile profile(ProfileStage::Align);
+            targetFaceAligned = FaceSwapEngine::alignFace(processedFrame, targetLandmarks, faceRect, 512);
+        }
+        if (targetFaceAligned.empty()) return false;
         
-        // 2. Extract target face embedding (if using model-based swap)
-        cv::Mat targetEmbedding;
-        if (arcFaceLoaded) {
-            targetEmbedding = extractFaceEmbedding(targetFaceAligned);
+        // 2. Identify the target (once per track) to pick its source face
+        if (bank.hasRules() && !work.identityKnown && arcFaceLoaded) {
+            cv::Mat targetEmbedding;
+            {
+                ScopedProfile profile(ProfileStage::Embed);
+                targetEmbedding = FaceSwapEngine::extractFaceEmbedding(targetFaceAligned, context);
+            }
+            if (!targetEmbedding.empty()) {
+                work.rule = bank.match(targetEmbedding);
+                work.identityKnown = true;
+                work.identityMatched = true;
+            }
         }
+        const SourceFace* faceSource = defaultSource;
+        if (work.rule >= 0 && work.rule < static_cast<int>(bank.ruleSources.size())) {
+            faceSource = bank.ruleSources[work.rule].get();
+        }
+        if (!faceSource) {
+            // No rule for this face and no default source: leave it untouched
+            return false;
+        }
+        const SourceFace& source = *faceSource;
         
         // 3. Swap face using INSwapper model or fallback
-        cv::Mat swappedFace;
-        bool useModelSwap = false;
         
         // Only try INSwapper if we have both the model AND the source embedding
         // (embedding requires ArcFace model)
-        if (inSwapperLoaded && arcFaceLoaded && !sourceFaceEmbedding.empty()) {
-            swappedFace = swapFaceWithModel(targetFaceAligned, sourceFaceEmbedding);
+        if (!allowModelSwap) {
+            // Over the quality limit for model swaps this frame - geometric fallback
+        } else if (inSwapperLoaded && arcFaceLoaded && !source.latent.empty()) {
+            swappedFace = swapFaceWithModel(targetFaceAligned, source.latent, context);
             if (!swappedFace.empty()) {
                 useModelSwap = true;
             }
         } else if (inSwapperLoaded && !arcFaceLoaded) {
             // INSwapper requires ArcFace for embeddings - use fallback
-            static bool warned = false;
-            if (!warned) {
-                std::cerr << "Note: INSwapper model loaded but ArcFace model not found." << std::endl;
-                std::cerr << "INSwapper requires ArcFace for face embeddings. Using geometric fallback." << std::endl;
-                std::cerr << "For best results, download ArcFace model: ./download_models.sh" << std::endl;
-                warned = true;
+            if (engine->claimWarning(FaceSwapEngine::Warning::InSwapperWithoutArcFace)) {
+                LOG_WARN("INSwapper model loaded but ArcFace model not found. INSwapper requires ArcFace "
+                         << "for face embeddings, using geometric fallback. For best results, download "
+                         << "the ArcFace model: ./download_models.sh");
             }
-        } else if (inSwapperLoaded && arcFaceLoaded && sourceFaceEmbedding.empty()) {
+        } else if (inSwapperLoaded && arcFaceLoaded && source.latent.empty()) {
             // ArcFace loaded but couldn't extract embedding
-            static bool warnedEmbedding = false;
-            if (!warnedEmbedding) {
-                std::cerr << "Warning: Could not extract source face embedding from ArcFace model." << std::endl;
-                std::cerr << "Using geometric fallback method." << std::endl;
-                warnedEmbedding = true;
+            if (engine->claimWarning(FaceSwapEngine::Warning::SourceWithoutEmbedding)) {
+                LOG_WARN("Could not extract source face embedding from ArcFace model. Using geometric fallback method.");
             }
         }
         
@@ -737,16 +939,16 @@ void AdvancedFaceSwapper::detectAndSwap(cv::Mat& frame) {
         if (!useModelSwap) {
             // Get source landmarks relative to source face rect
             std::vector<cv::Point2f> sourcePoints;
-            if (sourceLandmarks.size() >= 3) {
+            if (source.landmarks.size() >= 3) {
                 // Take first 3 landmarks
-                sourcePoints.push_back(cv::Point2f(sourceLandmarks[0].x - sourceFaceRect.x, 
-                                                   sourceLandmarks[0].y - sourceFaceRect.y));
-                sourcePoints.push_back(cv::Point2f(sourceLandmarks[1].x - sourceFaceRect.x, 
-                                                   sourceLandmarks[1].y - sourceFaceRect.y));
-                sourcePoints.push_back(cv::Point2f(sourceLandmarks[2].x - sourceFaceRect.x, 
-                                                   sourceLandmarks[2].y - sourceFaceRect.y));
+                sourcePoints.push_back(cv::Point2f(source.landmarks[0].x - source.faceRect.x, 
+                                                   source.landmarks[0].y - source.faceRect.y));
+                sourcePoints.push_back(cv::Point2f(source.landmarks[1].x - source.faceRect.x, 
+                                                   source.landmarks[1].y - source.faceRect.y));
+                sourcePoints.push_back(cv::Point2f(source.landmarks[2].x - source.faceRect.x, 
+                                                   source.landmarks[2].y - source.faceRect.y));
             }
-            
+        
             // Get target landmarks relative to target face rect
             std::vector<cv::Point2f> targetPoints;
             if (targetLandmarks.size() >= 3) {
@@ -758,18 +960,18 @@ void AdvancedFaceSwapper::detectAndSwap(cv::Mat& frame) {
                 targetPoints.push_back(cv::Point2f(targetLandmarks[2].x - faceRect.x, 
                                                    targetLandmarks[2].y - faceRect.y));
             }
-            
+        
             // Validate points
             if (sourcePoints.size() != 3 || targetPoints.size() != 3) {
-                std::cerr << "Error: Need exactly 3 landmark points for affine transform. Got source=" 
-                          << sourcePoints.size() << ", target=" << targetPoints.size() << std::endl;
-                continue;
+                LOG_ERROR("Need exactly 3 landmark points for affine transform. Got source=" 
+                       << sourcePoints.size() << ", target=" << targetPoints.size());
+                return false;
             }
-            
+        
             // Check points are valid (not zero or negative)
             bool sourceValid = true, targetValid = true;
             for (const auto& pt : sourcePoints) {
-                if (pt.x < 0 || pt.y < 0 || pt.x > sourceFaceRect.width || pt.y > sourceFaceRect.height) {
+                if (pt.x < 0 || pt.y < 0 || pt.x > source.faceRect.width || pt.y > source.faceRect.height) {
                     sourceValid = false;
                     break;
                 }
@@ -780,47 +982,49 @@ void AdvancedFaceSwapper::detectAndSwap(cv::Mat& frame) {
                     break;
                 }
             }
-            
+        
             if (!sourceValid || !targetValid) {
-                std::cerr << "Error: Landmark points out of bounds. sourceValid=" << sourceValid 
-                          << ", targetValid=" << targetValid << std::endl;
-                continue;
+                LOG_ERROR("Landmark points out of bounds. sourceValid=" << sourceValid 
+                       << ", targetValid=" << targetValid);
+                return false;
             }
-            
+        
             // Validate source face region
-            if (sourceFaceRect.x < 0 || sourceFaceRect.y < 0 ||
-                sourceFaceRect.x + sourceFaceRect.width > sourceFaceImage.cols ||
-                sourceFaceRect.y + sourceFaceRect.height > sourceFaceImage.rows) {
-                std::cerr << "Error: Source face rect out of bounds" << std::endl;
-                continue;
+            if (source.faceRect.x < 0 || source.faceRect.y < 0 ||
+                source.faceRect.x + source.faceRect.width > source.image.cols ||
+                source.faceRect.y + source.faceRect.height > source.image.rows) {
+                LOG_ERROR("Source face rect out of bounds");
+                return false;
             }
-            
+        
             // Extract source face region
-            cv::Mat sourceROI = sourceFaceImage(sourceFaceRect);
+            cv::Mat sourceROI = source.image(source.faceRect);
             if (sourceROI.empty()) {
-                std::cerr << "Error: Could not extract source face ROI" << std::endl;
-                continue;
+                LOG_ERROR("Could not extract source face ROI");
+                return false;
             }
-            
+        
             try {
+                ScopedProfile profile(ProfileStage::Swap);
+                
                 // Calculate affine transformation
                 cv::Mat transform = cv::getAffineTransform(sourcePoints, targetPoints);
-                
+            
                 if (transform.empty()) {
-                    std::cerr << "Error: Could not calculate affine transformation" << std::endl;
-                    continue;
+                    LOG_ERROR("Could not calculate affine transformation");
+                    return false;
                 }
-                
+            
                 // Warp source face to match target
                 cv::Mat tempSwapped;
                 cv::warpAffine(sourceROI, tempSwapped, transform, faceRect.size());
-                
+            
                 // Validate and ensure proper format
                 if (tempSwapped.empty()) {
-                    std::cerr << "Error: Warped face is empty" << std::endl;
-                    continue;
+                    LOG_ERROR("Warped face is empty");
+                    return false;
                 }
-                
+            
                 // Ensure it's 8-bit BGR
                 if (tempSwapped.type() != CV_8UC3) {
                     if (tempSwapped.channels() == 1) {
@@ -832,71 +1036,68 @@ void AdvancedFaceSwapper::detectAndSwap(cv::Mat& frame) {
                         tempSwapped.convertTo(tempSwapped, CV_8U);
                     }
                 }
-                
+            
                 swappedFace = tempSwapped;
             } catch (const cv::Exception& e) {
-                std::cerr << "Error in geometric transformation: " << e.what() << std::endl;
-                continue;
+                LOG_ERROR("Error in geometric transformation: " << e.what());
+                return false;
             }
         }
-        
-        // 4. Face restoration with GFPGAN
-        if (swappedFace.empty()) {
-            std::cerr << "Warning: swappedFace is empty, skipping this face" << std::endl;
-            continue;
-        }
-        
-        if (enableGFPGAN && gfpganLoaded) {
-            swappedFace = restoreFace(swappedFace);
-        }
-        
-        // 5. Temporal stabilization
-        if (useTemporalStabilization) {
-            swappedFace = stabilizeFace(swappedFace, targetLandmarks);
-            
-            // Update history
-            previousFaces.push_back(swappedFace.clone());
-            previousLandmarks.push_back(targetLandmarks);
-            if (previousFaces.size() > MAX_HISTORY) {
-                previousFaces.pop_front();
-                previousLandmarks.pop_front();
-            }
-        }
-        
-        // 6. Generate mask
-        std::vector<cv::Point2f> targetLandmarksRelative = targetLandmarks;
-        for (auto& pt : targetLandmarksRelative) {
-            pt.x -= faceRect.x;
-            pt.y -= faceRect.y;
-        }
-        cv::Mat mask = generateFaceMask(faceRect.size(), targetLandmarksRelative);
-        
-        if (mask.empty()) {
-            std::cerr << "Warning: mask is empty, skipping blending" << std::endl;
-            continue;
-        }
-        
-        // 7. Seamless blending
-        frame = blendFace(swappedFace, frame, faceRect, mask);
     }
-    } catch (const cv::Exception& e) {
-        std::cerr << "Exception in detectAndSwap: " << e.what() << std::endl;
-    } catch (const std::exception& e) {
-        std::cerr << "Standard exception in detectAndSwap: " << e.what() << std::endl;
-    } catch (...) {
-        std::cerr << "Unknown exception in detectAndSwap" << std::endl;
+    
+    // 4. Face restoration with GFPGAN
+    if (swappedFace.empty()) {
+        LOG_WARN("swappedFace is empty, skipping this face");
+        return false;
+    }
+    
+    work.modelSwap = useModelSwap;
+    
+    if (enableGFPGAN && engine->hasGFPGAN() && limits.allowRestoration) {
+        ScopedStageTimer timer(work.timings.restoreMs, ProfileStage::Restore);
+        swappedFace = restoreFace(swappedFace);
+    }
+    
+    // 6. Generate mask
+    ScopedStageTimer maskTimer(work.timings.blendMs, ProfileStage::Mask);
+    std::vector<cv::Point2f> targetLandmarksRelative = targetLandmarks;
+    for (auto& pt : targetLandmarksRelative) {
+        pt.x -= faceRect.x;
+        pt.y -= faceRect.y;
+    }
+    cv::Mat mask = generateFaceMask(faceRect.size(), targetLandmarksRelative);
+    
+    if (mask.empty()) {
+        LOG_WARN("mask is empty, skipping blending");
+        return false;
+    }
+    
+    work.faceRect = faceRect;
+    work.landmarks = targetLandmarks;
+    work.face = swappedFace;
+    work.mask = mask;
+    return true;
+}
+
+void AdvancedFaceSwapper::compositeFaces(cv::Mat& frame, const std::vector<SwappedFace>& faces, FrameTimings& timings) {
+    ScopedStageTimer timer(timings.blendMs, ProfileStage::Blend);
+    
+    // 7. Seamless blending
+    for (const SwappedFace& face : faces) {
+        frame = blendFace(face.face, frame, face.faceRect, face.mask);
     }
 }
 
-std::vector<cv::Point2f> AdvancedFaceSwapper::getFacePoints(const std::vector<cv::Point2f>& landmarks) {
+std::vector<cv::Point2f> AdvancedFaceSwapper::getFacePoints(const std::vector<cv::Point2f>& landmarks,
+                                                             const cv::Rect& faceRect) {
     std::vector<cv::Point2f> points;
     if (landmarks.size() >= 3) {
-        points.push_back(cv::Point2f(landmarks[0].x - sourceFaceRect.x, 
-                                     landmarks[0].y - sourceFaceRect.y));
-        points.push_back(cv::Point2f(landmarks[1].x - sourceFaceRect.x, 
-                                     landmarks[1].y - sourceFaceRect.y));
-        points.push_back(cv::Point2f(landmarks[2].x - sourceFaceRect.x, 
-                                     landmarks[2].y - sourceFaceRect.y));
+        points.push_back(cv::Point2f(landmarks[0].x - faceRect.x, 
+                                     landmarks[0].y - faceRect.y));
+        points.push_back(cv::Point2f(landmarks[1].x - faceRect.x, 
+                                     landmarks[1].y - faceRect.y));
+        points.push_back(cv::Point2f(landmarks[2].x - faceRect.x, 
+                                     landmarks[2].y - faceRect.y));
     }
     return points;
 }
@@ -4,34 +4,136 @@
 #include <opencv2/opencv.hpp>
 #include <opencv2/objdetect.hpp>
 #include <opencv2/dnn.hpp>
+#include "FaceSwapEngine.hpp"
+#include "RuntimeSettings.hpp"
+#include "SourceBank.hpp"
 #include <string>
 #include <vector>
 #include <deque>
+#include <atomic>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
 
+// Per-frame stage timings in milliseconds, filled in by detectAndSwap()
+struct FrameTimings {
+    double preprocessMs = 0.0;
+    double detectMs = 0.0;
+    double swapMs = 0.0;        // alignment + embedding + model or geometric swap
+    double restoreMs = 0.0;
+    double stabilizeMs = 0.0;
+    double blendMs = 0.0;       // mask generation + blending
+    double totalMs = 0.0;
+    bool detectionRan = false;
+    int modelSwaps = 0;
+    int fallbackSwaps = 0;
+};
+
+// Runtime quality limits (normally driven by QualityGovernor). These only
+// ever remove work: restoration and stabilization still need to be enabled
+// by the user to run.
+struct QualitySettings {
+    int detectionInterval = 1;      // run the detector every N frames
+    float detectionScale = 1.0f;    // detector input size relative to the frame
+    bool allowRestoration = true;
+    bool allowStabilization = true;
+    int maxModelSwapFaces = -1;     // larger faces first; the rest use geometric fallback (-1 = all)
+    bool basicMode = false;         // hand frames to the lightweight FaceSwapper (see ProcessorSelector)
+};
+
+// Output of the detection stage for one frame
+struct FrameAnalysis {
+    cv::Mat processedFrame;
+    cv::Mat faces;              // YuNet rows in full-frame coordinates
+    std::vector<int> trackIds;  // per face row, stable across frames by box overlap
+    QualitySettings quality;    // limits in effect for this frame
+};
+
+// A swapped face ready to be composited into its frame
+struct SwappedFace {
+    cv::Rect faceRect;
+    cv::Mat face;
+    cv::Mat mask;
+    int trackId = -1;
+};
+
+class ThreadPool;
+
+// One stream's face swapping: its detector and networks, face tracks,
+// stabilization history, settings and statistics. Models and source faces
+// come from a FaceSwapEngine that any number of swappers can share, each
+// running on its own thread without locking the others out.
 class AdvancedFaceSwapper {
+    // Drives the private pipeline steps in isolation (bench/)
+    friend class StageBenchmark;
+    
 public:
+    // With an engine of its own, loaded through the load*() calls below
     AdvancedFaceSwapper();
+    // On a shared, already loaded engine. `inferenceStream` is this
+    // swapper's stream on the engine's InferenceScheduler, if it has one.
+    explicit AdvancedFaceSwapper(std::shared_ptr<FaceSwapEngine> engine, int inferenceStream = -1);
     ~AdvancedFaceSwapper();
     
-    // Load models
+    const std::shared_ptr<FaceSwapEngine>& getEngine() const { return engine; }
+    
+    // Load models into the engine and pick them up here. Other swappers on
+    // the same engine only see models loaded before they were created.
     bool loadFaceDetectionModel(const std::string& modelPath);
     bool loadArcFaceModel(const std::string& modelPath);
     bool loadInSwapperModel(const std::string& modelPath);
-    bool loadGFPGANModel(const std::string& modelPath);
+    bool loadGFPGANModel(const std::string& modelPath) { return engine->loadGFPGANModel(modelPath); }
     
-    // Load source face image for swapping
+    // Load source face image for swapping (prepare + publish on the caller)
     bool loadSourceFace(const std::string& imagePath);
     bool loadSourceFace(const cv::Mat& image);
     
-    // Check if source face is loaded
-    bool isSourceFaceLoaded() const { return sourceFaceLoaded; }
+    // Source faces live in the engine, so every swapper on it uses the same
+    // ones (see FaceSwapEngine)
+    std::shared_ptr<const SourceFace> prepareSourceFace(const cv::Mat& image) {
+        return engine->prepareSourceFace(image);
+    }
+    std::shared_ptr<const SourceFace> restoreSourceFace(const cv::Mat& image, const cv::Rect& faceRect,
+                                                        const std::vector<cv::Point2f>& landmarks,
+                                                        const cv::Mat& embedding) {
+        return engine->restoreSourceFace(image, faceRect, landmarks, embedding);
+    }
+    void setSourceFace(std::shared_ptr<const SourceFace> source) { engine->setSourceFace(std::move(source)); }
+    std::shared_ptr<const SourceFace> getSourceFace() const { return engine->getSourceFace(); }
+    bool isSourceFaceLoaded() const { return engine->hasSourceFace(); }
+    uint64_t getSourceGeneration() const { return engine->getSourceGeneration(); }
+    std::string getArcFaceModelPath() const { return engine->getArcFaceModelPath(); }
+    
+    // Per-identity sources. Faces matching a rule get that rule's source,
+    // all others the source face above. Safe to modify while frames run.
+    SourceBank& getSourceBank() { return engine->getSourceBank(); }
     
-    // Perform face swapping on frame (full pipeline)
-    void detectAndSwap(cv::Mat& frame);
+    // Perform face swapping on frame (full pipeline). With `knownFaces`
+    // (YuNet rows, e.g. from a session recording) the detector is skipped.
+    void detectAndSwap(cv::Mat& frame, const cv::Mat* knownFaces = nullptr);
+    
+    // The three stages detectAndSwap() runs in order. FramePipeline runs them
+    // on separate threads for consecutive frames; each stage must only be
+    // called from one thread at a time.
+    bool isReadyToSwap() const {
+        return !faceDetector.empty() && (isSourceFaceLoaded() || engine->getSourceBank().hasRules());
+    }
+    FrameAnalysis analyzeFrame(const cv::Mat& frame, FrameTimings& timings, const cv::Mat* knownFaces = nullptr);
+    std::vector<SwappedFace> swapFaces(const FrameAnalysis& analysis, FrameTimings& timings);
+    void compositeFaces(cv::Mat& frame, const std::vector<SwappedFace>& faces, FrameTimings& timings);
+    
+    // Forget face tracks, cached identities, stabilization history and the
+    // held detections, as if the next frame were the first (e.g. after a seek)
+    void resetTemporalState();
     
     // Get the number of faces detected in the last frame
     int getFaceCount() const { return lastFaceCount; }
     
+    // Detector output used for the most recent frame (YuNet rows)
+    const cv::Mat& getLastDetections() const { return lastDetections; }
+    
     // Settings
     void setBlendStrength(float strength);
     float getBlendStrength() const { return blendStrength; }
@@ -42,53 +144,118 @@ public:
     void setTemporalStabilization(bool enable) { useTemporalStabilization = enable; }
     bool getTemporalStabilization() const { return useTemporalStabilization; }
     
+    // Blend strength, stabilization and GFPGAN in one go
+    void applyRuntimeSettings(const RuntimeSettings& settings);
+    
     void setStabilizationStrength(float strength) { stabilizationStrength = std::max(0.0f, std::min(1.0f, strength)); }
     float getStabilizationStrength() const { return stabilizationStrength; }
+    
+    // Quality limits applied on top of the user settings
+    void setQualitySettings(const QualitySettings& settings);
+    const QualitySettings& getQualitySettings() const { return quality; }
+    
+    // Stage timings of the most recent detectAndSwap() call
+    const FrameTimings& getLastFrameTimings() const { return lastTimings; }
+    
+    // Process the faces of a frame concurrently on `count` workers, each with
+    // its own copy of the networks, or its own requests to the engine's
+    // scheduler (call after loading models; 1 = serial).
+    bool setFaceWorkers(int count);
+    int getFaceWorkerCount() const;
+    
+    // Average swap stage wall time per frame for 1-8 faces
+    void printFaceScalingReport(std::ostream& os) const;
 
 private:
-    // Models
+    std::shared_ptr<FaceSwapEngine> engine;
+    int inferenceStream;
+    
+    // This swapper's own detector and networks (serial path and face worker 0)
     cv::Ptr<cv::FaceDetectorYN> faceDetector;
-    cv::dnn::Net arcFaceNet;
-    cv::dnn::Net inSwapperNet;
-    cv::dnn::Net gfpganNet;
-    
-    bool arcFaceLoaded;
-    bool inSwapperLoaded;
-    bool gfpganLoaded;
-    
-    // Source face data
-    cv::Mat sourceFaceImage;
-    cv::Mat sourceFaceAligned;
-    std::vector<cv::Point2f> sourceLandmarks;
-    cv::Rect sourceFaceRect;
-    cv::Mat sourceFaceEmbedding;
-    bool sourceFaceLoaded;
+    InferenceContext inference;
+    
+    // Per-face workers and their private networks
+    std::unique_ptr<ThreadPool> faceWorkers;
+    std::vector<InferenceContext> workerContexts;
+    
+    // Bank rule matched by each live track (-1 = none), so a target's
+    // embedding is computed once per track rather than every frame.
+    // Entries from an older bank version are re-matched. Swap stage only.
+    struct TrackIdentity {
+        uint64_t bankVersion = 0;
+        int rule = -1;
+    };
+    std::unordered_map<int, TrackIdentity> trackIdentities;
+    
+    // The engine's source face and bank snapshot as of the last frame,
+    // reloaded only when their generation or version moves. Swap stage only.
+    std::shared_ptr<const SourceFace> frameSource;
+    uint64_t frameSourceGeneration;
+    std::shared_ptr<const SourceBankSnapshot> frameBank;
     
     // Face swapping parameters
     float blendStrength;
     bool enableGFPGAN;
     bool useTemporalStabilization;
     float stabilizationStrength;
-    int lastFaceCount;
+    std::atomic<int> lastFaceCount;
+    
+    // Quality limits and per-frame bookkeeping
+    QualitySettings quality;
+    FrameTimings lastTimings;
+    cv::Mat lastDetections;
+    int framesUntilDetection;
+    
+    // Swap stage wall time by face count (index = faces, 1-8)
+    struct FaceScalingSample {
+        uint64_t frames = 0;
+        double totalMs = 0.0;
+    };
+    std::array<FaceScalingSample, 9> faceScaling;
+    
+    // Face tracks of the previous frame (ID, box), for assignTrackIds()
+    std::vector<std::pair<int, cv::Rect2f>> trackedFaces;
+    int nextTrackId;
     
     // Temporal stabilization buffers
     std::deque<cv::Mat> previousFaces;
     std::deque<std::vector<cv::Point2f>> previousLandmarks;
     static const int MAX_HISTORY = 5;
     
-    // Pipeline steps
-    std::vector<cv::Point2f> extractLandmarks(const cv::Mat& faces, int faceIndex);
+    // Result of the independent per-face part of swapFaces()
+    struct FaceWork {
+        cv::Rect faceRect;
+        std::vector<cv::Point2f> landmarks;
+        cv::Mat face;
+        cv::Mat mask;
+        bool modelSwap = false;
+        int trackId = -1;
+        bool identityKnown = false;     // rule below is valid (cached or matched)
+        bool identityMatched = false;   // matched in this frame, to be cached
+        int rule = -1;
+        FrameTimings timings;
+    };
+    bool processFace(const FrameAnalysis& analysis, const SourceFace* defaultSource,
+                     const SourceBankSnapshot& bank, int faceIndex, bool allowModelSwap,
+                     InferenceContext& context, FaceWork& work);
+    
+    // Match faces to the previous frame's tracks by box overlap
+    std::vector<int> assignTrackIds(const cv::Mat& faces);
+    
+    // Pipeline steps (landmarks, alignment and embedding: see FaceSwapEngine)
     cv::Mat preprocessFrame(const cv::Mat& frame);
-    cv::Mat alignFace(const cv::Mat& image, const std::vector<cv::Point2f>& landmarks, const cv::Rect& faceRect, int outputSize = 512);
-    cv::Mat extractFaceEmbedding(const cv::Mat& alignedFace);
-    cv::Mat swapFaceWithModel(const cv::Mat& targetFace, const cv::Mat& sourceEmbedding);
+    cv::Mat detectFaces(const cv::Mat& image);
+    cv::Mat swapFaceWithModel(const cv::Mat& targetFace, const cv::Mat& sourceEmbedding, InferenceContext& context);
+    bool prepareSwapInputs(const cv::Mat& targetFace, const cv::Mat& sourceEmbedding,
+                           cv::Mat& faceBlob, cv::Mat& embeddingInput);
+    cv::Mat decodeSwapOutput(const cv::Mat& swapped);
     cv::Mat restoreFace(const cv::Mat& swappedFace);
     cv::Mat generateFaceMask(const cv::Size& size, const std::vector<cv::Point2f>& landmarks);
     cv::Mat blendFace(const cv::Mat& swappedFace, const cv::Mat& originalFrame, const cv::Rect& faceRect, const cv::Mat& mask);
     cv::Mat stabilizeFace(const cv::Mat& currentFace, const std::vector<cv::Point2f>& currentLandmarks);
     
     // Helper functions
-    std::vector<cv::Point2f> getFacePoints(const std::vector<cv::Point2f>& landmarks);
+    std::vector<cv::Point2f> getFacePoints(const std::vector<cv::Point2f>& landmarks, const cv::Rect& faceRect);
     cv::Mat normalizeImage(const cv::Mat& image);
     cv::Mat denormalizeImage(const cv::Mat& image);
 };
@@ -0,0 +1,244 @@
+#include "AllocationTracker.hpp"
+#include <sys/resource.h>
+
+uint64_t AllocationTracker::peakRssBytes() {
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    // ru_maxrss is in kilobytes on Linux
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+}
+
+#ifdef FACESWAP_ALLOC_TRACKING
+
+#include "StageProfiler.hpp"
+#include <opencv2/core.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <mutex>
+#include <new>
+
+namespace {
+// One slot per stage plus one for allocations outside any stage
+const size_t kSlots = static_cast<size_t>(ProfileStage::Count) + 1;
+const int kNoStage = static_cast<int>(ProfileStage::Count);
+
+struct Counter {
+    std::atomic<uint64_t> allocations{0};
+    std::atomic<uint64_t> bytes{0};
+};
+
+// Constant-initialized, so usable by operator new before main()
+Counter stageCounters[kSlots];
+thread_local int threadStage = kNoStage;
+
+void noteAllocation(size_t bytes) {
+    Counter& counter = stageCounters[threadStage];
+    counter.allocations.fetch_add(1, std::memory_order_relaxed);
+    counter.bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+// Per-frame tallies, updated by endFrame()
+struct FrameStats {
+    std::mutex mutex;
+    uint64_t frames = 0;
+    uint64_t zeroFrames = 0;
+    uint64_t maxAllocations = 0;
+    uint64_t maxBytes = 0;
+    AllocationTracker::Counts frameStart;
+    AllocationTracker::Counts firstFrameStart;
+    bool started = false;
+};
+
+FrameStats& frameStats() {
+    static FrameStats stats;
+    return stats;
+}
+
+// cv::Mat buffers come from cv::fastMalloc, not operator new; count them by
+// wrapping the allocator OpenCV uses for new Mats
+class CountingMatAllocator : public cv::MatAllocator {
+public:
+    explicit CountingMatAllocator(cv::MatAllocator* inner) : inner(inner) {}
+
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                           cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override {
+        cv::UMatData* u = inner->allocate(dims, sizes, type, data, step, flags, usageFlags);
+        // Wrapping user memory is not an allocation
+        if (u && !data) {
+            noteAllocation(u->size);
+        }
+        return u;
+    }
+
+    bool allocate(cv::UMatData* u, cv::AccessFlag accessFlags, cv::UMatUsageFlags usageFlags) const override {
+        return inner->allocate(u, accessFlags, usageFlags);
+    }
+
+    // The inner allocator owns what it allocated; Mats release through it directly
+    void deallocate(cv::UMatData* u) const override {
+        inner->deallocate(u);
+    }
+
+private:
+    cv::MatAllocator* inner;
+};
+
+void* countedAlloc(std::size_t size) {
+    noteAllocation(size);
+    return std::malloc(size ? size : 1);
+}
+
+void* countedAlignedAlloc(std::size_t size, std::align_val_t alignment) {
+    noteAllocation(size);
+    void* p = nullptr;
+    size_t align = std::max(static_cast<size_t>(alignment), sizeof(void*));
+    if (posix_memalign(&p, align, size ? size : 1) != 0) {
+        return nullptr;
+    }
+    return p;
+}
+}
+
+void AllocationTracker::install() {
+    static bool installed = false;
+    if (installed) {
+        return;
+    }
+    installed = true;
+    static CountingMatAllocator allocator(cv::Mat::getDefaultAllocator());
+    cv::Mat::setDefaultAllocator(&allocator);
+}
+
+AllocationTracker::Counts AllocationTracker::snapshot() {
+    Counts counts;
+    for (const Counter& counter : stageCounters) {
+        counts.allocations += counter.allocations.load(std::memory_order_relaxed);
+        counts.bytes += counter.bytes.load(std::memory_order_relaxed);
+    }
+    return counts;
+}
+
+AllocationTracker::Counts AllocationTracker::stageTotal(ProfileStage stage) {
+    Counts counts;
+    size_t index = std::min(static_cast<size_t>(stage), kSlots - 1);
+    counts.allocations = stageCounters[index].allocations.load(std::memory_order_relaxed);
+    counts.bytes = stageCounters[index].bytes.load(std::memory_order_relaxed);
+    return counts;
+}
+
+void AllocationTracker::setThreadStage(ProfileStage stage) {
+    threadStage = std::min(static_cast<int>(stage), kNoStage);
+}
+
+ProfileStage AllocationTracker::getThreadStage() {
+    return static_cast<ProfileStage>(threadStage);
+}
+
+void AllocationTracker::endFrame() {
+    FrameStats& stats = frameStats();
+    Counts now = snapshot();
+    std::lock_guard<std::mutex> lock(stats.mutex);
+    if (!stats.started) {
+        // The first call only marks where frame accounting starts
+        stats.started = true;
+        stats.frameStart = now;
+        stats.firstFrameStart = now;
+        return;
+    }
+
+    uint64_t allocations = now.allocations - stats.frameStart.allocations;
+    uint64_t bytes = now.bytes - stats.frameStart.bytes;
+    stats.frames++;
+    if (allocations == 0) {
+        stats.zeroFrames++;
+    }
+    stats.maxAllocations = std::max(stats.maxAllocations, allocations);
+    stats.maxBytes = std::max(stats.maxBytes, bytes);
+    stats.frameStart = now;
+}
+
+void AllocationTracker::printSummary(std::ostream& os) {
+    FrameStats& stats = frameStats();
+    std::lock_guard<std::mutex> lock(stats.mutex);
+    double frames = stats.frames > 0 ? static_cast<double>(stats.frames) : 1.0;
+
+    os << "\nHeap allocations (" << stats.frames << " frames):" << std::endl;
+    os << "  stage        allocs/frame    KB/frame   total_allocs    total_MB" << std::endl;
+    os << std::fixed;
+    for (size_t i = 0; i < kSlots; i++) {
+        uint64_t allocations = stageCounters[i].allocations.load(std::memory_order_relaxed);
+        uint64_t bytes = stageCounters[i].bytes.load(std::memory_order_relaxed);
+        if (allocations == 0) continue;
+        const char* name = i < kSlots - 1 ? StageProfiler::stageName(static_cast<ProfileStage>(i)) : "other";
+        os << "  " << std::left << std::setw(12) << name << std::right
+           << std::setprecision(1) << std::setw(13) << allocations / frames
+           << std::setw(12) << bytes / 1024.0 / frames
+           << std::setw(15) << allocations
+           << std::setw(12) << bytes / (1024.0 * 1024.0) << std::endl;
+    }
+
+    if (stats.frames > 0) {
+        uint64_t allocations = stats.frameStart.allocations - stats.firstFrameStart.allocations;
+        uint64_t bytes = stats.frameStart.bytes - stats.firstFrameStart.bytes;
+        os << "  Per frame: " << std::setprecision(1) << allocations / frames << " allocations ("
+           << bytes / 1024.0 / frames << " KB) on average, max " << stats.maxAllocations << " ("
+           << stats.maxBytes / 1024.0 << " KB); " << stats.zeroFrames << " of " << stats.frames
+           << " frames allocation-free" << std::endl;
+    }
+    os << "  Peak RSS: " << std::setprecision(1) << peakRssBytes() / (1024.0 * 1024.0) << " MB" << std::endl;
+}
+
+// Global allocation functions: count, then defer to malloc/free
+
+void* operator new(std::size_t size) {
+    if (void* p = countedAlloc(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    if (void* p = countedAlloc(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return countedAlloc(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return countedAlloc(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    if (void* p = countedAlignedAlloc(size, alignment)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    if (void* p = countedAlignedAlloc(size, alignment)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+#endif // FACESWAP_ALLOC_TRACKING
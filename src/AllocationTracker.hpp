@@ -0,0 +1,81 @@
+#ifndef ALLOCATION_TRACKER_HPP
+#define ALLOCATION_TRACKER_HPP
+
+#include "ProfileStage.hpp"
+#include <cstdint>
+#include <ostream>
+
+// Heap churn diagnostics, compiled in with -DALLOC_TRACKING=ON
+// (FACESWAP_ALLOC_TRACKING).
+//
+// The tracking build replaces the global operator new and installs a
+// counting cv::MatAllocator, so both C++ allocations and cv::Mat buffers are
+// counted. Each allocation is charged to the stage the allocating thread is
+// in (ScopedProfile / the swapper's stage timers set it) and to the current
+// frame. Only allocations are counted, not frees: the goal is to find stages
+// that allocate at all in steady state, not to track live memory.
+//
+// In normal builds every call here is an empty inline function.
+class AllocationTracker {
+public:
+    struct Counts {
+        uint64_t allocations = 0;
+        uint64_t bytes = 0;
+    };
+
+#ifdef FACESWAP_ALLOC_TRACKING
+    static bool isAvailable() { return true; }
+
+    // Route cv::Mat allocations through the counting allocator
+    static void install();
+
+    // Process-wide totals so far
+    static Counts snapshot();
+    static Counts stageTotal(ProfileStage stage);
+
+    // Stage charged for allocations on the calling thread (Count = none)
+    static void setThreadStage(ProfileStage stage);
+    static ProfileStage getThreadStage();
+
+    // Close the current frame's tally. Call once per frame from one thread.
+    static void endFrame();
+
+    // Per-stage and per-frame allocations plus peak RSS
+    static void printSummary(std::ostream& os);
+#else
+    static bool isAvailable() { return false; }
+    static void install() {}
+    static Counts snapshot() { return Counts(); }
+    static Counts stageTotal(ProfileStage) { return Counts(); }
+    static void setThreadStage(ProfileStage) {}
+    static ProfileStage getThreadStage() { return ProfileStage::Count; }
+    static void endFrame() {}
+    static void printSummary(std::ostream&) {}
+#endif
+
+    // Peak resident set size of the process (any build)
+    static uint64_t peakRssBytes();
+};
+
+// Charges allocations on this thread to `stage` for the lifetime of the scope
+class AllocationStage {
+public:
+#ifdef FACESWAP_ALLOC_TRACKING
+    explicit AllocationStage(ProfileStage stage) : previous(AllocationTracker::getThreadStage()) {
+        AllocationTracker::setThreadStage(stage);
+    }
+    ~AllocationStage() { AllocationTracker::setThreadStage(previous); }
+#else
+    explicit AllocationStage(ProfileStage) {}
+#endif
+
+    AllocationStage(const AllocationStage&) = delete;
+    AllocationStage& operator=(const AllocationStage&) = delete;
+
+#ifdef FACESWAP_ALLOC_TRACKING
+private:
+    ProfileStage previous;
+#endif
+};
+
+#endif // ALLOCATION_TRACKER_HPP
@@ -0,0 +1,294 @@
+#include "BatchTranscoder.hpp"
+#include "TraceRecorder.hpp"
+#include <sys/resource.h>
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <thread>
+
+namespace {
+const uint64_t kUnknownLength = std::numeric_limits<uint64_t>::max();
+
+double processCpuSeconds() {
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0.0;
+    }
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6
+         + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+}
+
+BatchTranscoder::BatchTranscoder(const BatchOptions& options)
+    : options(options)
+    , workerCount(1)
+    , totalFrames(0)
+    , chunkCount(0)
+    , bufferFrames(0)
+    , nextChunk(0)
+    , stopping(false)
+    , failed(false)
+    , nextWrite(0)
+    , endFrame(0)
+    , activeWorkers(0)
+    , written(0)
+    , wallSeconds(0.0)
+    , cpuSeconds(0.0)
+{
+    this->options.chunkFrames = std::max(1, options.chunkFrames);
+    this->options.warmupFrames = std::max(0, options.warmupFrames);
+}
+
+bool BatchTranscoder::run(const WorkerFactory& factory, const std::function<bool()>& shouldStop) {
+    cv::VideoCapture probe(options.inputPath);
+    if (!probe.isOpened()) {
+        std::cerr << "Error: Could not open input video: " << options.inputPath << std::endl;
+        return false;
+    }
+    int width = static_cast<int>(probe.get(cv::CAP_PROP_FRAME_WIDTH));
+    int height = static_cast<int>(probe.get(cv::CAP_PROP_FRAME_HEIGHT));
+    double fps = probe.get(cv::CAP_PROP_FPS);
+    double frameCount = probe.get(cv::CAP_PROP_FRAME_COUNT);
+    probe.release();
+    if (fps <= 0.0) {
+        fps = 30.0;
+    }
+
+    if (frameCount >= 1.0) {
+        totalFrames = static_cast<uint64_t>(frameCount);
+        chunkCount = (totalFrames + options.chunkFrames - 1) / options.chunkFrames;
+        int cpus = options.workers > 0 ? options.workers : static_cast<int>(std::thread::hardware_concurrency());
+        workerCount = static_cast<int>(std::min<uint64_t>(std::max(1, cpus), chunkCount));
+    } else {
+        // Streams without a reliable length can't be split
+        totalFrames = kUnknownLength;
+        chunkCount = 1;
+        workerCount = 1;
+    }
+    bufferFrames = options.bufferFrames > 0 ? static_cast<size_t>(options.bufferFrames)
+                                            : static_cast<size_t>(workerCount) * options.chunkFrames;
+
+    if (options.fourcc.size() != 4) {
+        std::cerr << "Error: Codec must be a four-character code: " << options.fourcc << std::endl;
+        return false;
+    }
+    cv::VideoWriter writer(options.outputPath,
+                           cv::VideoWriter::fourcc(options.fourcc[0], options.fourcc[1], options.fourcc[2], options.fourcc[3]),
+                           fps, cv::Size(width, height));
+    if (!writer.isOpened()) {
+        std::cerr << "Error: Could not create output video: " << options.outputPath << std::endl;
+        return false;
+    }
+
+    std::cout << "Batch: " << options.inputPath << " -> " << options.outputPath << " (" << width << "x" << height;
+    if (totalFrames != kUnknownLength) {
+        std::cout << ", " << totalFrames << " frames in " << chunkCount << " chunks";
+    }
+    std::cout << ") on " << workerCount << " workers" << std::endl;
+
+    nextChunk = 0;
+    stopping = false;
+    failed = false;
+    pending.clear();
+    nextWrite = 0;
+    endFrame = totalFrames;
+    activeWorkers = workerCount;
+    workerStats.assign(workerCount, WorkerStats());
+    written = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    double cpuStart = processCpuSeconds();
+    std::vector<std::thread> workers;
+    for (int w = 0; w < workerCount; w++) {
+        workers.emplace_back(&BatchTranscoder::workerLoop, this, w, std::cref(factory));
+    }
+
+    // Write frames in order as they become available
+    auto lastProgress = start;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        frameReady.wait_for(lock, std::chrono::milliseconds(200), [this] {
+            return failed || activeWorkers == 0 || nextWrite >= endFrame || pending.count(nextWrite) > 0;
+        });
+        if (failed || (shouldStop && shouldStop())) {
+            break;
+        }
+
+        auto it = pending.find(nextWrite);
+        if (it != pending.end()) {
+            cv::Mat frame = std::move(it->second);
+            pending.erase(it);
+            nextWrite++;
+            frameWritten.notify_all();
+            lock.unlock();
+            writer.write(frame);
+            written++;
+
+            auto now = std::chrono::steady_clock::now();
+            if (now - lastProgress >= std::chrono::seconds(5)) {
+                lastProgress = now;
+                std::cout << "  " << written;
+                if (totalFrames != kUnknownLength) {
+                    std::cout << "/" << totalFrames;
+                }
+                std::cout << " frames" << std::endl;
+            }
+            lock.lock();
+            continue;
+        }
+        if (nextWrite >= endFrame || activeWorkers == 0) {
+            break;
+        }
+    }
+    bool complete = !failed && nextWrite >= endFrame;
+    stopping = true;
+    frameWritten.notify_all();
+    lock.unlock();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    writer.release();
+    wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    cpuSeconds = processCpuSeconds() - cpuStart;
+
+    if (failed) {
+        std::cerr << "Error: Batch processing failed after " << written << " frames" << std::endl;
+        return false;
+    }
+    if (!complete) {
+        std::cerr << "Warning: Batch stopped after " << written << " frames" << std::endl;
+    }
+    return true;
+}
+
+void BatchTranscoder::workerLoop(int worker, const WorkerFactory& factory) {
+    TraceRecorder::setThreadName("batch-" + std::to_string(worker));
+    WorkerStats& stats = workerStats[worker];
+    const uint64_t chunkSize = totalFrames == kUnknownLength ? kUnknownLength
+                                                             : static_cast<uint64_t>(options.chunkFrames);
+    const uint64_t warmup = static_cast<uint64_t>(options.warmupFrames);
+
+    try {
+        std::unique_ptr<FrameProcessor> processor = factory(worker);
+        cv::VideoCapture capture(options.inputPath);
+        if (!processor || !capture.isOpened()) {
+            std::cerr << "Error: Could not set up batch worker " << worker << std::endl;
+            failed = true;
+        }
+
+        // Next frame the decoder returns; a worker that gets consecutive
+        // chunks carries its state over instead of seeking and warming up
+        uint64_t position = 0;
+        bool haveState = false;
+        while (!stopping && !failed) {
+            uint64_t chunk = nextChunk++;
+            if (chunk >= chunkCount) {
+                break;
+            }
+            uint64_t begin = chunk * chunkSize;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (begin >= endFrame) {
+                    break;
+                }
+            }
+            uint64_t end = chunkSize == kUnknownLength ? kUnknownLength : std::min(begin + chunkSize, totalFrames);
+
+            uint64_t first = begin;
+            if (!haveState || position != begin) {
+                processor->reset();
+                first = begin - std::min(begin, warmup);
+                if (position != first) {
+                    capture.set(cv::CAP_PROP_POS_FRAMES, static_cast<double>(first));
+                    stats.seeks++;
+                }
+                position = first;
+            }
+            haveState = true;
+
+            cv::Mat frame;
+            for (uint64_t index = first; index < end && !stopping; index++) {
+                auto workStart = std::chrono::steady_clock::now();
+                if (!capture.read(frame)) {
+                    markEnd(index);
+                    break;
+                }
+                position = index + 1;
+                processor->process(frame);
+                stats.busySeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - workStart).count();
+
+                if (index < begin) {
+                    stats.warmupFrames++;
+                    continue;
+                }
+                if (!deliver(index, frame)) {
+                    break;
+                }
+                stats.frames++;
+            }
+            stats.chunks++;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: Batch worker " << worker << ": " << e.what() << std::endl;
+        failed = true;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    activeWorkers--;
+    frameReady.notify_all();
+}
+
+bool BatchTranscoder::deliver(uint64_t index, cv::Mat& frame) {
+    std::unique_lock<std::mutex> lock(mutex);
+    // The writer's next frame is always admitted, so this cannot deadlock
+    frameWritten.wait(lock, [&] { return stopping || index < nextWrite + bufferFrames; });
+    if (stopping) {
+        return false;
+    }
+    // The worker decodes into a fresh buffer next time
+    pending.emplace(index, std::move(frame));
+    frame = cv::Mat();
+    frameReady.notify_one();
+    return true;
+}
+
+void BatchTranscoder::markEnd(uint64_t index) {
+    std::lock_guard<std::mutex> lock(mutex);
+    endFrame = std::min(endFrame, index);
+    frameReady.notify_one();
+}
+
+void BatchTranscoder::printSummary(std::ostream& os) const {
+    if (written == 0 || wallSeconds <= 0.0) {
+        os << "Batch: no frames written" << std::endl;
+        return;
+    }
+
+    uint64_t warmupFrames = 0;
+    uint64_t seeks = 0;
+    for (const WorkerStats& stats : workerStats) {
+        warmupFrames += stats.warmupFrames;
+        seeks += stats.seeks;
+    }
+
+    os << std::fixed << std::setprecision(1);
+    os << "Batch: " << written << " frames in " << wallSeconds << " s" << std::endl;
+    os << "  Throughput:     " << written / wallSeconds << " FPS on " << workerCount << " workers" << std::endl;
+    os << "  Per worker:     " << written / wallSeconds / workerCount << " FPS" << std::endl;
+    if (cpuSeconds > 0.0) {
+        os << "  Per core:       " << written / cpuSeconds << " FPS (" << cpuSeconds << " CPU s, "
+           << cpuSeconds / wallSeconds << " cores busy)" << std::endl;
+    }
+    os << "  Warm-up:        " << warmupFrames << " frames re-processed ("
+       << 100.0 * warmupFrames / written << "% overhead), " << seeks << " seeks" << std::endl;
+    for (size_t w = 0; w < workerStats.size(); w++) {
+        const WorkerStats& stats = workerStats[w];
+        double busyFps = stats.busySeconds > 0.0 ? (stats.frames + stats.warmupFrames) / stats.busySeconds : 0.0;
+        os << "  Worker " << std::left << std::setw(3) << w << std::right << std::setw(8) << stats.frames
+           << " frames, " << std::setw(4) << stats.chunks << " chunks, " << busyFps << " FPS while busy ("
+           << 100.0 * stats.busySeconds / wallSeconds << "% busy)" << std::endl;
+    }
+}
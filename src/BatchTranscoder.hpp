@@ -0,0 +1,93 @@
+#ifndef BATCH_TRANSCODER_HPP
+#define BATCH_TRANSCODER_HPP
+
+#include "FrameProcessor.hpp"
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct BatchOptions {
+    std::string inputPath;
+    std::string outputPath;
+    std::string fourcc = "mp4v";
+    int workers = 0;            // 0 = one per CPU
+    int chunkFrames = 32;       // frames per unit of work
+    int warmupFrames = 8;       // frames before a chunk processed only to rebuild temporal state
+    int bufferFrames = 0;       // finished frames held for reordering (0 = workers x chunkFrames)
+};
+
+// Offline transcoding of a video file for throughput rather than latency.
+//
+// The clip is split into chunks of consecutive frames. Workers take chunks
+// in order; each one seeks its own decoder to the chunk, processes the
+// warm-up frames before it (output discarded) so tracking and stabilization
+// start from a realistic state, then processes the chunk itself. Finished
+// frames go into a reorder buffer and are written in their original order by
+// the calling thread. Workers block when their frame is too far ahead of the
+// writer, so memory stays bounded by bufferFrames.
+//
+// Without a frame count from the container the clip is one chunk processed
+// by one worker.
+class BatchTranscoder {
+public:
+    // Called once on every worker thread, with the worker index. Each worker
+    // gets its own processor (own models, own temporal state); it is reset
+    // before every chunk that does not directly follow the previous one.
+    using WorkerFactory = std::function<std::unique_ptr<FrameProcessor>(int)>;
+
+    struct WorkerStats {
+        uint64_t frames = 0;
+        uint64_t warmupFrames = 0;
+        uint64_t chunks = 0;
+        uint64_t seeks = 0;
+        double busySeconds = 0.0;   // decoding + processing
+    };
+
+    explicit BatchTranscoder(const BatchOptions& options);
+
+    // Process the whole input. Blocks until the output is written, a worker
+    // fails or `shouldStop` returns true (polled by the writer).
+    bool run(const WorkerFactory& factory, const std::function<bool()>& shouldStop = nullptr);
+
+    // Throughput, frames per second per core and per-worker breakdown
+    void printSummary(std::ostream& os) const;
+
+private:
+    BatchOptions options;
+    int workerCount;
+    uint64_t totalFrames;
+    uint64_t chunkCount;
+    size_t bufferFrames;
+
+    std::atomic<uint64_t> nextChunk;
+    std::atomic<bool> stopping;
+    std::atomic<bool> failed;
+
+    // Reorder buffer
+    std::mutex mutex;
+    std::condition_variable frameReady;
+    std::condition_variable frameWritten;
+    std::map<uint64_t, cv::Mat> pending;
+    uint64_t nextWrite;
+    uint64_t endFrame;          // lowered when the input turns out shorter
+    int activeWorkers;
+
+    std::vector<WorkerStats> workerStats;
+    uint64_t written;
+    double wallSeconds;
+    double cpuSeconds;
+
+    void workerLoop(int worker, const WorkerFactory& factory);
+    bool deliver(uint64_t index, cv::Mat& frame);
+    void markEnd(uint64_t index);
+};
+
+#endif // BATCH_TRANSCODER_HPP
@@ -0,0 +1,257 @@
+#include "ControlServer.hpp"
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+namespace {
+// Longest command line accepted; a client sending more is disconnected
+const size_t kMaxLineLength = 4096;
+
+bool parseSwitch(const std::string& value, bool& enabled) {
+    if (value == "on" || value == "1" || value == "true") {
+        enabled = true;
+        return true;
+    }
+    if (value == "off" || value == "0" || value == "false") {
+        enabled = false;
+        return true;
+    }
+    return false;
+}
+
+bool sendAll(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+}
+
+ControlServer::ControlServer(RuntimeSettingsChannel& settings)
+    : settings(settings)
+    , running(false)
+    , listenFd(-1)
+{
+}
+
+ControlServer::~ControlServer() {
+    stop();
+}
+
+bool ControlServer::start(const std::string& socketPath) {
+    if (running) {
+        return true;
+    }
+
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Error: Invalid control socket path: " << socketPath << std::endl;
+        return false;
+    }
+    std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        std::cerr << "Error: Could not create control socket: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    // A socket left behind by a previous run would make bind() fail
+    struct stat info;
+    if (lstat(socketPath.c_str(), &info) == 0 && S_ISSOCK(info.st_mode)) {
+        unlink(socketPath.c_str());
+    }
+
+    // Only the owner may connect: the socket changes what goes on camera
+    mode_t previousMask = umask(0077);
+    int bound = bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    umask(previousMask);
+    if (bound < 0 || listen(listenFd, 4) < 0) {
+        std::cerr << "Error: Could not listen on " << socketPath << ": " << std::strerror(errno) << std::endl;
+        close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+
+    path = socketPath;
+    running = true;
+    listener = std::thread(&ControlServer::listenLoop, this);
+    return true;
+}
+
+void ControlServer::stop() {
+    if (!running) {
+        return;
+    }
+    running = false;
+    if (listener.joinable()) {
+        listener.join();
+    }
+    close(listenFd);
+    listenFd = -1;
+    unlink(path.c_str());
+}
+
+void ControlServer::listenLoop() {
+    while (running) {
+        // Wake up regularly so stop() does not wait on a quiet socket
+        pollfd pfd;
+        pfd.fd = listenFd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, 200) <= 0) {
+            continue;
+        }
+
+        int clientFd = accept(listenFd, nullptr, nullptr);
+        if (clientFd < 0) {
+            continue;
+        }
+        handleClient(clientFd);
+        close(clientFd);
+    }
+}
+
+void ControlServer::handleClient(int clientFd) {
+    std::string buffer;
+    char chunk[512];
+    while (running) {
+        pollfd pfd;
+        pfd.fd = clientFd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, 200) <= 0) {
+            continue;
+        }
+        ssize_t received = recv(clientFd, chunk, sizeof(chunk), 0);
+        if (received <= 0) {
+            return;
+        }
+        buffer.append(chunk, static_cast<size_t>(received));
+
+        size_t newline;
+        while ((newline = buffer.find('\n')) != std::string::npos) {
+            std::string line = buffer.substr(0, newline);
+            buffer.erase(0, newline + 1);
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (line.empty()) {
+                continue;
+            }
+            if (!sendAll(clientFd, execute(line))) {
+                return;
+            }
+        }
+        if (buffer.size() > kMaxLineLength) {
+            sendAll(clientFd, "error: line too long\n");
+            return;
+        }
+    }
+}
+
+std::string ControlServer::execute(const std::string& line) {
+    std::istringstream in(line);
+    std::string command;
+    in >> command;
+
+    if (command == "get") {
+        RuntimeSettings current = settings.get();
+        std::ostringstream out;
+        out << "blend " << current.blendStrength << "\n"
+            << "stabilization " << (current.temporalStabilization ? "on" : "off") << "\n"
+            << "gfpgan " << (current.enableGFPGAN ? "on" : "off") << "\n";
+        if (activeSourceProvider) {
+            out << "source " << activeSourceProvider() << "\n";
+        }
+        out << "ok\n";
+        return out.str();
+    }
+
+    if (command == "set") {
+        std::string name;
+        std::string value;
+        in >> name >> value;
+        if (name == "blend") {
+            float strength;
+            std::istringstream number(value);
+            if (!(number >> strength) || !number.eof() || strength < 0.0f || strength > 1.0f) {
+                return "error: blend must be between 0 and 1\n";
+            }
+            settings.update([strength](RuntimeSettings& s) { s.blendStrength = strength; });
+            return "ok\n";
+        }
+        bool enabled;
+        if ((name == "stabilization" || name == "gfpgan") && !parseSwitch(value, enabled)) {
+            return "error: " + name + " must be on or off\n";
+        }
+        if (name == "stabilization") {
+            settings.update([enabled](RuntimeSettings& s) { s.temporalStabilization = enabled; });
+            return "ok\n";
+        }
+        if (name == "gfpgan") {
+            settings.update([enabled](RuntimeSettings& s) { s.enableGFPGAN = enabled; });
+            return "ok\n";
+        }
+        return "error: unknown setting: " + name + "\n";
+    }
+
+    if (command == "source") {
+        std::string imagePath;
+        std::getline(in >> std::ws, imagePath);
+        if (imagePath.empty()) {
+            return "error: source needs an image path\n";
+        }
+        if (!sourceHandler) {
+            return "error: source faces cannot be changed in this mode\n";
+        }
+        std::string error;
+        if (!sourceHandler(imagePath, error)) {
+            return "error: " + (error.empty() ? std::string("could not load source face") : error) + "\n";
+        }
+        return "ok\n";
+    }
+
+    if (command == "source-name") {
+        std::string name;
+        std::getline(in >> std::ws, name);
+        if (name.empty()) {
+            return "error: source-name needs a source name\n";
+        }
+        if (!sourceNameHandler) {
+            return "error: source faces cannot be changed in this mode\n";
+        }
+        std::string error;
+        if (!sourceNameHandler(name, error)) {
+            return "error: " + (error.empty() ? std::string("unknown source face: " + name) : error) + "\n";
+        }
+        return "ok\n";
+    }
+
+    if (command == "stats") {
+        if (!statsProvider) {
+            return "error: no statistics available\n";
+        }
+        return statsProvider() + "ok\n";
+    }
+
+    if (command == "help") {
+        return "get\nset blend <0..1>\nset stabilization on|off\nset gfpgan on|off\nsource <image path>\n"
+               "source-name <name>\nstats\nok\n";
+    }
+
+    return "error: unknown command: " + command + "\n";
+}
@@ -0,0 +1,64 @@
+#ifndef CONTROL_SERVER_HPP
+#define CONTROL_SERVER_HPP
+
+#include "RuntimeSettings.hpp"
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+// Line-based control interface on a Unix-domain socket, for changing
+// settings of a headless (--no-preview) run from a local tool:
+//
+//   get                            current settings and active source face
+//   set blend <0..1>
+//   set stabilization on|off
+//   set gfpgan on|off
+//   source <image path>            prepare and switch to a new source face
+//   source-name <name>             switch to a source face already in the bank
+//   stats                          metrics in the Prometheus text format
+//
+// Each reply is one or more lines ending with "ok" or "error: <reason>".
+// Settings go through a RuntimeSettingsChannel, so the frame loop picks them
+// up at its next frame boundary and never waits on this thread. One client
+// is served at a time.
+class ControlServer {
+public:
+    // Runs on the control thread; returns false (with a reason) on failure
+    using SourceHandler = std::function<bool(const std::string& imagePath, std::string& error)>;
+    using SourceNameHandler = std::function<bool(const std::string& name, std::string& error)>;
+    using ActiveSourceProvider = std::function<std::string()>;
+    using StatsProvider = std::function<std::string()>;
+
+    explicit ControlServer(RuntimeSettingsChannel& settings);
+    ~ControlServer();
+
+    void setSourceHandler(SourceHandler handler) { sourceHandler = handler; }
+    void setSourceNameHandler(SourceNameHandler handler) { sourceNameHandler = handler; }
+    void setActiveSourceProvider(ActiveSourceProvider provider) { activeSourceProvider = provider; }
+    void setStatsProvider(StatsProvider provider) { statsProvider = provider; }
+
+    // Create the socket (owner-only access, a stale one is replaced) and
+    // start serving. Returns false if it cannot be bound.
+    bool start(const std::string& socketPath);
+    void stop();
+    bool isRunning() const { return running; }
+
+private:
+    RuntimeSettingsChannel& settings;
+    SourceHandler sourceHandler;
+    SourceNameHandler sourceNameHandler;
+    ActiveSourceProvider activeSourceProvider;
+    StatsProvider statsProvider;
+
+    std::atomic<bool> running;
+    int listenFd;
+    std::string path;
+    std::thread listener;
+
+    void listenLoop();
+    void handleClient(int clientFd);
+    std::string execute(const std::string& line);
+};
+
+#endif // CONTROL_SERVER_HPP
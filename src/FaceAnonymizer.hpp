@@ -5,6 +5,15 @@
 #include <opencv2/objdetect.hpp>
 #include <string>
 
+// How a face region is obscured. Only Gaussian gets slower with larger
+// kernels; the others cost the same per pixel at any intensity.
+enum class AnonymizeMode {
+    Gaussian,       // cv::GaussianBlur, kernel up to 101x101
+    BoxBlur,        // three box blur passes (running sums) approximating the Gaussian
+    Downsample,     // shrink, small blur, enlarge
+    Pixelate        // mosaic of flat blocks
+};
+
 class FaceAnonymizer {
 public:
     FaceAnonymizer();
@@ -12,17 +21,35 @@ public:
     bool loadModel(const std::string& modelPath);
     void detectAndBlur(cv::Mat& frame);
     
+    // Obscure the ellipse inscribed in faceRect (clipped to the frame)
+    void anonymizeRegion(cv::Mat& frame, const cv::Rect& faceRect);
+    
     // Set blur intensity (0.0 to 1.0, where 1.0 is maximum blur)
     void setBlurIntensity(float intensity);
     float getBlurIntensity() const { return blurIntensity; }
     
+    void setMode(AnonymizeMode newMode) { mode = newMode; }
+    AnonymizeMode getMode() const { return mode; }
+    static bool parseMode(const std::string& name, AnonymizeMode& mode);
+    static const char* modeName(AnonymizeMode mode);
+    
     // Get the number of faces detected in the last frame
     int getFaceCount() const { return lastFaceCount; }
 
 private:
     cv::Ptr<cv::FaceDetectorYN> faceDetector;
     float blurIntensity; // 0.0 to 1.0
+    AnonymizeMode mode;
     int lastFaceCount; // Number of faces detected in last frame
+    
+    // Reused between faces and frames; the mask is redrawn only for a new size
+    cv::Mat ellipseMask;
+    cv::Mat obscured;
+    cv::Mat small;
+    
+    // Gaussian kernel size for a face width at the current intensity
+    int kernelSize(int faceWidth) const;
+    void obscure(const cv::Mat& faceROI, int ksize);
 };
 
 #endif // FACE_ANONYMIZER_HPP
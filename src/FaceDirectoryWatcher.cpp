@@ -0,0 +1,310 @@
+#include "FaceDirectoryWatcher.hpp"
+#include "TraceRecorder.hpp"
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <poll.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+namespace {
+const int kCacheFormat = 1;
+
+// Cache key of a file: size and modification time in nanoseconds
+bool fileKey(const std::string& path, std::string& key) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) {
+        return false;
+    }
+    key = std::to_string(static_cast<long long>(info.st_size)) + ":" +
+          std::to_string(static_cast<long long>(info.st_mtim.tv_sec)) + "." +
+          std::to_string(static_cast<long long>(info.st_mtim.tv_nsec));
+    return true;
+}
+}
+
+FaceDirectoryWatcher::FaceDirectoryWatcher(AdvancedFaceSwapper& swapper)
+    : swapper(swapper)
+    , inotifyFd(-1)
+    , watchDescriptor(-1)
+    , running(false)
+{
+}
+
+FaceDirectoryWatcher::~FaceDirectoryWatcher() {
+    stop();
+}
+
+bool FaceDirectoryWatcher::start(const std::string& path) {
+    if (running) {
+        return true;
+    }
+
+    directory = path;
+    while (directory.size() > 1 && directory.back() == '/') {
+        directory.pop_back();
+    }
+    cacheDirectory = directory + "/.faceswap-cache";
+
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0) {
+        std::cerr << "Error: Could not initialize inotify" << std::endl;
+        return false;
+    }
+    // Watch before scanning, so nothing added in between is missed
+    watchDescriptor = inotify_add_watch(inotifyFd, directory.c_str(),
+                                        IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE);
+    if (watchDescriptor < 0) {
+        std::cerr << "Error: Could not watch face directory: " << directory << std::endl;
+        close(inotifyFd);
+        inotifyFd = -1;
+        return false;
+    }
+    if (mkdir(cacheDirectory.c_str(), 0755) != 0 && errno != EEXIST) {
+        std::cerr << "Warning: Could not create cache directory " << cacheDirectory
+                  << "; face images will be prepared on every start" << std::endl;
+    }
+
+    running = true;
+    worker = std::thread(&FaceDirectoryWatcher::watchLoop, this);
+    return true;
+}
+
+void FaceDirectoryWatcher::stop() {
+    if (!running) {
+        return;
+    }
+    running = false;
+    if (worker.joinable()) {
+        worker.join();
+    }
+    close(inotifyFd);
+    inotifyFd = -1;
+    watchDescriptor = -1;
+}
+
+bool FaceDirectoryWatcher::activate(const std::string& name) {
+    std::shared_ptr<const SourceFace> source = swapper.getSourceBank().getSource(name);
+    if (!source) {
+        return false;
+    }
+    swapper.setSourceFace(source);
+    {
+        std::lock_guard<std::mutex> lock(activeMutex);
+        activeName = name;
+    }
+    std::cout << "Active source face: " << name << std::endl;
+    return true;
+}
+
+bool FaceDirectoryWatcher::cycle(int step) {
+    std::vector<std::string> names = swapper.getSourceBank().getSourceNames();
+    if (names.empty()) {
+        return false;
+    }
+    int count = static_cast<int>(names.size());
+    auto it = std::find(names.begin(), names.end(), getActiveName());
+    int index = it != names.end() ? static_cast<int>(it - names.begin()) : (step > 0 ? -1 : 0);
+    index = ((index + step) % count + count) % count;
+    return activate(names[index]);
+}
+
+std::string FaceDirectoryWatcher::getActiveName() const {
+    std::lock_guard<std::mutex> lock(activeMutex);
+    return activeName;
+}
+
+void FaceDirectoryWatcher::watchLoop() {
+    TraceRecorder::setThreadName("face-dir");
+    scanDirectory();
+
+    while (running) {
+        // Wake up regularly so stop() does not wait on a quiet directory
+        pollfd pfd;
+        pfd.fd = inotifyFd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, 200) <= 0) {
+            continue;
+        }
+        handleEvents();
+    }
+}
+
+void FaceDirectoryWatcher::scanDirectory() {
+    DIR* dir = opendir(directory.c_str());
+    if (!dir) {
+        std::cerr << "Error: Could not read face directory: " << directory << std::endl;
+        return;
+    }
+    std::vector<std::string> fileNames;
+    while (dirent* entry = readdir(dir)) {
+        std::string fileName = entry->d_name;
+        if (isImageFile(fileName)) {
+            fileNames.push_back(fileName);
+        }
+    }
+    closedir(dir);
+
+    std::sort(fileNames.begin(), fileNames.end());
+    for (const std::string& fileName : fileNames) {
+        if (!running) {
+            break;
+        }
+        loadImage(fileName);
+    }
+    std::cout << "Face directory " << directory << ": " << swapper.getSourceBank().getSourceCount()
+              << " sources" << std::endl;
+}
+
+void FaceDirectoryWatcher::handleEvents() {
+    alignas(inotify_event) char buffer[4096];
+    while (true) {
+        ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            return;
+        }
+        for (char* p = buffer; p < buffer + length; ) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+            p += sizeof(inotify_event) + event->len;
+            if (event->len == 0) {
+                continue;
+            }
+            std::string fileName = event->name;
+            if (!isImageFile(fileName)) {
+                continue;
+            }
+            if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+                loadImage(fileName);
+            } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                removeImage(fileName);
+            }
+        }
+    }
+}
+
+void FaceDirectoryWatcher::loadImage(const std::string& fileName) {
+    std::string path = directory + "/" + fileName;
+    std::string name = sourceName(fileName);
+    auto owner = sourceFiles.find(name);
+    if (owner != sourceFiles.end() && owner->second != fileName) {
+        std::cerr << "Warning: Skipping " << path << ": source name " << name << " is already used by "
+                  << owner->second << std::endl;
+        return;
+    }
+    std::string key;
+    if (!fileKey(path, key)) {
+        return;
+    }
+    cv::Mat image = cv::imread(path);
+    if (image.empty()) {
+        std::cerr << "Warning: Could not read face image: " << path << std::endl;
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::shared_ptr<const SourceFace> source = loadCached(fileName, image, key);
+    bool cached = source != nullptr;
+    if (!source) {
+        source = swapper.prepareSourceFace(image);
+        if (!source) {
+            std::cerr << "Warning: No usable face in " << path << std::endl;
+            return;
+        }
+        saveCache(fileName, *source, key);
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    swapper.getSourceBank().addSource(name, source);
+    sourceFiles[name] = fileName;
+    std::cout << "Source face " << name << (cached ? " loaded from cache" : " prepared") << " in "
+              << static_cast<int>(ms) << " ms" << std::endl;
+
+    // A changed active image takes effect right away; the first source
+    // becomes active if nothing else is
+    if (name == getActiveName() || !swapper.isSourceFaceLoaded()) {
+        activate(name);
+    }
+}
+
+void FaceDirectoryWatcher::removeImage(const std::string& fileName) {
+    unlink(cachePath(fileName).c_str());
+    std::string name = sourceName(fileName);
+    auto owner = sourceFiles.find(name);
+    if (owner == sourceFiles.end() || owner->second != fileName) {
+        // Never loaded, or a skipped duplicate of another file's name
+        return;
+    }
+    sourceFiles.erase(owner);
+    if (swapper.getSourceBank().removeSource(name)) {
+        // The active face stays in use until another one is chosen
+        std::cout << "Source face " << name << " removed" << std::endl;
+    }
+}
+
+bool FaceDirectoryWatcher::isImageFile(const std::string& fileName) {
+    size_t dot = fileName.rfind('.');
+    if (dot == std::string::npos || dot == 0) {
+        return false;
+    }
+    std::string extension = fileName.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension == "jpg" || extension == "jpeg" || extension == "png" || extension == "bmp";
+}
+
+std::string FaceDirectoryWatcher::sourceName(const std::string& fileName) {
+    return fileName.substr(0, fileName.rfind('.'));
+}
+
+std::string FaceDirectoryWatcher::cachePath(const std::string& fileName) const {
+    return cacheDirectory + "/" + fileName + ".yml";
+}
+
+std::shared_ptr<const SourceFace> FaceDirectoryWatcher::loadCached(const std::string& fileName, const cv::Mat& image,
+                                                                   const std::string& key) {
+    cv::FileStorage fs;
+    try {
+        if (!fs.open(cachePath(fileName), cv::FileStorage::READ)) {
+            return nullptr;
+        }
+        if (static_cast<int>(fs["format"]) != kCacheFormat ||
+            static_cast<std::string>(fs["file_key"]) != key ||
+            static_cast<std::string>(fs["arcface_model"]) != swapper.getArcFaceModelPath()) {
+            return nullptr;
+        }
+
+        cv::Rect faceRect;
+        std::vector<cv::Point2f> landmarks;
+        cv::Mat embedding;
+        fs["face_rect"] >> faceRect;
+        fs["landmarks"] >> landmarks;
+        fs["embedding"] >> embedding;
+        return swapper.restoreSourceFace(image, faceRect, landmarks, embedding);
+    } catch (const cv::Exception& e) {
+        std::cerr << "Warning: Ignoring unreadable cache entry " << cachePath(fileName) << ": " << e.what() << std::endl;
+        return nullptr;
+    }
+}
+
+void FaceDirectoryWatcher::saveCache(const std::string& fileName, const SourceFace& source, const std::string& key) {
+    try {
+        cv::FileStorage fs(cachePath(fileName), cv::FileStorage::WRITE);
+        if (!fs.isOpened()) {
+            return;
+        }
+        fs << "format" << kCacheFormat;
+        fs << "file_key" << key;
+        fs << "arcface_model" << swapper.getArcFaceModelPath();
+        fs << "face_rect" << source.faceRect;
+        fs << "landmarks" << source.landmarks;
+        fs << "embedding" << source.embedding;
+    } catch (const cv::Exception& e) {
+        std::cerr << "Warning: Could not write cache entry " << cachePath(fileName) << ": " << e.what() << std::endl;
+    }
+}
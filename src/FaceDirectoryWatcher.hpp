@@ -0,0 +1,71 @@
+#ifndef FACE_DIRECTORY_WATCHER_HPP
+#define FACE_DIRECTORY_WATCHER_HPP
+
+#include "AdvancedFaceSwapper.hpp"
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Keeps the swapper's source bank in sync with a directory of face images.
+//
+// Images are prepared (detection, alignment, embedding, latent) on the
+// watcher thread and added to the bank under their file name without the
+// extension; a second file with the same name (alice.jpg next to
+// alice.png) is skipped with a warning. inotify reports new, changed, renamed and deleted files, so
+// only those are touched. Each file's detection and embedding are cached in
+// <dir>/.faceswap-cache/, keyed by size, mtime and ArcFace model, so an
+// unchanged image is never run through the networks again, not even after
+// a restart.
+//
+// activate()/cycle() choose which bank source is the swapper's source face;
+// that is one atomic pointer store, so switching costs the frame loop
+// nothing.
+class FaceDirectoryWatcher {
+public:
+    explicit FaceDirectoryWatcher(AdvancedFaceSwapper& swapper);
+    ~FaceDirectoryWatcher();
+
+    // Start watching `directory` and load its images in the background
+    bool start(const std::string& directory);
+    void stop();
+
+    // Make the named source the active one
+    bool activate(const std::string& name);
+
+    // Activate the next (step > 0) or previous source in name order
+    bool cycle(int step);
+
+    std::string getActiveName() const;
+
+private:
+    AdvancedFaceSwapper& swapper;
+    std::string directory;
+    std::string cacheDirectory;
+    int inotifyFd;
+    int watchDescriptor;
+    std::atomic<bool> running;
+    std::thread worker;
+
+    // Source name -> file it was loaded from (watcher thread only)
+    std::map<std::string, std::string> sourceFiles;
+
+    mutable std::mutex activeMutex;
+    std::string activeName;
+
+    void watchLoop();
+    void scanDirectory();
+    void handleEvents();
+    void loadImage(const std::string& fileName);
+    void removeImage(const std::string& fileName);
+
+    static bool isImageFile(const std::string& fileName);
+    static std::string sourceName(const std::string& fileName);
+    std::string cachePath(const std::string& fileName) const;
+    std::shared_ptr<const SourceFace> loadCached(const std::string& fileName, const cv::Mat& image,
+                                                 const std::string& fileKey);
+    void saveCache(const std::string& fileName, const SourceFace& source, const std::string& fileKey);
+};
+
+#endif // FACE_DIRECTORY_WATCHER_HPP
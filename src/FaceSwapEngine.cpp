@@ -0,0 +1,409 @@
+#include "FaceSwapEngine.hpp"
+#include "InferenceScheduler.hpp"
+#include "Logger.hpp"
+#include <iostream>
+#include <algorithm>
+
+FaceSwapEngine::FaceSwapEngine()
+    : gfpganLoaded(false)
+    , scheduler(nullptr)
+    , sourceStream(-1)
+    , sourceFaceSet(false)
+    , sourceGeneration(0)
+{
+    for (std::atomic<bool>& flag : warned) {
+        flag = false;
+    }
+}
+
+cv::dnn::Net FaceSwapEngine::readNet(const std::string& modelPath) {
+    cv::dnn::Net net = cv::dnn::readNetFromONNX(modelPath);
+    if (!net.empty()) {
+        // Set backend (prefer CPU for compatibility, can be changed to CUDA)
+        net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+        net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+    }
+    return net;
+}
+
+bool FaceSwapEngine::loadFaceDetectionModel(const std::string& modelPath) {
+    try {
+        cv::Ptr<cv::FaceDetectorYN> detector =
+            cv::FaceDetectorYN::create(modelPath, "", cv::Size(320, 320), 0.9f, 0.3f, 5000);
+        if (detector.empty()) {
+            std::cerr << "Error: Could not load YuNet face detection model." << std::endl;
+            return false;
+        }
+        {
+            std::lock_guard<std::mutex> lock(sourcePrepMutex);
+            detectionModelPath = modelPath;
+            sourceDetector = detector;
+        }
+        std::cout << "Face detection model loaded successfully." << std::endl;
+        return true;
+    } catch (const cv::Exception& e) {
+        std::cerr << "Exception loading face detection model: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool FaceSwapEngine::loadArcFaceModel(const std::string& modelPath) {
+    try {
+        cv::dnn::Net net = readNet(modelPath);
+        if (net.empty()) {
+            std::cerr << "Warning: Could not load ArcFace model from: " << modelPath << std::endl;
+            std::cerr << "Face embedding extraction will use fallback method." << std::endl;
+            return false;
+        }
+        {
+            std::lock_guard<std::mutex> lock(spareMutex);
+            spareArcFaceNet = net;
+        }
+        {
+            std::lock_guard<std::mutex> lock(sourcePrepMutex);
+            arcFaceModelPath = modelPath;
+            sourceArcFaceNet = cv::dnn::Net();
+        }
+        std::cout << "ArcFace model loaded successfully." << std::endl;
+        return true;
+    } catch (const cv::Exception& e) {
+        std::cerr << "Exception loading ArcFace model: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool FaceSwapEngine::loadInSwapperModel(const std::string& modelPath) {
+    try {
+        cv::dnn::Net net = readNet(modelPath);
+        if (net.empty()) {
+            std::cerr << "Warning: Could not load INSwapper model from: " << modelPath << std::endl;
+            std::cerr << "Face swapping will use fallback affine transformation." << std::endl;
+            return false;
+        }
+        {
+            std::lock_guard<std::mutex> lock(spareMutex);
+            spareInSwapperNet = net;
+        }
+        inSwapperModelPath = modelPath;
+        std::cout << "INSwapper model loaded successfully." << std::endl;
+        std::cout << "  Expected inputs: [target] (1,3,128,128) and [source] (1,512)" << std::endl;
+        return true;
+    } catch (const cv::Exception& e) {
+        std::cerr << "Exception loading INSwapper model: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool FaceSwapEngine::loadGFPGANModel(const std::string& modelPath) {
+    try {
+        // GFPGAN models are typically PyTorch format, not ONNX
+        // For now, we'll skip this and add support later
+        std::cerr << "Warning: GFPGAN model loading not yet implemented." << std::endl;
+        std::cerr << "GFPGAN restoration will be skipped." << std::endl;
+        gfpganLoaded = false;
+        return false;
+    } catch (const cv::Exception& e) {
+        std::cerr << "Exception loading GFPGAN model: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+void FaceSwapEngine::setInferenceScheduler(InferenceScheduler* scheduler) {
+    this->scheduler = scheduler;
+    sourceStream = scheduler ? scheduler->addStream("sources") : -1;
+    {
+        std::lock_guard<std::mutex> lock(spareMutex);
+        spareArcFaceNet = cv::dnn::Net();
+        spareInSwapperNet = cv::dnn::Net();
+    }
+    std::lock_guard<std::mutex> lock(sourcePrepMutex);
+    arcFaceModelPath = scheduler ? scheduler->getArcFaceModelPath() : std::string();
+    inSwapperModelPath.clear();
+    sourceArcFaceNet = cv::dnn::Net();
+}
+
+bool FaceSwapEngine::hasArcFace() const {
+    return scheduler ? scheduler->hasArcFace() : !arcFaceModelPath.empty();
+}
+
+bool FaceSwapEngine::hasInSwapper() const {
+    return scheduler ? scheduler->hasInSwapper() : !inSwapperModelPath.empty();
+}
+
+std::string FaceSwapEngine::getArcFaceModelPath() const {
+    return hasArcFace() ? arcFaceModelPath : std::string();
+}
+
+cv::Ptr<cv::FaceDetectorYN> FaceSwapEngine::createDetector() const {
+    if (detectionModelPath.empty()) {
+        return cv::Ptr<cv::FaceDetectorYN>();
+    }
+    try {
+        return cv::FaceDetectorYN::create(detectionModelPath, "", cv::Size(320, 320), 0.9f, 0.3f, 5000);
+    } catch (const cv::Exception& e) {
+        std::cerr << "Error: Could not create face detector: " << e.what() << std::endl;
+        return cv::Ptr<cv::FaceDetectorYN>();
+    }
+}
+
+InferenceContext FaceSwapEngine::createInferenceContext(int stream) const {
+    InferenceContext context;
+    completeInferenceContext(context, stream);
+    return context;
+}
+
+void FaceSwapEngine::completeInferenceContext(InferenceContext& context, int stream) const {
+    context.scheduler = scheduler;
+    context.stream = scheduler ? stream : -1;
+    if (scheduler) {
+        context.arcFaceNet = cv::dnn::Net();
+        context.inSwapperNet = cv::dnn::Net();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(spareMutex);
+        if (context.arcFaceNet.empty() && !spareArcFaceNet.empty()) {
+            std::swap(context.arcFaceNet, spareArcFaceNet);
+        }
+        if (context.inSwapperNet.empty() && !spareInSwapperNet.empty()) {
+            std::swap(context.inSwapperNet, spareInSwapperNet);
+        }
+    }
+    try {
+        if (context.arcFaceNet.empty() && !arcFaceModelPath.empty()) {
+            context.arcFaceNet = readNet(arcFaceModelPath);
+        }
+        if (context.inSwapperNet.empty() && !inSwapperModelPath.empty()) {
+            context.inSwapperNet = readNet(inSwapperModelPath);
+        }
+    } catch (const cv::Exception& e) {
+        std::cerr << "Exception loading networks for a session: " << e.what() << std::endl;
+    }
+}
+
+std::shared_ptr<const SourceFace> FaceSwapEngine::prepareSourceFace(const cv::Mat& image) {
+    if (image.empty() || !hasDetector()) {
+        return nullptr;
+    }
+    
+    std::lock_guard<std::mutex> lock(sourcePrepMutex);
+    try {
+        // Private copies of the networks: the sessions' are busy
+        if (sourceDetector.empty()) {
+            sourceDetector = createDetector();
+        }
+        if (!arcFaceModelPath.empty() && !scheduler && sourceArcFaceNet.empty()) {
+            sourceArcFaceNet = readNet(arcFaceModelPath);
+        }
+    } catch (const cv::Exception& e) {
+        std::cerr << "Error: Could not create source face networks: " << e.what() << std::endl;
+        return nullptr;
+    }
+    if (sourceDetector.empty()) {
+        return nullptr;
+    }
+    
+    auto source = std::make_shared<SourceFace>();
+    source->image = image.clone();
+    
+    // Set input size for face detection
+    sourceDetector->setInputSize(image.size());
+    
+    // Detect face in source image
+    cv::Mat faces;
+    sourceDetector->detect(image, faces);
+    
+    if (faces.rows == 0) {
+        std::cerr << "Error: No face detected in source image." << std::endl;
+        return nullptr;
+    }
+    
+    // Use the first detected face
+    float x = faces.at<float>(0, 0);
+    float y = faces.at<float>(0, 1);
+    float w = faces.at<float>(0, 2);
+    float h = faces.at<float>(0, 3);
+    
+    source->faceRect = cv::Rect(
+        std::max(0, static_cast<int>(x)),
+        std::max(0, static_cast<int>(y)),
+        std::min(image.cols - static_cast<int>(x), static_cast<int>(w)),
+        std::min(image.rows - static_cast<int>(y), static_cast<int>(h))
+    );
+    
+    // Extract landmarks
+    source->landmarks = extractLandmarks(faces, 0);
+    
+    if (source->landmarks.empty()) {
+        std::cerr << "Error: Could not extract landmarks from source face." << std::endl;
+        return nullptr;
+    }
+    
+    // Align source face
+    source->aligned = alignFace(source->image, source->landmarks, source->faceRect, 512);
+    
+    // Extract face embedding if ArcFace is loaded, and shape it for INSwapper
+    // once here instead of for every swapped face
+    if (hasArcFace() && !source->aligned.empty()) {
+        InferenceContext context{sourceArcFaceNet, cv::dnn::Net(), scheduler, sourceStream};
+        source->embedding = extractFaceEmbedding(source->aligned, context);
+        setSourceLatent(*source);
+    }
+    
+    return source;
+}
+
+std::shared_ptr<const SourceFace> FaceSwapEngine::restoreSourceFace(const cv::Mat& image, const cv::Rect& faceRect,
+                                                                    const std::vector<cv::Point2f>& landmarks,
+                                                                    const cv::Mat& embedding) const {
+    if (image.empty() || landmarks.size() < 5) {
+        return nullptr;
+    }
+    
+    auto source = std::make_shared<SourceFace>();
+    source->image = image.clone();
+    source->faceRect = faceRect & cv::Rect(0, 0, image.cols, image.rows);
+    source->landmarks = landmarks;
+    source->aligned = alignFace(source->image, source->landmarks, source->faceRect, 512);
+    source->embedding = embedding.clone();
+    setSourceLatent(*source);
+    return source;
+}
+
+void FaceSwapEngine::setSourceLatent(SourceFace& source) {
+    if (!source.embedding.empty()) {
+        source.embedding.convertTo(source.latent, CV_32F);
+        source.latent = source.latent.reshape(1, 1).clone();
+    }
+}
+
+void FaceSwapEngine::setSourceFace(std::shared_ptr<const SourceFace> source) {
+    std::lock_guard<std::mutex> lock(sourceWriteMutex);
+    bool set = source != nullptr;
+    std::atomic_store(&sourceFace, std::move(source));
+    sourceFaceSet.store(set, std::memory_order_release);
+    sourceGeneration.fetch_add(1, std::memory_order_release);
+}
+
+std::vector<cv::Point2f> FaceSwapEngine::extractLandmarks(const cv::Mat& faces, int faceIndex) {
+    std::vector<cv::Point2f> landmarks;
+    
+    if (faceIndex >= faces.rows) {
+        return landmarks;
+    }
+    
+    // YuNet format: [x, y, w, h, x_re, y_re, x_le, y_le, x_nt, y_nt, x_rcm, y_rcm, x_lcm, y_lcm, confidence]
+    landmarks.push_back(cv::Point2f(faces.at<float>(faceIndex, 6), faces.at<float>(faceIndex, 7))); // Left eye
+    landmarks.push_back(cv::Point2f(faces.at<float>(faceIndex, 4), faces.at<float>(faceIndex, 5))); // Right eye
+    landmarks.push_back(cv::Point2f(faces.at<float>(faceIndex, 8), faces.at<float>(faceIndex, 9))); // Nose tip
+    landmarks.push_back(cv::Point2f(faces.at<float>(faceIndex, 12), faces.at<float>(faceIndex, 13))); // Left mouth corner
+    landmarks.push_back(cv::Point2f(faces.at<float>(faceIndex, 10), faces.at<float>(faceIndex, 11))); // Right mouth corner
+    
+    return landmarks;
+}
+
+cv::Mat FaceSwapEngine::alignFace(const cv::Mat& image, const std::vector<cv::Point2f>& landmarks, 
+                                  const cv::Rect& faceRect, int outputSize) {
+    if (landmarks.size() < 5) {
+        return cv::Mat();
+    }
+    
+    // Standard face alignment points (for 512x512 output)
+    std::vector<cv::Point2f> dstPoints = {
+        cv::Point2f(0.31556875f * outputSize, 0.46157407f * outputSize), // Left eye
+        cv::Point2f(0.68262292f * outputSize, 0.46157407f * outputSize), // Right eye
+        cv::Point2f(0.50026250f * outputSize, 0.64050537f * outputSize), // Nose tip
+        cv::Point2f(0.37015179f * outputSize, 0.82469196f * outputSize), // Left mouth corner
+        cv::Point2f(0.63151667f * outputSize, 0.82469196f * outputSize)  // Right mouth corner
+    };
+    
+    // Adjust source landmarks to be relative to face rect
+    std::vector<cv::Point2f> srcPoints;
+    for (const auto& pt : landmarks) {
+        srcPoints.push_back(cv::Point2f(pt.x - faceRect.x, pt.y - faceRect.y));
+    }
+    
+    // Calculate similarity transformation
+    cv::Mat transform = cv::estimateAffinePartial2D(srcPoints, dstPoints);
+    
+    if (transform.empty()) {
+        return cv::Mat();
+    }
+    
+    // Extract face region
+    cv::Mat faceROI = image(faceRect);
+    
+    // Warp face
+    cv::Mat aligned;
+    cv::warpAffine(faceROI, aligned, transform, cv::Size(outputSize, outputSize));
+    
+    return aligned;
+}
+
+cv::Mat FaceSwapEngine::extractFaceEmbedding(const cv::Mat& alignedFace, InferenceContext& context) {
+    if (alignedFace.empty() || (!context.scheduler && context.arcFaceNet.empty())) {
+        // Fallback: return empty embedding (will use fallback swapping)
+        return cv::Mat();
+    }
+    
+    try {
+        // Preprocess for ArcFace (normalize to [-1, 1] and resize to 112x112)
+        cv::Mat input;
+        cv::resize(alignedFace, input, cv::Size(112, 112));
+        input.convertTo(input, CV_32F, 1.0/127.5, -1.0); // Normalize to [-1, 1]
+        
+        // Create blob
+        cv::Mat blob = cv::dnn::blobFromImage(input, 1.0, cv::Size(112, 112), cv::Scalar(), true, false);
+        
+        // Forward pass, on the shared networks if there are any
+        std::vector<cv::Mat> outputs;
+        if (context.scheduler) {
+            cv::Mat output = context.scheduler->forwardEmbedding(context.stream, blob);
+            if (!output.empty()) {
+                outputs.push_back(output);
+            }
+        } else {
+            context.arcFaceNet.setInput(blob);
+            context.arcFaceNet.forward(outputs);
+        }
+        
+        if (!outputs.empty()) {
+            // Normalize embedding
+            cv::Mat embedding = outputs[0];
+            
+            // Ensure embedding is 1D
+            if (embedding.dims > 1 && embedding.rows > 1) {
+                embedding = embedding.reshape(1, 1);
+            }
+            
+            if (embedding.empty() || embedding.total() == 0) {
+                LOG_ERROR("Invalid embedding from ArcFace");
+                return cv::Mat();
+            }
+            
+            // Reshape to 1x512 if needed
+            if (embedding.cols != 512) {
+                embedding = embedding.reshape(0, 1);
+                if (embedding.cols != 512) {
+                    LOG_WARN("Embedding dimension mismatch. Expected 512, got " << embedding.cols);
+                    // Still return it, might work
+                }
+            }
+            
+            // Normalize using safe method
+            cv::Mat norm = embedding.clone();
+            double normVal = cv::norm(norm, cv::NORM_L2);
+            if (normVal > 0) {
+                norm = norm / normVal;
+            }
+            
+            return norm;
+        }
+    } catch (const cv::Exception& e) {
+        LOG_ERROR("Error extracting face embedding: " << e.what());
+    } catch (...) {
+        LOG_ERROR("Unknown error in extractFaceEmbedding");
+    }
+    
+    return cv::Mat();
+}
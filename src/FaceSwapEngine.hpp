@@ -0,0 +1,144 @@
+#ifndef FACE_SWAP_ENGINE_HPP
+#define FACE_SWAP_ENGINE_HPP
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/objdetect.hpp>
+#include <opencv2/dnn.hpp>
+#include "SourceBank.hpp"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class InferenceScheduler;
+
+// Per-thread DNN state. cv::dnn::Net is not thread-safe, so every session
+// and every face worker runs its own copy of the networks, unless a
+// scheduler shared with other streams runs them.
+struct InferenceContext {
+    cv::dnn::Net arcFaceNet;
+    cv::dnn::Net inSwapperNet;
+    InferenceScheduler* scheduler = nullptr;
+    int stream = -1;
+};
+
+// What face swap sessions share: which models are loaded and the prepared
+// source faces.
+//
+// Load the models first, then create the sessions (AdvancedFaceSwapper) on
+// the engine. From then on the frame path only reads it: every session
+// builds its own detector and networks from the model files in
+// create*(), or sends its model calls to the InferenceScheduler. Source
+// faces and the source bank are published atomically and can change at any
+// time from any thread.
+class FaceSwapEngine {
+public:
+    // Configuration problems reported once per engine, not once per frame
+    enum class Warning {
+        InSwapperWithoutArcFace,
+        SourceWithoutEmbedding,
+        Count
+    };
+
+    FaceSwapEngine();
+
+    // Load models (before sessions are created)
+    bool loadFaceDetectionModel(const std::string& modelPath);
+    bool loadArcFaceModel(const std::string& modelPath);
+    bool loadInSwapperModel(const std::string& modelPath);
+    bool loadGFPGANModel(const std::string& modelPath);
+
+    // Run ArcFace and INSwapper on `scheduler` (one copy of the weights for
+    // every session) instead of per-session networks. Replaces
+    // loadArcFaceModel()/loadInSwapperModel().
+    void setInferenceScheduler(InferenceScheduler* scheduler);
+    InferenceScheduler* getInferenceScheduler() const { return scheduler; }
+
+    bool hasDetector() const { return !detectionModelPath.empty(); }
+    bool hasArcFace() const;
+    bool hasInSwapper() const;
+    bool hasGFPGAN() const { return gfpganLoaded; }
+
+    // ArcFace model the embeddings come from ("" if none is loaded)
+    std::string getArcFaceModelPath() const;
+
+    // Fresh per-session state. The networks loaded by load*() are handed to
+    // the first caller, later ones read the model file again. With a
+    // scheduler the context only carries it and `stream`.
+    cv::Ptr<cv::FaceDetectorYN> createDetector() const;
+    InferenceContext createInferenceContext(int stream = -1) const;
+    // Same, filling in only the networks `context` does not have yet
+    void completeInferenceContext(InferenceContext& context, int stream = -1) const;
+
+    // Detect, align and embed a source face. Uses the engine's own detector
+    // and ArcFace network, so it can run on any thread while sessions
+    // process frames. Returns null if no usable face was found.
+    std::shared_ptr<const SourceFace> prepareSourceFace(const cv::Mat& image);
+
+    // Rebuild a prepared source face from its cached detection and
+    // embedding (no networks run)
+    std::shared_ptr<const SourceFace> restoreSourceFace(const cv::Mat& image, const cv::Rect& faceRect,
+                                                        const std::vector<cv::Point2f>& landmarks,
+                                                        const cv::Mat& embedding) const;
+
+    // Current source face of every session. Each frame picks it up when its
+    // swap stage starts; frames already in flight finish with the previous one.
+    void setSourceFace(std::shared_ptr<const SourceFace> source);
+    std::shared_ptr<const SourceFace> getSourceFace() const { return std::atomic_load(&sourceFace); }
+    bool hasSourceFace() const { return sourceFaceSet.load(std::memory_order_acquire); }
+    // Bumped after every setSourceFace(). Sessions keep their own pointer and
+    // only call getSourceFace() (which takes a lock in libstdc++'s atomic
+    // shared_ptr) when this has moved.
+    uint64_t getSourceGeneration() const { return sourceGeneration.load(std::memory_order_acquire); }
+
+    // Per-identity sources shared by every session
+    SourceBank& getSourceBank() { return sourceBank; }
+    const SourceBank& getSourceBank() const { return sourceBank; }
+
+    // True the first time it is called for `warning`
+    bool claimWarning(Warning warning) const {
+        return !warned[static_cast<size_t>(warning)].exchange(true);
+    }
+
+    // Face geometry and embedding, used by sessions and source preparation
+    static std::vector<cv::Point2f> extractLandmarks(const cv::Mat& faces, int faceIndex);
+    static cv::Mat alignFace(const cv::Mat& image, const std::vector<cv::Point2f>& landmarks,
+                             const cv::Rect& faceRect, int outputSize = 512);
+    static cv::Mat extractFaceEmbedding(const cv::Mat& alignedFace, InferenceContext& context);
+
+private:
+    std::string detectionModelPath;
+    std::string arcFaceModelPath;
+    std::string inSwapperModelPath;
+    bool gfpganLoaded;
+    InferenceScheduler* scheduler;
+    int sourceStream;   // scheduler stream of prepareSourceFace()
+
+    // Networks built while loading, until a session takes them
+    mutable std::mutex spareMutex;
+    mutable cv::dnn::Net spareArcFaceNet;
+    mutable cv::dnn::Net spareInSwapperNet;
+
+    // Current source face; only accessed through std::atomic_load/store.
+    // Writers serialize so the flag and generation always match the pointer.
+    std::mutex sourceWriteMutex;
+    std::shared_ptr<const SourceFace> sourceFace;
+    std::atomic<bool> sourceFaceSet;
+    std::atomic<uint64_t> sourceGeneration;
+    SourceBank sourceBank;
+
+    // Networks for prepareSourceFace(), separate from every session's
+    std::mutex sourcePrepMutex;
+    cv::Ptr<cv::FaceDetectorYN> sourceDetector;
+    cv::dnn::Net sourceArcFaceNet;
+
+    mutable std::array<std::atomic<bool>, static_cast<size_t>(Warning::Count)> warned;
+
+    static cv::dnn::Net readNet(const std::string& modelPath);
+    static void setSourceLatent(SourceFace& source);
+};
+
+#endif // FACE_SWAP_ENGINE_HPP
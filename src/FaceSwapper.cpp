@@ -81,6 +81,21 @@ bool FaceSwapper::loadSourceFace(const cv::Mat& image) {
     return true;
 }
 
+bool FaceSwapper::setSourceFace(const cv::Mat& image, const cv::Rect& faceRect,
+                                const std::vector<cv::Point2f>& landmarks) {
+    cv::Rect rect = faceRect & cv::Rect(0, 0, image.cols, image.rows);
+    if (image.empty() || rect.width <= 0 || rect.height <= 0 || landmarks.size() != 5) {
+        return false;
+    }
+    
+    // The image is only read, so it can be shared with the caller
+    sourceFaceImage = image;
+    sourceFaceRect = rect;
+    sourceLandmarks = landmarks;
+    sourceFaceLoaded = true;
+    return true;
+}
+
 std::vector<cv::Point2f> FaceSwapper::extractLandmarks(const cv::Mat& faces, int faceIndex) {
     std::vector<cv::Point2f> landmarks;
     
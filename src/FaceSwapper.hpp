@@ -17,6 +17,11 @@ public:
     bool loadSourceFace(const std::string& imagePath);
     bool loadSourceFace(const cv::Mat& image);
     
+    // Use a source face that was already detected elsewhere (landmarks in
+    // image coordinates, in extractLandmarks() order); no detection runs
+    bool setSourceFace(const cv::Mat& image, const cv::Rect& faceRect,
+                       const std::vector<cv::Point2f>& landmarks);
+    
     // Check if source face is loaded
     bool isSourceFaceLoaded() const { return sourceFaceLoaded; }
     
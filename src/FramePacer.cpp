@@ -0,0 +1,196 @@
+#include "FramePacer.hpp"
+#include "MetricsServer.hpp"
+#include "StageProfiler.hpp"
+#include "ThreadBudget.hpp"
+#include "TraceRecorder.hpp"
+#include <iomanip>
+#include <iostream>
+
+FramePacer::FramePacer(VirtualCamera& output)
+    : output(output)
+    , metrics(nullptr)
+    , fps(30.0)
+    , deadlineMs(100.0)
+    , passthrough(false)
+    , running(false)
+    , superseded(0)
+{
+}
+
+FramePacer::~FramePacer() {
+    stop();
+}
+
+bool FramePacer::start(double fps, double deadlineMs, bool passthrough) {
+    if (running) {
+        return true;
+    }
+    if (fps <= 0.0 || deadlineMs <= 0.0) {
+        std::cerr << "Error: Output pacing needs a positive frame rate and deadline" << std::endl;
+        return false;
+    }
+    this->fps = fps;
+    this->deadlineMs = deadlineMs;
+    this->passthrough = passthrough;
+    running = true;
+    worker = std::thread(&FramePacer::paceLoop, this);
+    return true;
+}
+
+void FramePacer::stop() {
+    if (!running) {
+        return;
+    }
+    running = false;
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+void FramePacer::submitComposite(const cv::Mat& frame, std::chrono::steady_clock::time_point captureTime) {
+    Slot& slot = composite.writeBuffer();
+    slot.frame = frame;
+    slot.captureTime = captureTime;
+    if (composite.publish()) {
+        superseded++;
+    }
+}
+
+void FramePacer::submitRaw(const cv::Mat& frame, std::chrono::steady_clock::time_point captureTime) {
+    Slot& slot = raw.writeBuffer();
+    slot.frame = frame;
+    slot.captureTime = captureTime;
+    raw.publish();
+}
+
+void FramePacer::dropRaw() {
+    raw.writeBuffer().frame.release();
+    raw.publish();
+}
+
+void FramePacer::paceLoop() {
+    ThreadBudget::active().applyToCurrentThread(PipelineStage::Output);
+    TraceRecorder::setThreadName("output");
+
+    using Clock = std::chrono::steady_clock;
+    const auto interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / fps));
+    const auto deadline = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(deadlineMs));
+
+    enum class Kind { Fresh, Repeated, Passthrough };
+    cv::Mat last;
+    Clock::time_point lastCapture;
+    bool rawPending = false;
+    auto nextTick = Clock::now() + interval;
+
+    while (running) {
+        std::this_thread::sleep_until(nextTick);
+        auto now = Clock::now();
+        if (now > nextTick + interval) {
+            // A write stalled; skip the missed ticks instead of bursting
+            nextTick = now;
+        }
+        nextTick += interval;
+
+        cv::Mat frame;
+        Clock::time_point capture;
+        Kind kind = Kind::Repeated;
+        bool stale = false;
+        if (composite.update()) {
+            Slot& slot = composite.read();
+            if (!last.empty() && slot.captureTime < lastCapture) {
+                stale = true;
+            } else {
+                frame = slot.frame;
+                capture = slot.captureTime;
+                kind = Kind::Fresh;
+            }
+            slot.frame.release();
+        }
+        if (raw.update()) {
+            rawPending = !raw.read().frame.empty();
+        }
+        if (frame.empty() && passthrough && rawPending) {
+            const Slot& slot = raw.read();
+            if (now - slot.captureTime > deadline && (last.empty() || slot.captureTime > lastCapture)) {
+                rawPending = false;
+                frame = slot.frame;
+                capture = slot.captureTime;
+                kind = Kind::Passthrough;
+            }
+        }
+        if (frame.empty()) {
+            if (last.empty()) {
+                std::lock_guard<std::mutex> lock(statsMutex);
+                stats.ticks++;
+                continue;   // nothing to show yet
+            }
+            frame = last;
+            capture = lastCapture;
+        }
+
+        bool written;
+        {
+            ScopedProfile profile(ProfileStage::VirtualCameraWrite);
+            written = output.writeFrame(frame);
+        }
+
+        bool late = kind == Kind::Fresh && now - capture > deadline;
+        if (metrics) {
+            if (!written) {
+                metrics->recordOutputDrop();
+            }
+            if (late) {
+                metrics->recordOutputLate();
+            } else if (kind == Kind::Repeated) {
+                metrics->recordOutputRepeat();
+            } else if (kind == Kind::Passthrough) {
+                metrics->recordOutputPassthrough();
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(statsMutex);
+        stats.ticks++;
+        stats.stale += stale ? 1 : 0;
+        switch (kind) {
+            case Kind::Fresh:
+                stats.fresh++;
+                stats.late += late ? 1 : 0;
+                break;
+            case Kind::Repeated:
+                stats.repeated++;
+                break;
+            case Kind::Passthrough:
+                stats.passthrough++;
+                break;
+        }
+        if (!written) {
+            stats.writeFailures++;
+        }
+        last = frame;
+        lastCapture = capture;
+    }
+}
+
+FramePacer::Stats FramePacer::getStats() const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    Stats s = stats;
+    s.superseded = superseded;
+    return s;
+}
+
+void FramePacer::printSummary(std::ostream& os) const {
+    Stats s = getStats();
+    auto percent = [&s](uint64_t count) { return s.ticks > 0 ? 100.0 * count / s.ticks : 0.0; };
+    os << std::fixed << std::setprecision(1);
+    os << "Output pacing at " << fps << " FPS (deadline " << deadlineMs << " ms"
+       << (passthrough ? ", passthrough" : "") << "):" << std::endl;
+    os << "  " << s.ticks << " ticks: " << s.fresh << " new (" << percent(s.fresh) << "%), "
+       << s.repeated << " repeated (" << percent(s.repeated) << "%), "
+       << s.passthrough << " passthrough (" << percent(s.passthrough) << "%)" << std::endl;
+    os << "  " << s.late << " late, " << s.stale << " stale and " << s.superseded
+       << " superseded composites";
+    if (s.writeFailures > 0) {
+        os << ", " << s.writeFailures << " write failures";
+    }
+    os << std::endl;
+}
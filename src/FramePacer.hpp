@@ -0,0 +1,91 @@
+#ifndef FRAME_PACER_HPP
+#define FRAME_PACER_HPP
+
+#include "TripleBuffer.hpp"
+#include "VirtualCamera.hpp"
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <thread>
+
+class MetricsServer;
+
+// Writes the virtual camera at a steady cadence, however unevenly processed
+// frames arrive.
+//
+// The frame loop hands over composited frames (and, for passthrough, the
+// raw captures); an output thread wakes every 1/fps seconds and writes
+// exactly one frame:
+//   - the newest composite, if one arrived since the last tick
+//   - otherwise, with passthrough on, the newest raw capture once it has
+//     waited longer than the deadline for its composite
+//   - otherwise the last frame again
+// Composites older than a frame already shown (overtaken by passthrough)
+// are dropped, so the output never goes back in time. Frames are handed
+// over through triple buffers, so the frame loop never waits on a write.
+class FramePacer {
+public:
+    struct Stats {
+        uint64_t ticks = 0;
+        uint64_t fresh = 0;         // new composites written
+        uint64_t late = 0;          // of those, written more than the deadline after capture
+        uint64_t repeated = 0;      // last frame written again (pipeline late)
+        uint64_t passthrough = 0;   // raw capture written instead
+        uint64_t stale = 0;         // composites dropped, a newer frame was already shown
+        uint64_t superseded = 0;    // composites replaced before their tick (faster than the cadence)
+        uint64_t writeFailures = 0;
+    };
+
+    explicit FramePacer(VirtualCamera& output);
+    ~FramePacer();
+
+    // Start the output thread at `fps`. Composites count as late once they
+    // are `deadlineMs` old; with `passthrough` the raw capture goes out
+    // instead of a repeat after that long.
+    bool start(double fps, double deadlineMs, bool passthrough);
+    // Report write failures and late, repeated and passthrough ticks to
+    // `metrics` (set before start(); must outlive the pacer)
+    void setMetrics(MetricsServer* metrics) { this->metrics = metrics; }
+    void stop();
+    bool isRunning() const { return running; }
+    bool isPassthroughEnabled() const { return passthrough; }
+
+    // Frame loop (one thread). The pacer keeps a reference to the pixels, so
+    // the caller must not write into `frame` afterwards.
+    void submitComposite(const cv::Mat& frame, std::chrono::steady_clock::time_point captureTime);
+    void submitRaw(const cv::Mat& frame, std::chrono::steady_clock::time_point captureTime);
+    // Forget the pending raw capture (e.g. when unprocessed faces must not be shown)
+    void dropRaw();
+
+    Stats getStats() const;
+    void printSummary(std::ostream& os) const;
+
+private:
+    struct Slot {
+        cv::Mat frame;
+        std::chrono::steady_clock::time_point captureTime;
+    };
+
+    VirtualCamera& output;
+    MetricsServer* metrics;
+    double fps;
+    double deadlineMs;
+    bool passthrough;
+    std::atomic<bool> running;
+    std::thread worker;
+
+    TripleBuffer<Slot> composite;
+    TripleBuffer<Slot> raw;
+    std::atomic<uint64_t> superseded;
+
+    // Counters of the output thread, guarded for getStats()
+    mutable std::mutex statsMutex;
+    Stats stats;
+
+    void paceLoop();
+};
+
+#endif // FRAME_PACER_HPP
@@ -0,0 +1,238 @@
+#include "FramePipeline.hpp"
+#include "ThreadBudget.hpp"
+#include "Logger.hpp"
+#include "StageProfiler.hpp"
+#include "TraceRecorder.hpp"
+#include <iostream>
+#include <iomanip>
+
+namespace {
+double msSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+}
+
+FramePipeline::FramePipeline(AdvancedFaceSwapper& swapper, size_t queueDepth)
+    : swapper(swapper)
+    , detectionQueue(queueDepth)
+    , inferenceQueue(queueDepth)
+    , compositeQueue(queueDepth)
+    , running(false)
+    , nextIndex(0)
+    , accepted(0)
+    , delivered(0)
+    , dropped(0)
+    , qualityPending(false)
+    , totalLatencyMs(0.0)
+    , totalProcessingMs(0.0)
+{
+}
+
+FramePipeline::~FramePipeline() {
+    stop();
+}
+
+void FramePipeline::start(OutputCallback callback) {
+    if (running || !workers.empty()) {
+        return;
+    }
+
+    onOutput = callback;
+    running = true;
+    workers.emplace_back(&FramePipeline::detectionLoop, this);
+    workers.emplace_back(&FramePipeline::inferenceLoop, this);
+    workers.emplace_back(&FramePipeline::compositeLoop, this);
+}
+
+void FramePipeline::stop() {
+    if (!running) {
+        return;
+    }
+    running = false;
+
+    // Closing the first queue lets each stage drain and close the next one
+    detectionQueue.close();
+    for (auto& worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+bool FramePipeline::submit(const cv::Mat& frame, bool dropIfBusy) {
+    if (!running || frame.empty()) {
+        return false;
+    }
+
+    PipelineFrame job;
+    job.index = nextIndex++;
+    job.captureTime = std::chrono::steady_clock::now();
+    job.frame = frame;
+
+    // Count before queueing so drain() never sees delivered > accepted
+    accepted++;
+    bool queued = dropIfBusy ? detectionQueue.tryPush(std::move(job))
+                             : detectionQueue.push(std::move(job));
+    if (!queued) {
+        {
+            std::lock_guard<std::mutex> lock(statsMutex);
+            accepted--;
+            dropped++;
+        }
+        // Wake drain() in case it is waiting on the frame we just gave up
+        deliveredCondition.notify_all();
+    }
+    return queued;
+}
+
+void FramePipeline::drain() {
+    std::unique_lock<std::mutex> lock(statsMutex);
+    deliveredCondition.wait(lock, [this] { return !running || delivered >= accepted; });
+}
+
+void FramePipeline::setQualitySettings(const QualitySettings& settings) {
+    std::lock_guard<std::mutex> lock(qualityMutex);
+    pendingQuality = settings;
+    qualityPending = true;
+}
+
+void FramePipeline::detectionLoop() {
+    ThreadBudget::active().applyToCurrentThread(PipelineStage::Detection);
+    TraceRecorder::setThreadName("detection");
+
+    PipelineFrame job;
+    while (detectionQueue.pop(job)) {
+        TraceRecorder::setThreadFrame(job.index);
+        {
+            std::lock_guard<std::mutex> lock(qualityMutex);
+            if (qualityPending) {
+                swapper.setQualitySettings(pendingQuality);
+                qualityPending = false;
+            }
+        }
+
+        job.swapped = swapper.isReadyToSwap();
+        if (job.swapped) {
+            try {
+                job.analysis = swapper.analyzeFrame(job.frame, job.timings);
+            } catch (const cv::Exception& e) {
+                LOG_ERROR("Exception in pipeline detection: " << e.what());
+                job.swapped = false;
+            }
+        }
+
+        if (!inferenceQueue.push(std::move(job))) {
+            break;
+        }
+    }
+    inferenceQueue.close();
+}
+
+void FramePipeline::inferenceLoop() {
+    ThreadBudget::active().applyToCurrentThread(PipelineStage::SwapInference);
+    TraceRecorder::setThreadName("inference");
+
+    PipelineFrame job;
+    while (inferenceQueue.pop(job)) {
+        TraceRecorder::setThreadFrame(job.index);
+        if (pendingSettings.update()) {
+            swapper.applyRuntimeSettings(pendingSettings.read());
+        }
+        if (job.swapped && job.analysis.faces.rows > 0) {
+            try {
+                job.faces = swapper.swapFaces(job.analysis, job.timings);
+            } catch (const cv::Exception& e) {
+                LOG_ERROR("Exception in pipeline inference: " << e.what());
+                job.faces.clear();
+            }
+        }
+
+        // The processed copy is not needed for compositing
+        job.analysis.processedFrame.release();
+
+        if (!compositeQueue.push(std::move(job))) {
+            break;
+        }
+    }
+    compositeQueue.close();
+}
+
+void FramePipeline::compositeLoop() {
+    ThreadBudget::active().applyToCurrentThread(PipelineStage::Compositing);
+    TraceRecorder::setThreadName("composite");
+
+    PipelineFrame job;
+    while (compositeQueue.pop(job)) {
+        TraceRecorder::setThreadFrame(job.index);
+        if (!job.faces.empty()) {
+            try {
+                swapper.compositeFaces(job.frame, job.faces, job.timings);
+            } catch (const cv::Exception& e) {
+                LOG_ERROR("Exception in pipeline compositing: " << e.what());
+            }
+        }
+
+        const FrameTimings& t = job.timings;
+        job.timings.totalMs = t.preprocessMs + t.detectMs + t.swapMs + t.restoreMs + t.stabilizeMs + t.blendMs;
+        job.latencyMs = msSince(job.captureTime);
+        if (StageProfiler::instance().isEnabled()) {
+            StageProfiler::instance().record(ProfileStage::Frame,
+                std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double, std::milli>(job.timings.totalMs)));
+        }
+        // Capture to delivery, so queueing gaps show up between the stage spans
+        TraceRecorder::instance().record(StageProfiler::stageName(ProfileStage::Frame), job.captureTime,
+                                         std::chrono::steady_clock::now());
+
+        if (onOutput) {
+            onOutput(job);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(statsMutex);
+            auto now = std::chrono::steady_clock::now();
+            if (delivered == 0) {
+                firstDelivery = now;
+            }
+            lastDelivery = now;
+            totalLatencyMs += job.latencyMs;
+            totalProcessingMs += job.timings.totalMs;
+            delivered++;
+        }
+        deliveredCondition.notify_all();
+    }
+
+    // Let anyone blocked in drain() go
+    deliveredCondition.notify_all();
+}
+
+double FramePipeline::getAverageLatencyMs() const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return delivered > 0 ? totalLatencyMs / delivered : 0.0;
+}
+
+double FramePipeline::getAverageProcessingMs() const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return delivered > 0 ? totalProcessingMs / delivered : 0.0;
+}
+
+void FramePipeline::printSummary(std::ostream& os) const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    if (delivered == 0) {
+        os << "Pipeline: no frames delivered" << std::endl;
+        return;
+    }
+
+    double seconds = std::chrono::duration<double>(lastDelivery - firstDelivery).count();
+    double latency = totalLatencyMs / delivered;
+    double processing = totalProcessingMs / delivered;
+
+    os << std::fixed << std::setprecision(1);
+    os << "Pipeline: " << delivered << " frames delivered, " << dropped << " dropped at capture" << std::endl;
+    if (seconds > 0.0 && delivered > 1) {
+        os << "  Throughput:        " << (delivered - 1) / seconds << " FPS" << std::endl;
+    }
+    os << "  Serial work/frame: " << processing << " ms" << std::endl;
+    os << "  Capture->output:   " << latency << " ms" << std::endl;
+    os << "  Added latency:     " << (latency - processing) << " ms (queueing)" << std::endl;
+}
@@ -0,0 +1,122 @@
+#ifndef FRAME_PIPELINE_HPP
+#define FRAME_PIPELINE_HPP
+
+#include "AdvancedFaceSwapper.hpp"
+#include "BoundedQueue.hpp"
+#include "TripleBuffer.hpp"
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+// One frame travelling through the pipeline
+struct PipelineFrame {
+    uint64_t index = 0;
+    std::chrono::steady_clock::time_point captureTime;
+    cv::Mat frame;                      // captured frame, composited in place
+    FrameAnalysis analysis;
+    std::vector<SwappedFace> faces;
+    FrameTimings timings;               // totalMs = sum of stage times
+    bool swapped = false;               // false if the frame passed through untouched
+    double latencyMs = 0.0;             // capture to delivery
+};
+
+// Staged execution of AdvancedFaceSwapper across consecutive frames.
+//
+//   submit() -> [detection] -> [inference] -> [composite + output callback]
+//
+// Each stage has one worker thread and a bounded queue in front of it, so
+// while frame N is in swap inference, frame N+1 can be in detection and
+// frame N-1 in compositing. One worker per stage and FIFO queues keep
+// delivery in capture order. Throughput approaches the slowest stage; the
+// price is queueing latency, which is measured per frame.
+//
+// A pipeline is started once and stopped once.
+class FramePipeline {
+public:
+    using OutputCallback = std::function<void(PipelineFrame&)>;
+
+    explicit FramePipeline(AdvancedFaceSwapper& swapper, size_t queueDepth = 2);
+    ~FramePipeline();
+
+    // Spawn the stage workers. `onOutput` runs on the composite thread.
+    void start(OutputCallback onOutput);
+
+    // Finish in-flight frames and join the workers
+    void stop();
+
+    bool isRunning() const { return running; }
+
+    // Hand a captured frame to the detection stage. The pipeline keeps a
+    // reference to the pixels, so the caller must not write into `frame`
+    // afterwards. With dropIfBusy the frame is discarded (and counted)
+    // instead of blocking capture while the detection queue is full.
+    bool submit(const cv::Mat& frame, bool dropIfBusy = true);
+
+    // Account for captured frames the caller handled without the pipeline,
+    // so frame indices keep matching capture order
+    void skipFrames(uint64_t count) { nextIndex += count; }
+
+    // Block until every accepted frame has been delivered
+    void drain();
+
+    // Applied by the detection stage before the next frame
+    void setQualitySettings(const QualitySettings& settings);
+
+    // Applied by the inference stage, which reads them, before the next
+    // frame; never blocks either side. One caller thread at a time.
+    void setRuntimeSettings(const RuntimeSettings& settings) {
+        pendingSettings.writeBuffer() = settings;
+        pendingSettings.publish();
+    }
+
+    uint64_t getDeliveredFrames() const { return delivered; }
+    uint64_t getDroppedFrames() const { return dropped; }
+    double getAverageLatencyMs() const;
+    double getAverageProcessingMs() const;
+
+    // Throughput and latency report (added latency = latency - processing)
+    void printSummary(std::ostream& os) const;
+
+private:
+    AdvancedFaceSwapper& swapper;
+    BoundedQueue<PipelineFrame> detectionQueue;
+    BoundedQueue<PipelineFrame> inferenceQueue;
+    BoundedQueue<PipelineFrame> compositeQueue;
+    std::vector<std::thread> workers;
+    OutputCallback onOutput;
+
+    std::atomic<bool> running;
+    std::atomic<uint64_t> nextIndex;
+    std::atomic<uint64_t> accepted;
+    std::atomic<uint64_t> delivered;
+    std::atomic<uint64_t> dropped;
+
+    // Pending quality limits, picked up at the next frame boundary
+    std::mutex qualityMutex;
+    QualitySettings pendingQuality;
+    bool qualityPending;
+
+    // Latest runtime settings, taken by the inference stage
+    TripleBuffer<RuntimeSettings> pendingSettings;
+
+    // Delivery bookkeeping for drain() and the summary
+    mutable std::mutex statsMutex;
+    std::condition_variable deliveredCondition;
+    double totalLatencyMs;
+    double totalProcessingMs;
+    std::chrono::steady_clock::time_point firstDelivery;
+    std::chrono::steady_clock::time_point lastDelivery;
+
+    void detectionLoop();
+    void inferenceLoop();
+    void compositeLoop();
+};
+
+#endif // FRAME_PIPELINE_HPP
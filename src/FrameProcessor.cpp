@@ -0,0 +1,113 @@
+#include "FrameProcessor.hpp"
+#include "StageProfiler.hpp"
+#include <chrono>
+
+namespace {
+// Whole-frame time of processors that have no stage timers of their own
+class FrameTimer {
+public:
+    explicit FrameTimer(FrameTimings& timings)
+        : timings(timings)
+        , profile(ProfileStage::Frame)
+        , start(std::chrono::steady_clock::now())
+    {
+        timings = FrameTimings();
+        timings.detectionRan = true;
+    }
+
+    ~FrameTimer() {
+        timings.totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+private:
+    FrameTimings& timings;
+    ScopedProfile profile;
+    std::chrono::steady_clock::time_point start;
+};
+}
+
+const char* FrameProcessor::modeName(ProcessingMode mode) {
+    switch (mode) {
+        case ProcessingMode::Basic: return "basic";
+        case ProcessingMode::Advanced: return "advanced";
+        case ProcessingMode::Anonymize: return "anonymize";
+        default: return "unknown";
+    }
+}
+
+bool FrameProcessor::parseMode(const std::string& name, ProcessingMode& mode) {
+    for (int i = 0; i < static_cast<int>(ProcessingMode::Count); i++) {
+        if (name == modeName(static_cast<ProcessingMode>(i))) {
+            mode = static_cast<ProcessingMode>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+BasicFrameProcessor::BasicFrameProcessor(const AdvancedFaceSwapper* sourceProvider)
+    : sourceProvider(sourceProvider)
+    , sourceGeneration(0)
+{
+}
+
+bool BasicFrameProcessor::loadModel(const std::string& detectionModelPath) {
+    return swapper.loadModel(detectionModelPath);
+}
+
+void BasicFrameProcessor::syncSource() {
+    if (!sourceProvider) {
+        return;
+    }
+    // A new source was published (upload, face directory); counter compare only
+    uint64_t generation = sourceProvider->getSourceGeneration();
+    if (generation == sourceGeneration) {
+        return;
+    }
+    sourceGeneration = generation;
+    std::shared_ptr<const SourceFace> source = sourceProvider->getSourceFace();
+    if (source && source != currentSource) {
+        swapper.setSourceFace(source->image, source->faceRect, source->landmarks);
+        currentSource = std::move(source);
+    }
+}
+
+bool BasicFrameProcessor::isReady() const {
+    return swapper.isSourceFaceLoaded() || (sourceProvider && sourceProvider->isSourceFaceLoaded());
+}
+
+void BasicFrameProcessor::process(cv::Mat& frame, const cv::Mat*) {
+    FrameTimer timer(timings);
+    syncSource();
+    swapper.detectAndSwap(frame);
+}
+
+AdvancedFrameProcessor::AdvancedFrameProcessor(AdvancedFaceSwapper& swapper)
+    : swapper(swapper)
+{
+}
+
+AdvancedFrameProcessor::AdvancedFrameProcessor(std::unique_ptr<AdvancedFaceSwapper> swapper)
+    : owned(std::move(swapper))
+    , swapper(*owned)
+{
+}
+
+void AdvancedFrameProcessor::process(cv::Mat& frame, const cv::Mat* knownFaces) {
+    swapper.detectAndSwap(frame, knownFaces);
+}
+
+AnonymizeFrameProcessor::AnonymizeFrameProcessor()
+    : loaded(false)
+{
+}
+
+bool AnonymizeFrameProcessor::loadModel(const std::string& detectionModelPath) {
+    loaded = anonymizer.loadModel(detectionModelPath);
+    return loaded;
+}
+
+void AnonymizeFrameProcessor::process(cv::Mat& frame, const cv::Mat*) {
+    FrameTimer timer(timings);
+    anonymizer.detectAndBlur(frame);
+}
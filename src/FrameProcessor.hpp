@@ -0,0 +1,124 @@
+#ifndef FRAME_PROCESSOR_HPP
+#define FRAME_PROCESSOR_HPP
+
+#include "AdvancedFaceSwapper.hpp"
+#include "FaceAnonymizer.hpp"
+#include "FaceSwapper.hpp"
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// What the frame loop does to each frame
+enum class ProcessingMode {
+    Basic = 0,      // FaceSwapper: geometric warp, detector only
+    Advanced,       // AdvancedFaceSwapper: ArcFace + INSwapper (+ GFPGAN)
+    Anonymize,      // FaceAnonymizer: blur every face
+    Count
+};
+
+// One way of turning a captured frame into an output frame. Each
+// implementation keeps its models loaded for its whole lifetime, so the
+// frame loop can switch between them at any frame boundary. Not
+// thread-safe: call from the frame thread only.
+class FrameProcessor {
+public:
+    virtual ~FrameProcessor() = default;
+
+    virtual ProcessingMode getMode() const = 0;
+
+    // Has what it needs to change frames (e.g. a source face); frames pass
+    // through untouched otherwise
+    virtual bool isReady() const = 0;
+
+    // Process one frame in place. `knownFaces` (YuNet rows, e.g. from a
+    // recording) replaces the detector where supported.
+    virtual void process(cv::Mat& frame, const cv::Mat* knownFaces = nullptr) = 0;
+
+    // Forget temporal state (tracks, stabilization) before a discontinuity:
+    // a seek, or becoming active again after another processor ran
+    virtual void reset() {}
+
+    virtual int getFaceCount() const = 0;
+
+    // Timings of the last process() call (processors without separate
+    // stages only fill in totalMs)
+    virtual const FrameTimings& getLastFrameTimings() const = 0;
+
+    virtual void setQualitySettings(const QualitySettings&) {}
+    virtual void setBlendStrength(float) {}
+
+    static const char* modeName(ProcessingMode mode);
+    static bool parseMode(const std::string& name, ProcessingMode& mode);
+};
+
+// Lightweight geometric swap. Follows the source face of an
+// AdvancedFaceSwapper when given one, so both modes always swap in the same
+// face; the switch reuses the prepared detection instead of detecting again.
+class BasicFrameProcessor : public FrameProcessor {
+public:
+    explicit BasicFrameProcessor(const AdvancedFaceSwapper* sourceProvider = nullptr);
+
+    bool loadModel(const std::string& detectionModelPath);
+    FaceSwapper& getSwapper() { return swapper; }
+
+    ProcessingMode getMode() const override { return ProcessingMode::Basic; }
+    bool isReady() const override;
+    void process(cv::Mat& frame, const cv::Mat* knownFaces = nullptr) override;
+    int getFaceCount() const override { return swapper.getFaceCount(); }
+    const FrameTimings& getLastFrameTimings() const override { return timings; }
+    void setBlendStrength(float strength) override { swapper.setBlendStrength(strength); }
+
+private:
+    FaceSwapper swapper;
+    const AdvancedFaceSwapper* sourceProvider;
+    std::shared_ptr<const SourceFace> currentSource;
+    uint64_t sourceGeneration;
+    FrameTimings timings;
+
+    void syncSource();
+};
+
+// The full model pipeline. Either borrows a swapper (the live loop's, shared
+// with FramePipeline) or owns one (batch workers).
+class AdvancedFrameProcessor : public FrameProcessor {
+public:
+    explicit AdvancedFrameProcessor(AdvancedFaceSwapper& swapper);
+    explicit AdvancedFrameProcessor(std::unique_ptr<AdvancedFaceSwapper> swapper);
+
+    AdvancedFaceSwapper& getSwapper() { return swapper; }
+
+    ProcessingMode getMode() const override { return ProcessingMode::Advanced; }
+    bool isReady() const override { return swapper.isReadyToSwap(); }
+    void process(cv::Mat& frame, const cv::Mat* knownFaces = nullptr) override;
+    void reset() override { swapper.resetTemporalState(); }
+    int getFaceCount() const override { return swapper.getFaceCount(); }
+    const FrameTimings& getLastFrameTimings() const override { return swapper.getLastFrameTimings(); }
+    void setQualitySettings(const QualitySettings& settings) override { swapper.setQualitySettings(settings); }
+    void setBlendStrength(float strength) override { swapper.setBlendStrength(strength); }
+
+private:
+    std::unique_ptr<AdvancedFaceSwapper> owned;
+    AdvancedFaceSwapper& swapper;
+};
+
+class AnonymizeFrameProcessor : public FrameProcessor {
+public:
+    AnonymizeFrameProcessor();
+
+    bool loadModel(const std::string& detectionModelPath);
+    FaceAnonymizer& getAnonymizer() { return anonymizer; }
+
+    ProcessingMode getMode() const override { return ProcessingMode::Anonymize; }
+    bool isReady() const override { return loaded; }
+    void process(cv::Mat& frame, const cv::Mat* knownFaces = nullptr) override;
+    int getFaceCount() const override { return anonymizer.getFaceCount(); }
+    const FrameTimings& getLastFrameTimings() const override { return timings; }
+
+private:
+    FaceAnonymizer anonymizer;
+    bool loaded;
+    FrameTimings timings;
+};
+
+#endif // FRAME_PROCESSOR_HPP
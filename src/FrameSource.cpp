@@ -0,0 +1,123 @@
+#include "FrameSource.hpp"
+#include <iostream>
+#include <thread>
+
+FrameSource::FrameSource()
+    : fromFile(false)
+    , realtime(false)
+    , width(0)
+    , height(0)
+    , fps(0.0)
+    , recordedFacesValid(false)
+    , replayRealtime(false)
+    , havePlaybackStart(false)
+    , firstTimestampUs(0)
+{
+}
+
+bool FrameSource::openCamera(int index, int requestedWidth, int requestedHeight) {
+    recording.reset();
+    capture.open(index);
+    if (!capture.isOpened()) {
+        std::cerr << "Error: Could not open camera " << index << "." << std::endl;
+        return false;
+    }
+
+    capture.set(cv::CAP_PROP_FRAME_WIDTH, requestedWidth);
+    capture.set(cv::CAP_PROP_FRAME_HEIGHT, requestedHeight);
+
+    // Get actual resolution
+    width = static_cast<int>(capture.get(cv::CAP_PROP_FRAME_WIDTH));
+    height = static_cast<int>(capture.get(cv::CAP_PROP_FRAME_HEIGHT));
+    fps = capture.get(cv::CAP_PROP_FPS);
+    fromFile = false;
+    realtime = false;
+    description = "camera " + std::to_string(index);
+    return true;
+}
+
+bool FrameSource::openFile(const std::string& path, bool paceRealtime) {
+    recording.reset();
+    capture.open(path);
+    if (!capture.isOpened()) {
+        std::cerr << "Error: Could not open input file: " << path << std::endl;
+        return false;
+    }
+
+    width = static_cast<int>(capture.get(cv::CAP_PROP_FRAME_WIDTH));
+    height = static_cast<int>(capture.get(cv::CAP_PROP_FRAME_HEIGHT));
+    fps = capture.get(cv::CAP_PROP_FPS);
+    fromFile = true;
+    realtime = paceRealtime && fps > 0.0;
+    description = path;
+    nextFrameTime = std::chrono::steady_clock::now();
+    return true;
+}
+
+bool FrameSource::openRecording(const std::string& path, bool paceRealtime, size_t startFrame) {
+    auto reader = std::make_unique<SessionReader>();
+    if (!reader->open(path)) {
+        return false;
+    }
+    if (!reader->seek(startFrame)) {
+        std::cerr << "Error: Recording has only " << reader->getFrameCount() << " frames: " << path << std::endl;
+        return false;
+    }
+
+    capture.release();
+    width = reader->getWidth();
+    height = reader->getHeight();
+    fps = 0.0;
+    fromFile = true;
+    realtime = false;
+    replayRealtime = paceRealtime;
+    havePlaybackStart = false;
+    description = path + " (" + std::to_string(reader->getFrameCount()) + " recorded frames)";
+    recording = std::move(reader);
+    return true;
+}
+
+bool FrameSource::readRecording(cv::Mat& frame) {
+    recordedFacesValid = false;
+    if (!recording->next(recorded)) {
+        return false;
+    }
+
+    // Reproduce the original spacing between captures
+    if (replayRealtime) {
+        if (!havePlaybackStart) {
+            playbackStart = std::chrono::steady_clock::now();
+            firstTimestampUs = recorded.timestampUs;
+            havePlaybackStart = true;
+        }
+        std::this_thread::sleep_until(playbackStart + std::chrono::microseconds(recorded.timestampUs - firstTimestampUs));
+    }
+
+    frame = recorded.frame;
+    recordedFaces = recorded.faces;
+    recordedFacesValid = recorded.hasFaces;
+    return !frame.empty();
+}
+
+bool FrameSource::read(cv::Mat& frame) {
+    if (recording) {
+        return readRecording(frame);
+    }
+    if (realtime) {
+        auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(1.0 / fps));
+        auto now = std::chrono::steady_clock::now();
+        if (now > nextFrameTime + period) {
+            // Fell behind; drop the backlog instead of bursting to catch up
+            nextFrameTime = now;
+        }
+        std::this_thread::sleep_until(nextFrameTime);
+        nextFrameTime += period;
+    }
+    return capture.read(frame) && !frame.empty();
+}
+
+void FrameSource::release() {
+    capture.release();
+    recording.reset();
+}
@@ -0,0 +1,68 @@
+#ifndef FRAME_SOURCE_HPP
+#define FRAME_SOURCE_HPP
+
+#include "SessionRecorder.hpp"
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <memory>
+#include <string>
+
+// Where frames come from: a live camera, a video/image file or a session
+// recording (.fsrec, see SessionRecorder).
+//
+// For files, read() returns false at the end of the clip instead of
+// treating it as a capture error. With realtime pacing a file is delivered
+// at its native frame rate, like a camera would, and a recording with its
+// original capture timing; without it frames come as fast as the caller
+// asks for them (benchmarks, regression runs).
+class FrameSource {
+public:
+    FrameSource();
+
+    // Open camera `index` and request width x height
+    bool openCamera(int index, int width, int height);
+
+    // Open a video or image file
+    bool openFile(const std::string& path, bool realtime = false);
+
+    // Open a session recording, starting at its `startFrame`-th frame
+    bool openRecording(const std::string& path, bool realtime = false, size_t startFrame = 0);
+
+    bool read(cv::Mat& frame);
+    void release();
+
+    bool isFile() const { return fromFile; }
+    bool isOpened() const { return capture.isOpened() || recording != nullptr; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    double getFps() const { return fps; }
+    const std::string& describe() const { return description; }
+
+    // Detector output stored with the last frame read from a recording
+    bool hasRecordedFaces() const { return recordedFacesValid; }
+    const cv::Mat& getRecordedFaces() const { return recordedFaces; }
+
+private:
+    bool readRecording(cv::Mat& frame);
+
+    cv::VideoCapture capture;
+    bool fromFile;
+    bool realtime;
+    int width;
+    int height;
+    double fps;
+    std::string description;
+    std::chrono::steady_clock::time_point nextFrameTime;
+
+    // Recording playback
+    std::unique_ptr<SessionReader> recording;
+    RecordedFrame recorded;
+    cv::Mat recordedFaces;
+    bool recordedFacesValid;
+    bool replayRealtime;
+    bool havePlaybackStart;
+    int64_t firstTimestampUs;
+    std::chrono::steady_clock::time_point playbackStart;
+};
+
+#endif // FRAME_SOURCE_HPP
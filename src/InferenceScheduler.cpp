@@ -0,0 +1,371 @@
+#include "InferenceScheduler.hpp"
+#include "Logger.hpp"
+#include "ThreadBudget.hpp"
+#include "TraceRecorder.hpp"
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <set>
+
+namespace {
+std::vector<int> shapeOf(const cv::Mat& tensor) {
+    std::vector<int> sizes;
+    for (int d = 0; d < tensor.dims; d++) {
+        sizes.push_back(tensor.size[d]);
+    }
+    return sizes;
+}
+
+bool loadNet(cv::dnn::Net& net, const std::string& modelPath, const char* name) {
+    try {
+        net = cv::dnn::readNetFromONNX(modelPath);
+    } catch (const cv::Exception& e) {
+        std::cerr << "Exception loading " << name << " model: " << e.what() << std::endl;
+        net = cv::dnn::Net();
+        return false;
+    }
+    if (net.empty()) {
+        std::cerr << "Warning: Could not load " << name << " model from: " << modelPath << std::endl;
+        return false;
+    }
+    net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+    net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+    std::cout << name << " model loaded (shared by all streams)." << std::endl;
+    return true;
+}
+}
+
+InferenceScheduler::InferenceScheduler()
+    : arcFaceBatches(true)
+    , inSwapperBatches(true)
+    , maxBatch(8)
+    , batchWindowMs(0.0)
+    , pendingRequests(0)
+    , nextStream(0)
+    , running(false)
+    , batches(0)
+    , requests(0)
+    , batchSizes{}
+    , busySeconds(0.0)
+{
+}
+
+InferenceScheduler::~InferenceScheduler() {
+    stop();
+}
+
+bool InferenceScheduler::loadArcFaceModel(const std::string& modelPath) {
+    if (!loadNet(arcFaceNet, modelPath, "ArcFace")) {
+        return false;
+    }
+    arcFaceModelPath = modelPath;
+    arcFaceBatches = true;
+    return true;
+}
+
+bool InferenceScheduler::loadInSwapperModel(const std::string& modelPath) {
+    if (!loadNet(inSwapperNet, modelPath, "INSwapper")) {
+        return false;
+    }
+    inSwapperBatches = true;
+    return true;
+}
+
+int InferenceScheduler::addStream(const std::string& name, int weight) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto stream = std::make_unique<Stream>();
+    stream->name = name;
+    stream->weight = std::max(1, weight);
+    streams.push_back(std::move(stream));
+    return static_cast<int>(streams.size()) - 1;
+}
+
+bool InferenceScheduler::start() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (running) {
+        return true;
+    }
+    running = true;
+    startTime = std::chrono::steady_clock::now();
+    worker = std::thread(&InferenceScheduler::workerLoop, this);
+    return true;
+}
+
+void InferenceScheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running) {
+            return;
+        }
+        running = false;
+        stopTime = std::chrono::steady_clock::now();
+    }
+    requestQueued.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+cv::Mat InferenceScheduler::forwardEmbedding(int stream, const cv::Mat& blob) {
+    if (arcFaceNet.empty() || blob.empty()) {
+        return cv::Mat();
+    }
+    Request request;
+    request.network = Network::ArcFace;
+    request.stream = stream;
+    request.input = blob;
+    return submit(request);
+}
+
+cv::Mat InferenceScheduler::forwardSwap(int stream, const cv::Mat& targetBlob, const cv::Mat& latent) {
+    if (inSwapperNet.empty() || targetBlob.empty() || latent.empty()) {
+        return cv::Mat();
+    }
+    Request request;
+    request.network = Network::InSwapper;
+    request.stream = stream;
+    request.input = targetBlob;
+    request.latent = latent;
+    return submit(request);
+}
+
+cv::Mat InferenceScheduler::submit(Request& request) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!running || request.stream < 0 || request.stream >= static_cast<int>(streams.size())) {
+        return cv::Mat();
+    }
+    request.queued = std::chrono::steady_clock::now();
+    streams[request.stream]->queue.push_back(&request);
+    pendingRequests++;
+    requestQueued.notify_one();
+    requestDone.wait(lock, [&request] { return request.done; });
+    return request.output;
+}
+
+void InferenceScheduler::workerLoop() {
+    TraceRecorder::setThreadName("inference");
+    ThreadBudget::active().applyToCurrentThread(PipelineStage::SwapInference);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        requestQueued.wait(lock, [this] { return !running || pendingRequests > 0; });
+        if (pendingRequests == 0) {
+            break;  // stopped, and every caller has its answer
+        }
+        // Give other streams a moment to join the batch
+        if (running && batchWindowMs > 0.0 && pendingRequests < static_cast<size_t>(maxBatch)) {
+            requestQueued.wait_for(lock, std::chrono::duration<double, std::milli>(batchWindowMs), [this] {
+                return !running || pendingRequests >= static_cast<size_t>(maxBatch);
+            });
+        }
+
+        std::vector<Request*> batch = takeBatch();
+        if (batch.empty()) {
+            continue;
+        }
+        lock.unlock();
+        auto start = std::chrono::steady_clock::now();
+        bool onePass = runBatch(batch);
+        auto end = std::chrono::steady_clock::now();
+        TraceRecorder::instance().record(batch.front()->network == Network::InSwapper ? "batch_swap" : "batch_embed",
+                                         start, end);
+        lock.lock();
+
+        if (onePass) {
+            batches++;
+            batchSizes[std::min<size_t>(batch.size(), batchSizes.size() - 1)]++;
+        } else {
+            batches += batch.size();
+            batchSizes[1] += batch.size();
+        }
+        requests += batch.size();
+        busySeconds += std::chrono::duration<double>(end - start).count();
+
+        std::set<int> batchStreams;
+        for (const Request* request : batch) {
+            batchStreams.insert(request->stream);
+        }
+        for (Request* request : batch) {
+            StreamStats& stats = streams[request->stream]->stats;
+            double waitMs = std::chrono::duration<double, std::milli>(end - request->queued).count();
+            (request->network == Network::InSwapper ? stats.swaps : stats.embeds)++;
+            if (onePass && batchStreams.size() > 1) {
+                stats.batched++;
+            }
+            stats.waitMs += waitMs;
+            stats.maxWaitMs = std::max(stats.maxWaitMs, waitMs);
+            request->done = true;
+        }
+        requestDone.notify_all();
+    }
+}
+
+std::vector<InferenceScheduler::Request*> InferenceScheduler::takeBatch() {
+    std::vector<Request*> batch;
+    size_t count = streams.size();
+    if (count == 0) {
+        return batch;
+    }
+
+    // The batch runs the network the stream whose turn it is waits for
+    size_t first = nextStream % count;
+    Network network = Network::ArcFace;
+    bool found = false;
+    for (size_t i = 0; i < count && !found; i++) {
+        const Stream& stream = *streams[(first + i) % count];
+        if (!stream.queue.empty()) {
+            network = stream.queue.front()->network;
+            found = true;
+        }
+    }
+    if (!found) {
+        return batch;
+    }
+    nextStream = (first + 1) % count;
+
+    // Rounds of up to `weight` requests per stream until the batch is full
+    size_t limit = static_cast<size_t>(maxBatch);
+    bool took = true;
+    while (took && batch.size() < limit) {
+        took = false;
+        for (size_t i = 0; i < count && batch.size() < limit; i++) {
+            Stream& stream = *streams[(first + i) % count];
+            for (int slot = 0; slot < stream.weight && batch.size() < limit; slot++) {
+                if (stream.queue.empty() || stream.queue.front()->network != network) {
+                    break;
+                }
+                batch.push_back(stream.queue.front());
+                stream.queue.pop_front();
+                took = true;
+            }
+        }
+    }
+    pendingRequests -= batch.size();
+    return batch;
+}
+
+bool InferenceScheduler::runBatch(const std::vector<Request*>& batch) {
+    bool swap = batch.front()->network == Network::InSwapper;
+    cv::dnn::Net& net = swap ? inSwapperNet : arcFaceNet;
+    bool& batchable = swap ? inSwapperBatches : arcFaceBatches;
+
+    if (batch.size() > 1 && batchable) {
+        cv::Mat inputs = stack(batch, false);
+        cv::Mat latents = swap ? stack(batch, true) : cv::Mat();
+        if (!inputs.empty() && (!swap || !latents.empty())) {
+            try {
+                if (swap) {
+                    net.setInput(inputs, "target");
+                    net.setInput(latents, "source");
+                } else {
+                    net.setInput(inputs);
+                }
+                cv::Mat output = net.forward();
+                if (output.dims >= 2 && output.size[0] == static_cast<int>(batch.size())) {
+                    // Split along the batch dimension
+                    std::vector<int> sizes = shapeOf(output);
+                    sizes[0] = 1;
+                    for (size_t i = 0; i < batch.size(); i++) {
+                        batch[i]->output = cv::Mat(output.dims, sizes.data(), output.type(),
+                                                   output.ptr(static_cast<int>(i))).clone();
+                    }
+                    return true;
+                }
+            } catch (const cv::Exception& e) {
+                LOG_DEBUG("Batched forward failed: " << e.what());
+            }
+            batchable = false;
+            std::cerr << "Warning: " << (swap ? "INSwapper" : "ArcFace")
+                      << " model does not take batches; running requests one at a time" << std::endl;
+        }
+    }
+
+    for (Request* request : batch) {
+        request->output = forwardOne(net, *request);
+    }
+    return batch.size() == 1;
+}
+
+cv::Mat InferenceScheduler::forwardOne(cv::dnn::Net& net, const Request& request) {
+    try {
+        if (request.network == Network::InSwapper) {
+            net.setInput(request.input, "target");
+            net.setInput(request.latent, "source");
+        } else {
+            net.setInput(request.input);
+        }
+        return net.forward().clone();
+    } catch (const cv::Exception& e) {
+        LOG_ERROR("Error in shared " << (request.network == Network::InSwapper ? "INSwapper" : "ArcFace")
+                  << " inference: " << e.what());
+        return cv::Mat();
+    }
+}
+
+cv::Mat InferenceScheduler::stack(const std::vector<Request*>& batch, bool latents) {
+    // Concatenate [1,...] tensors of one shape into [N,...]
+    const cv::Mat& first = latents ? batch.front()->latent : batch.front()->input;
+    std::vector<int> sizes = shapeOf(first);
+    if (sizes.empty() || sizes[0] != 1) {
+        return cv::Mat();
+    }
+    size_t bytes = first.total() * first.elemSize();
+    sizes[0] = static_cast<int>(batch.size());
+    cv::Mat stacked(first.dims, sizes.data(), first.type());
+    for (size_t i = 0; i < batch.size(); i++) {
+        const cv::Mat& tensor = latents ? batch[i]->latent : batch[i]->input;
+        if (tensor.type() != first.type() || tensor.total() * tensor.elemSize() != bytes || !tensor.isContinuous()) {
+            return cv::Mat();
+        }
+        std::memcpy(stacked.ptr(static_cast<int>(i)), tensor.ptr(), bytes);
+    }
+    return stacked;
+}
+
+InferenceScheduler::StreamStats InferenceScheduler::getStreamStats(int stream) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (stream < 0 || stream >= static_cast<int>(streams.size())) {
+        return StreamStats();
+    }
+    return streams[stream]->stats;
+}
+
+std::string InferenceScheduler::getStreamName(int stream) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (stream < 0 || stream >= static_cast<int>(streams.size())) {
+        return std::string();
+    }
+    return streams[stream]->name;
+}
+
+void InferenceScheduler::printSummary(std::ostream& os) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (batches == 0) {
+        os << "Inference: no requests" << std::endl;
+        return;
+    }
+    auto end = running ? std::chrono::steady_clock::now() : stopTime;
+    double wallSeconds = std::chrono::duration<double>(end - startTime).count();
+
+    os << std::fixed << std::setprecision(1);
+    os << "Inference: " << requests << " requests in " << batches << " passes ("
+       << std::setprecision(2) << static_cast<double>(requests) / batches << " per pass), "
+       << std::setprecision(1) << (wallSeconds > 0.0 ? 100.0 * busySeconds / wallSeconds : 0.0) << "% busy" << std::endl;
+    os << "  Pass sizes:    ";
+    for (size_t size = 1; size < batchSizes.size(); size++) {
+        if (batchSizes[size] > 0) {
+            os << " " << size << (size + 1 == batchSizes.size() ? "+" : "") << ": " << batchSizes[size];
+        }
+    }
+    os << std::endl;
+    for (const auto& stream : streams) {
+        const StreamStats& stats = stream->stats;
+        uint64_t total = stats.embeds + stats.swaps;
+        if (total == 0) continue;
+        os << "  " << std::left << std::setw(14) << stream->name << std::right
+           << std::setw(8) << stats.swaps << " swaps, " << std::setw(6) << stats.embeds << " embeds, "
+           << std::setw(5) << 100.0 * stats.batched / total << "% shared, wait "
+           << std::setprecision(2) << stats.waitMs / total << " ms avg / " << stats.maxWaitMs << " ms max"
+           << std::setprecision(1) << " (weight " << stream->weight << ")" << std::endl;
+    }
+}
@@ -0,0 +1,132 @@
+#ifndef INFERENCE_SCHEDULER_HPP
+#define INFERENCE_SCHEDULER_HPP
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/dnn.hpp>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One copy of the ArcFace and INSwapper networks serving several streams.
+//
+// Stream threads hand their network inputs to forwardEmbedding() or
+// forwardSwap() and block until the result is back. A single inference
+// thread runs the requests; whatever is queued for the same network when it
+// gets to them goes through one batched forward pass, so streams that are
+// ready at the same time share it. If the model rejects a batch (fixed
+// batch dimension) the scheduler falls back to one request per pass.
+//
+// Fairness: streams are visited round-robin, starting one further along for
+// every batch, and each stream contributes at most `weight` requests per
+// round, so a stream with many faces cannot crowd out the others. Since a
+// call blocks its thread, a stream only has several requests queued if it
+// makes them from several threads (face workers).
+class InferenceScheduler {
+public:
+    struct StreamStats {
+        uint64_t embeds = 0;
+        uint64_t swaps = 0;
+        uint64_t batched = 0;       // requests that shared a pass with another stream's
+        double waitMs = 0.0;        // queued + running, summed over requests
+        double maxWaitMs = 0.0;
+    };
+
+    InferenceScheduler();
+    ~InferenceScheduler();
+
+    bool loadArcFaceModel(const std::string& modelPath);
+    bool loadInSwapperModel(const std::string& modelPath);
+    bool hasArcFace() const { return !arcFaceNet.empty(); }
+    bool hasInSwapper() const { return !inSwapperNet.empty(); }
+    const std::string& getArcFaceModelPath() const { return arcFaceModelPath; }
+
+    // Requests per forward pass (default: 8)
+    void setMaxBatch(int requests) { maxBatch = std::max(1, requests); }
+    // Time the first request of a batch may wait for others (default: 0,
+    // only requests that are already queued are batched)
+    void setBatchWindow(double ms) { batchWindowMs = std::max(0.0, ms); }
+
+    // Register a stream; the returned ID goes with its requests. Any thread.
+    int addStream(const std::string& name, int weight = 1);
+
+    bool start();
+    void stop();
+
+    // Any thread: run ArcFace on a [1,3,112,112] blob, or INSwapper on a
+    // [1,3,128,128] target blob and a [1,512] source latent. Blocks until
+    // done; empty on failure.
+    cv::Mat forwardEmbedding(int stream, const cv::Mat& blob);
+    cv::Mat forwardSwap(int stream, const cv::Mat& targetBlob, const cv::Mat& latent);
+
+    StreamStats getStreamStats(int stream) const;
+    std::string getStreamName(int stream) const;
+
+    // Batches, batch sizes, inference thread load and per-stream waits
+    void printSummary(std::ostream& os) const;
+
+private:
+    enum class Network { ArcFace, InSwapper };
+
+    struct Request {
+        Network network;
+        int stream;
+        cv::Mat input;
+        cv::Mat latent;
+        cv::Mat output;
+        bool done = false;
+        std::chrono::steady_clock::time_point queued;
+    };
+
+    struct Stream {
+        std::string name;
+        int weight = 1;
+        std::deque<Request*> queue;
+        StreamStats stats;
+    };
+
+    cv::dnn::Net arcFaceNet;
+    cv::dnn::Net inSwapperNet;
+    std::string arcFaceModelPath;
+    // Cleared on the inference thread when a batched pass fails
+    bool arcFaceBatches;
+    bool inSwapperBatches;
+
+    int maxBatch;
+    double batchWindowMs;
+
+    mutable std::mutex mutex;
+    std::condition_variable requestQueued;
+    std::condition_variable requestDone;
+    std::vector<std::unique_ptr<Stream>> streams;
+    size_t pendingRequests;
+    size_t nextStream;
+    bool running;
+    std::thread worker;
+
+    // Inference thread statistics (under mutex)
+    uint64_t batches;
+    uint64_t requests;
+    std::array<uint64_t, 9> batchSizes;     // index = requests per pass, last = 8 or more
+    double busySeconds;
+    std::chrono::steady_clock::time_point startTime;
+    std::chrono::steady_clock::time_point stopTime;
+
+    cv::Mat submit(Request& request);
+    void workerLoop();
+    std::vector<Request*> takeBatch();
+    // True if the batch ran as a single forward pass
+    bool runBatch(const std::vector<Request*>& batch);
+    static cv::Mat forwardOne(cv::dnn::Net& net, const Request& request);
+    static cv::Mat stack(const std::vector<Request*>& batch, bool latents);
+};
+
+#endif // INFERENCE_SCHEDULER_HPP
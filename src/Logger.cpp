@@ -0,0 +1,119 @@
+#include "Logger.hpp"
+#include <iostream>
+
+namespace {
+// Lines waiting for the writer before new ones are dropped
+const size_t MAX_QUEUED_LINES = 4096;
+
+int64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+}
+
+bool LogSite::allow(uint32_t maxPerSecond, uint32_t& suppressed) {
+    suppressed = 0;
+    if (maxPerSecond == 0) {
+        return true;
+    }
+
+    int64_t now = nowMs();
+    int64_t start = windowStart.load(std::memory_order_relaxed);
+    if (now - start >= 1000 && windowStart.compare_exchange_strong(start, now)) {
+        windowCount = 0;
+    }
+
+    if (windowCount.fetch_add(1, std::memory_order_relaxed) >= maxPerSecond) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    suppressed = dropped.exchange(0, std::memory_order_relaxed);
+    return true;
+}
+
+Logger& Logger::instance() {
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger()
+    : minLevel(static_cast<int>(LogLevel::Info))
+    , rateLimit(10)
+    , droppedLines(0)
+    , writing(false)
+    , stopping(false)
+{
+    writer = std::thread(&Logger::writerLoop, this);
+}
+
+Logger::~Logger() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    queueReady.notify_one();
+    if (writer.joinable()) {
+        writer.join();
+    }
+}
+
+void Logger::write(LogLevel level, std::string message) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (queue.size() >= MAX_QUEUED_LINES) {
+            droppedLines++;
+            return;
+        }
+        queue.push_back(Record{level, std::move(message)});
+    }
+    queueReady.notify_one();
+}
+
+void Logger::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    queueEmpty.wait(lock, [this] { return (queue.empty() && !writing) || stopping; });
+}
+
+void Logger::writerLoop() {
+    std::deque<Record> batch;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            writing = false;
+            queueEmpty.notify_all();
+            queueReady.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (queue.empty()) {
+                return;
+            }
+            batch.swap(queue);
+            writing = true;
+        }
+
+        // One flush per batch instead of one per line
+        bool wroteOut = false;
+        bool wroteErr = false;
+        for (const Record& record : batch) {
+            if (record.level >= LogLevel::Warn) {
+                std::cerr << record.text << '\n';
+                wroteErr = true;
+            } else {
+                std::cout << record.text << '\n';
+                wroteOut = true;
+            }
+        }
+        if (wroteOut) std::cout.flush();
+        if (wroteErr) std::cerr.flush();
+        batch.clear();
+    }
+}
+
+bool Logger::parseLevel(const std::string& name, LogLevel& level) {
+    if (name == "trace") level = LogLevel::Trace;
+    else if (name == "debug") level = LogLevel::Debug;
+    else if (name == "info") level = LogLevel::Info;
+    else if (name == "warn") level = LogLevel::Warn;
+    else if (name == "error") level = LogLevel::Error;
+    else if (name == "off") level = LogLevel::Off;
+    else return false;
+    return true;
+}
@@ -0,0 +1,126 @@
+#ifndef LOGGER_HPP
+#define LOGGER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+enum class LogLevel {
+    Trace = 0,
+    Debug,
+    Info,
+    Warn,
+    Error,
+    Off
+};
+
+// Per call site rate limiter. Every LOG_* macro owns a static one, so a
+// message repeated on every frame prints at most `maxPerSecond` times per
+// second; the rest are counted and reported with the next line that gets out.
+class LogSite {
+public:
+    // Returns false if the line should be dropped. On true, `suppressed` is
+    // the number of lines dropped since the last one that got through.
+    bool allow(uint32_t maxPerSecond, uint32_t& suppressed);
+
+private:
+    std::atomic<int64_t> windowStart{0};
+    std::atomic<uint32_t> windowCount{0};
+    std::atomic<uint32_t> dropped{0};
+};
+
+// Process-wide logger with a background writer thread.
+//
+// Call sites only format the message (and only if the level is enabled) and
+// hand it to a bounded queue; the writer thread does the terminal I/O, so a
+// slow console never stalls the frame loop. If the queue is full the line is
+// dropped and counted instead of blocking.
+//
+// Info and below go to stdout, Warn and Error to stderr.
+class Logger {
+public:
+    static Logger& instance();
+
+    void setLevel(LogLevel level) { minLevel = static_cast<int>(level); }
+    LogLevel getLevel() const { return static_cast<LogLevel>(minLevel.load(std::memory_order_relaxed)); }
+    bool isEnabled(LogLevel level) const {
+        return static_cast<int>(level) >= minLevel.load(std::memory_order_relaxed);
+    }
+
+    // Lines per second allowed through each call site (0 = unlimited)
+    void setRateLimit(uint32_t maxPerSecond) { rateLimit = maxPerSecond; }
+    uint32_t getRateLimit() const { return rateLimit.load(std::memory_order_relaxed); }
+
+    void write(LogLevel level, std::string message);
+
+    // Block until everything queued so far has been written
+    void flush();
+
+    uint64_t getDroppedCount() const { return droppedLines; }
+
+    // "trace", "debug", "info", "warn", "error", "off"
+    static bool parseLevel(const std::string& name, LogLevel& level);
+
+private:
+    Logger();
+    ~Logger();
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    struct Record {
+        LogLevel level;
+        std::string text;
+    };
+
+    std::atomic<int> minLevel;
+    std::atomic<uint32_t> rateLimit;
+    std::atomic<uint64_t> droppedLines;
+
+    std::mutex mutex;
+    std::condition_variable queueReady;
+    std::condition_variable queueEmpty;
+    std::deque<Record> queue;
+    bool writing;
+    bool stopping;
+    std::thread writer;
+
+    void writerLoop();
+};
+
+#define LOG_AT(level, expr) \
+    do { \
+        if (Logger::instance().isEnabled(level)) { \
+            static LogSite logSite_; \
+            uint32_t logSuppressed_ = 0; \
+            if (logSite_.allow(Logger::instance().getRateLimit(), logSuppressed_)) { \
+                std::ostringstream logStream_; \
+                logStream_ << expr; \
+                if (logSuppressed_ > 0) { \
+                    logStream_ << " (" << logSuppressed_ << " similar suppressed)"; \
+                } \
+                Logger::instance().write(level, logStream_.str()); \
+            } \
+        } \
+    } while (0)
+
+#define LOG_ERROR(expr) LOG_AT(LogLevel::Error, expr)
+#define LOG_WARN(expr) LOG_AT(LogLevel::Warn, expr)
+#define LOG_INFO(expr) LOG_AT(LogLevel::Info, expr)
+
+// Debug and trace sites are compiled out of release builds unless
+// LOG_KEEP_DEBUG is defined
+#if !defined(NDEBUG) || defined(LOG_KEEP_DEBUG)
+#define LOG_DEBUG(expr) LOG_AT(LogLevel::Debug, expr)
+#define LOG_TRACE(expr) LOG_AT(LogLevel::Trace, expr)
+#else
+#define LOG_DEBUG(expr) do { } while (0)
+#define LOG_TRACE(expr) do { } while (0)
+#endif
+
+#endif // LOGGER_HPP
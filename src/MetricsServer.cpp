@@ -0,0 +1,227 @@
+#include "MetricsServer.hpp"
+#include "StageProfiler.hpp"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+MetricsServer::MetricsServer()
+    : running(false)
+    , listenFd(-1)
+    , framesCaptured(0)
+    , framesProcessed(0)
+    , captureDrops(0)
+    , outputDrops(0)
+    , outputLate(0)
+    , outputRepeated(0)
+    , outputPassthrough(0)
+    , detectionRuns(0)
+    , modelSwaps(0)
+    , fallbackSwaps(0)
+    , faceCount(0)
+    , qualityLevel(0)
+    , currentFps(0.0)
+{
+}
+
+MetricsServer::~MetricsServer() {
+    stop();
+}
+
+bool MetricsServer::start(int port) {
+    if (running) {
+        return true;
+    }
+
+    listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        std::cerr << "Error: Could not create metrics socket: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    int reuse = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(static_cast<uint16_t>(port));
+
+    if (bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+        listen(listenFd, 4) < 0) {
+        std::cerr << "Error: Could not listen on 127.0.0.1:" << port << ": " << std::strerror(errno) << std::endl;
+        close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+
+    StageProfiler::instance().setEnabled(true);
+    running = true;
+    listener = std::thread(&MetricsServer::listenLoop, this);
+    return true;
+}
+
+void MetricsServer::stop() {
+    if (!running) {
+        return;
+    }
+    running = false;
+    if (listener.joinable()) {
+        listener.join();
+    }
+    close(listenFd);
+    listenFd = -1;
+}
+
+void MetricsServer::recordFrame(const FrameTimings& timings, int faces) {
+    framesProcessed.fetch_add(1, std::memory_order_relaxed);
+    if (timings.detectionRan) {
+        detectionRuns.fetch_add(1, std::memory_order_relaxed);
+    }
+    modelSwaps.fetch_add(timings.modelSwaps, std::memory_order_relaxed);
+    fallbackSwaps.fetch_add(timings.fallbackSwaps, std::memory_order_relaxed);
+    faceCount.store(faces, std::memory_order_relaxed);
+}
+
+void MetricsServer::listenLoop() {
+    while (running) {
+        // Wake up regularly so stop() does not wait on a quiet socket
+        pollfd pfd;
+        pfd.fd = listenFd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, 200) <= 0) {
+            continue;
+        }
+
+        int clientFd = accept(listenFd, nullptr, nullptr);
+        if (clientFd < 0) {
+            continue;
+        }
+        handleClient(clientFd);
+        close(clientFd);
+    }
+}
+
+void MetricsServer::handleClient(int clientFd) {
+    timeval timeout;
+    timeout.tv_sec = 1;
+    timeout.tv_usec = 0;
+    setsockopt(clientFd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(clientFd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    // Only the request line matters
+    char buffer[1024];
+    ssize_t received = recv(clientFd, buffer, sizeof(buffer) - 1, 0);
+    if (received <= 0) {
+        return;
+    }
+    buffer[received] = '\0';
+    std::string request(buffer);
+
+    std::string status = "200 OK";
+    std::string body;
+    if (request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 13, "GET /metrics?") == 0) {
+        body = renderMetrics();
+    } else if (request.compare(0, 6, "GET / ") == 0) {
+        body = "LiveFaceSwapper metrics at /metrics\n";
+    } else {
+        status = "404 Not Found";
+        body = "not found\n";
+    }
+
+    std::ostringstream response;
+    response << "HTTP/1.1 " << status << "\r\n"
+             << "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+             << "Content-Length: " << body.size() << "\r\n"
+             << "Connection: close\r\n\r\n"
+             << body;
+    std::string data = response.str();
+
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(clientFd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            break;
+        }
+        sent += static_cast<size_t>(n);
+    }
+}
+
+std::string MetricsServer::renderMetrics() {
+    std::ostringstream out;
+    out << std::setprecision(12);
+
+    auto counter = [&out](const char* name, const char* help, uint64_t value) {
+        out << "# HELP " << name << " " << help << "\n"
+            << "# TYPE " << name << " counter\n"
+            << name << " " << value << "\n";
+    };
+    auto gauge = [&out](const char* name, const char* help, double value) {
+        out << "# HELP " << name << " " << help << "\n"
+            << "# TYPE " << name << " gauge\n"
+            << name << " " << value << "\n";
+    };
+
+    gauge("faceswap_fps", "Frames per second delivered over the last second", currentFps.load());
+    gauge("faceswap_faces", "Faces in the most recent processed frame", faceCount.load());
+    gauge("faceswap_quality_level", "Current quality governor level (0 = full quality)", qualityLevel.load());
+    counter("faceswap_frames_captured_total", "Frames read from the camera", framesCaptured.load());
+    counter("faceswap_frames_processed_total", "Frames run through the swap pipeline", framesProcessed.load());
+    counter("faceswap_detection_runs_total", "Frames on which the face detector ran", detectionRuns.load());
+    counter("faceswap_capture_dropped_total", "Captured frames dropped because the pipeline was busy", captureDrops.load());
+    counter("faceswap_output_dropped_total", "Frames that could not be written to the virtual camera", outputDrops.load());
+    counter("faceswap_output_late_total", "Paced frames written more than the output deadline after capture",
+            outputLate.load());
+    counter("faceswap_output_repeated_total", "Paced output ticks that repeated the last frame", outputRepeated.load());
+    counter("faceswap_output_passthrough_total", "Paced output ticks that showed the unprocessed capture",
+            outputPassthrough.load());
+    counter("faceswap_model_swaps_total", "Faces swapped with the INSwapper model", modelSwaps.load());
+    counter("faceswap_fallback_swaps_total", "Faces swapped with the geometric fallback", fallbackSwaps.load());
+    gauge("process_resident_memory_bytes", "Resident set size", static_cast<double>(readResidentBytes()));
+
+    // Whole-run stage latencies as a Prometheus summary (seconds)
+    StageProfiler& profiler = StageProfiler::instance();
+    out << "# HELP faceswap_stage_latency_seconds Per-stage latency since start\n"
+        << "# TYPE faceswap_stage_latency_seconds summary\n";
+    for (int i = 0; i < static_cast<int>(ProfileStage::Count); i++) {
+        ProfileStage stage = static_cast<ProfileStage>(i);
+        LatencyHistogram::Summary s = profiler.getRunSummary(stage);
+        if (s.count == 0) continue;
+
+        const char* name = StageProfiler::stageName(stage);
+        const std::pair<const char*, double> quantiles[] = {
+            {"0.5", s.p50Ms}, {"0.95", s.p95Ms}, {"0.99", s.p99Ms}, {"1", s.maxMs}
+        };
+        for (const auto& q : quantiles) {
+            out << "faceswap_stage_latency_seconds{stage=\"" << name << "\",quantile=\"" << q.first << "\"} "
+                << q.second / 1000.0 << "\n";
+        }
+        out << "faceswap_stage_latency_seconds_sum{stage=\"" << name << "\"} " << s.meanMs * s.count / 1000.0 << "\n"
+            << "faceswap_stage_latency_seconds_count{stage=\"" << name << "\"} " << s.count << "\n";
+    }
+
+    return out.str();
+}
+
+uint64_t MetricsServer::readResidentBytes() {
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (!statm) {
+        return 0;
+    }
+    unsigned long pages = 0;
+    unsigned long resident = 0;
+    int fields = fscanf(statm, "%lu %lu", &pages, &resident);
+    fclose(statm);
+    if (fields != 2) {
+        return 0;
+    }
+    return static_cast<uint64_t>(resident) * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+}
@@ -0,0 +1,65 @@
+#ifndef METRICS_SERVER_HPP
+#define METRICS_SERVER_HPP
+
+#include "AdvancedFaceSwapper.hpp"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+// Minimal HTTP listener on 127.0.0.1 serving Prometheus text metrics at
+// /metrics.
+//
+// The frame loop only bumps relaxed atomics through the record*() calls;
+// the text is built on the listener thread when a scrape arrives. Stage
+// latency summaries come from the StageProfiler, which start() enables.
+class MetricsServer {
+public:
+    MetricsServer();
+    ~MetricsServer();
+
+    // Bind 127.0.0.1:port and start serving. Returns false if the port is taken.
+    bool start(int port);
+    void stop();
+    bool isRunning() const { return running; }
+
+    // Frame loop hooks
+    void recordCapture() { framesCaptured.fetch_add(1, std::memory_order_relaxed); }
+    void recordCaptureDrop() { captureDrops.fetch_add(1, std::memory_order_relaxed); }
+    void recordOutputDrop() { outputDrops.fetch_add(1, std::memory_order_relaxed); }
+    // Output pacer hooks (FramePacer thread)
+    void recordOutputLate() { outputLate.fetch_add(1, std::memory_order_relaxed); }
+    void recordOutputRepeat() { outputRepeated.fetch_add(1, std::memory_order_relaxed); }
+    void recordOutputPassthrough() { outputPassthrough.fetch_add(1, std::memory_order_relaxed); }
+    void recordFrame(const FrameTimings& timings, int faceCount);
+    void setFps(double fps) { currentFps.store(fps, std::memory_order_relaxed); }
+    void setQualityLevel(int level) { qualityLevel.store(level, std::memory_order_relaxed); }
+
+    // Current metrics in the Prometheus text format (any thread)
+    std::string renderMetrics();
+
+private:
+    std::atomic<bool> running;
+    int listenFd;
+    std::thread listener;
+
+    std::atomic<uint64_t> framesCaptured;
+    std::atomic<uint64_t> framesProcessed;
+    std::atomic<uint64_t> captureDrops;
+    std::atomic<uint64_t> outputDrops;
+    std::atomic<uint64_t> outputLate;
+    std::atomic<uint64_t> outputRepeated;
+    std::atomic<uint64_t> outputPassthrough;
+    std::atomic<uint64_t> detectionRuns;
+    std::atomic<uint64_t> modelSwaps;
+    std::atomic<uint64_t> fallbackSwaps;
+    std::atomic<int> faceCount;
+    std::atomic<int> qualityLevel;
+    std::atomic<double> currentFps;
+
+    void listenLoop();
+    void handleClient(int clientFd);
+    static uint64_t readResidentBytes();
+};
+
+#endif // METRICS_SERVER_HPP
@@ -1,21 +1,31 @@
 #include "ModernGUI.hpp"
+#include "StageProfiler.hpp"
 #include <opencv2/imgproc.hpp>
 #include <opencv2/highgui.hpp>
 #include <iostream>
 #include <iomanip>
 #include <sstream>
 #include <chrono>
+#include <cmath>
+#include <algorithm>
 
 ModernGUI::ModernGUI() 
-    : blendStrength(0.95f)
+    : running(false)
+    , windowCreated(false)
+    , displayIntervalMs(16)
+    , blendStrength(0.95f)
     , faceCount(0)
     , virtualCameraEnabled(false)
     , currentFPS(0.0f)
     , exitRequested(false)
     , sourceFaceLoaded(false)
+    , dialogOpen(false)
+    , pendingSourceStep(0)
+    , pendingModeStep(0)
     , windowWidth(1280)
     , windowHeight(720)
     , initialized(false)
+    , layersValid(false)
     , sliderX(0)
     , sliderY(0)
     , sliderWidth(0)
@@ -24,6 +34,10 @@ ModernGUI::ModernGUI()
     , uploadButtonY(0)
     , uploadButtonWidth(0)
     , uploadButtonHeight(0)
+    , blendValueY(0)
+    , faceCountY(0)
+    , fpsY(0)
+    , virtualCameraY(0)
     , previewWidth(0)
     , draggingSlider(false)
 {
@@ -31,290 +45,521 @@ ModernGUI::ModernGUI()
 }
 
 ModernGUI::~ModernGUI() {
-    if (initialized) {
-        cv::destroyAllWindows();
-    }
+    shutdown();
 }
 
-bool ModernGUI::initialize(int width, int height) {
+bool ModernGUI::initialize(int width, int height, double displayFps) {
+    if (initialized) {
+        return true;
+    }
     windowWidth = width;
     windowHeight = height;
-    
-    cv::namedWindow(windowName, cv::WINDOW_NORMAL);
-    cv::resizeWindow(windowName, windowWidth, windowHeight);
-    cv::setWindowProperty(windowName, cv::WND_PROP_TOPMOST, 0);
+    displayIntervalMs = std::max(1, static_cast<int>(1000.0 / std::max(1.0, displayFps)));
+    
+    // Layout is needed for mouse hit-testing before the first frame
+    computeLayout();
+    layersValid = false;
+    
+    // highgui windows belong to the thread that pumps their events, so the
+    // display thread creates the window; wait until it has
+    running = true;
+    displayThread = std::thread(&ModernGUI::displayLoop, this);
+    {
+        std::unique_lock<std::mutex> lock(windowMutex);
+        windowReady.wait(lock, [this] { return windowCreated || !running; });
+    }
+    if (!windowCreated) {
+        shutdown();
+        return false;
+    }
     
     initialized = true;
     return true;
 }
 
+void ModernGUI::shutdown() {
+    running = false;
+    if (displayThread.joinable()) {
+        displayThread.join();
+    }
+    if (dialogThread.joinable()) {
+        if (dialogOpen) {
+            std::cout << "Waiting for the file dialog to close..." << std::endl;
+        }
+        dialogThread.join();
+    }
+    initialized = false;
+}
+
 bool ModernGUI::processFrame(const cv::Mat& frame) {
-    if (!initialized || frame.empty()) {
+    if (!initialized) {
         return false;
     }
     
-    renderGUI(frame);
-    
-    // Check for keys - use longer wait time to ensure key press is captured
-    int key = cv::waitKey(30) & 0xFF;
-    
-    if (key != 255 && key != -1) { // Valid key pressed
-        if (key == 27 || key == 'q' || key == 'Q') { // ESC or 'q'
-            exitRequested = true;
-            return false;
-        } else if (key == 'u' || key == 'U') { // 'u' for upload
-            std::cout << "\n=== Opening file dialog ===" << std::endl;
-            std::cout << "Please check for a file dialog window (it may appear behind this window)." << std::endl;
-            
-            // Temporarily lower window priority so dialog can appear on top
-            cv::setWindowProperty(windowName, cv::WND_PROP_TOPMOST, 0);
-            
-            std::string filePath = openFileDialog();
-            
-            if (!filePath.empty()) {
-                std::cout << "Selected file: " << filePath << std::endl;
-                if (imageUploadCallback) {
-                    imageUploadCallback(filePath);
-                } else {
-                    std::cerr << "Warning: Image upload callback not set!" << std::endl;
-                }
-            } else {
-                std::cout << "No file selected or file dialog failed." << std::endl;
-                std::cout << "Tip: You can also use --face /path/to/image.jpg on the command line." << std::endl;
-            }
-        }
+    if (!frame.empty()) {
+        // Copy into the hand-over slot; the caller reuses its frame
+        frame.copyTo(frames.writeBuffer());
+        frames.publish();
     }
     
-    return true;
+    return pollEvents();
 }
 
-void ModernGUI::renderGUI(const cv::Mat& frame) {
-    cv::Mat displayFrame = frame.clone();
-    
-    // Create a larger canvas for the GUI
-    int canvasWidth = windowWidth;
-    int canvasHeight = windowHeight;
-    
-    // Resize frame to fit in the left portion (70% width)
-    previewWidth = static_cast<int>(canvasWidth * 0.7);
-    int previewHeight = canvasHeight;
-    
-    cv::Mat resizedFrame;
-    cv::resize(displayFrame, resizedFrame, cv::Size(previewWidth, previewHeight));
-    
-    // Create control panel area (30% width on the right)
-    int panelWidth = canvasWidth - previewWidth;
-    cv::Mat controlPanel = cv::Mat::zeros(canvasHeight, panelWidth, CV_8UC3);
-    controlPanel.setTo(cv::Scalar(45, 45, 48)); // Dark gray background
-    
-    // Render control panel
-    renderControlPanel(controlPanel);
+bool ModernGUI::pollEvents() {
+    dispatchEvents();
+    return !exitRequested;
+}
+
+void ModernGUI::dispatchEvents() {
+    bool notifyBlend = blendInput.update();
+    float strength = blendInput.read();
+    std::string uploadPath;
+    int sourceStep;
+    int modeStep;
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        uploadPath.swap(pendingUpload);
+        sourceStep = pendingSourceStep;
+        modeStep = pendingModeStep;
+        pendingSourceStep = 0;
+        pendingModeStep = 0;
+    }
     
-    // Combine preview and control panel
-    cv::Mat combinedCanvas = cv::Mat::zeros(canvasHeight, canvasWidth, CV_8UC3);
+    if (notifyBlend && blendStrengthCallback) {
+        blendStrengthCallback(strength);
+    }
+    if (!uploadPath.empty()) {
+        if (imageUploadCallback) {
+            imageUploadCallback(uploadPath);
+        } else {
+            std::cerr << "Warning: Image upload callback not set!" << std::endl;
+        }
+    }
+    if (sourceStep != 0 && sourceCycleCallback) {
+        sourceCycleCallback(sourceStep);
+    }
+    if (modeStep != 0 && modeCycleCallback) {
+        modeCycleCallback(modeStep);
+    }
+}
+
+void ModernGUI::displayLoop() {
+    TraceRecorder::setThreadName("gui");
+    try {
+        cv::namedWindow(windowName, cv::WINDOW_NORMAL);
+        cv::resizeWindow(windowName, windowWidth, windowHeight);
+        cv::setWindowProperty(windowName, cv::WND_PROP_TOPMOST, 0);
+        cv::setMouseCallback(windowName, onMouse, this);
+    } catch (const cv::Exception& e) {
+        std::cerr << "Error: Could not create preview window: " << e.what() << std::endl;
+        std::lock_guard<std::mutex> lock(windowMutex);
+        running = false;
+        windowReady.notify_all();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(windowMutex);
+        windowCreated = true;
+    }
+    windowReady.notify_all();
     
-    // Place preview on the left
-    resizedFrame.copyTo(combinedCanvas(cv::Rect(0, 0, previewWidth, previewHeight)));
+    while (running) {
+        auto nextRefresh = std::chrono::steady_clock::now() + std::chrono::milliseconds(displayIntervalMs);
+        
+        // Take the newest frame, if any; older ones were never shown
+        bool newFrame = frames.update();
+        const cv::Mat& displayFrame = frames.read();
+        
+        // Redraw for a new frame, or for a widget change (e.g. slider drag)
+        if (!displayFrame.empty() && (newFrame || !layersValid || !(currentState() == drawnState))) {
+            renderGUI(displayFrame);
+        }
+        
+        // Pump window events until the next refresh
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            nextRefresh - std::chrono::steady_clock::now()).count();
+        int key = cv::waitKey(static_cast<int>(std::max<int64_t>(1, remaining))) & 0xFF;
+        if (key != 255) {
+            handleKey(key);
+        }
+    }
     
-    // Place control panel on the right
-    controlPanel.copyTo(combinedCanvas(cv::Rect(previewWidth, 0, panelWidth, canvasHeight)));
+    cv::destroyWindow(windowName);
+    cv::waitKey(1);
+}
+
+void ModernGUI::handleKey(int key) {
+    if (key == 27 || key == 'q' || key == 'Q') { // ESC or 'q'
+        exitRequested = true;
+    } else if (key == 'u' || key == 'U') { // 'u' for upload
+        openFileDialogAsync();
+    } else if (key == 'n' || key == 'N' || key == 'p' || key == 'P') { // next/previous source
+        std::lock_guard<std::mutex> lock(stateMutex);
+        pendingSourceStep += (key == 'n' || key == 'N') ? 1 : -1;
+    } else if (key == 'm' || key == 'M') { // next processing mode
+        std::lock_guard<std::mutex> lock(stateMutex);
+        pendingModeStep++;
+    }
+}
+
+void ModernGUI::openFileDialogAsync() {
+    if (dialogOpen) {
+        std::cout << "A file dialog is already open." << std::endl;
+        return;
+    }
+    if (dialogThread.joinable()) {
+        dialogThread.join();
+    }
     
-    // Add separator line
-    cv::line(combinedCanvas, cv::Point(previewWidth, 0), cv::Point(previewWidth, canvasHeight),
-             cv::Scalar(60, 60, 63), 2);
+    std::cout << "\n=== Opening file dialog ===" << std::endl;
+    std::cout << "Please check for a file dialog window (it may appear behind this window)." << std::endl;
     
-    // Add overlay info on preview
-    renderStatsPanel(combinedCanvas, previewWidth);
+    // Temporarily lower window priority so dialog can appear on top
+    cv::setWindowProperty(windowName, cv::WND_PROP_TOPMOST, 0);
     
-    cv::imshow(windowName, combinedCanvas);
+    // The dialog blocks its own thread only; preview and processing continue
+    dialogOpen = true;
+    dialogThread = std::thread([this] {
+        std::string filePath = openFileDialog();
+        
+        if (!filePath.empty()) {
+            std::cout << "Selected file: " << filePath << std::endl;
+            std::lock_guard<std::mutex> lock(stateMutex);
+            pendingUpload = filePath;
+        } else {
+            std::cout << "No file selected or file dialog failed." << std::endl;
+            std::cout << "Tip: You can also use --face /path/to/image.jpg on the command line." << std::endl;
+        }
+        dialogOpen = false;
+    });
+}
+
+void ModernGUI::onMouse(int event, int x, int y, int flags, void* userdata) {
+    static_cast<ModernGUI*>(userdata)->handleMouse(event, x, y, flags);
+}
+
+float ModernGUI::getBlendStrength() const {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    return blendStrength;
+}
+
+bool ModernGUI::isVirtualCameraEnabled() const {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    return virtualCameraEnabled;
+}
+
+bool ModernGUI::isSourceFaceLoaded() const {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    return sourceFaceLoaded;
+}
+
+void ModernGUI::setBlendStrength(float strength, bool notify) {
+    strength = std::max(0.0f, std::min(1.0f, strength));
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        blendStrength = strength;
+    }
+    if (notify && blendStrengthCallback) {
+        blendStrengthCallback(strength);
+    }
+}
+
+void ModernGUI::setFaceCount(int count) {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    faceCount = count;
+}
+
+void ModernGUI::setVirtualCameraStatus(bool enabled, const std::string& device) {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    virtualCameraEnabled = enabled;
+    virtualCameraDevice = device;
+}
+
+void ModernGUI::setFPS(float fps) {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    currentFPS = fps;
+}
+
+void ModernGUI::setSourceFaceLoaded(bool loaded) {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    sourceFaceLoaded = loaded;
+}
+
+void ModernGUI::setQualityStatus(const std::string& status) {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    qualityStatus = status;
+}
+
+void ModernGUI::setSourceName(const std::string& name) {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    sourceName = name;
+}
+
+void ModernGUI::setModeName(const std::string& name) {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    modeName = name;
+}
+
+bool ModernGUI::DisplayState::operator==(const DisplayState& other) const {
+    return blendPercent == other.blendPercent
+        && faceCount == other.faceCount
+        && fpsTenths == other.fpsTenths
+        && virtualCameraEnabled == other.virtualCameraEnabled
+        && virtualCameraDevice == other.virtualCameraDevice
+        && sourceFaceLoaded == other.sourceFaceLoaded
+        && qualityStatus == other.qualityStatus
+        && sourceName == other.sourceName
+        && modeName == other.modeName;
 }
 
-void ModernGUI::renderControlPanel(cv::Mat& panel) {
+ModernGUI::DisplayState ModernGUI::currentState() const {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    DisplayState state;
+    state.blendPercent = static_cast<int>(std::lround(blendStrength * 100));
+    state.faceCount = faceCount;
+    state.fpsTenths = static_cast<int>(std::lround(currentFPS * 10));
+    state.virtualCameraEnabled = virtualCameraEnabled;
+    state.virtualCameraDevice = virtualCameraDevice;
+    state.sourceFaceLoaded = sourceFaceLoaded;
+    state.qualityStatus = qualityStatus;
+    state.sourceName = sourceName;
+    state.modeName = modeName;
+    return state;
+}
+
+void ModernGUI::computeLayout() {
+    // Preview on the left 70%, control panel on the right
+    previewWidth = static_cast<int>(windowWidth * 0.7);
+    int panelWidth = windowWidth - previewWidth;
+    
     int x = 20;
     int y = 30;
     int lineHeight = 35;
     int sectionSpacing = 50;
     
-    // Title
-    cv::putText(panel, "FACE SWAPPER", cv::Point(x, y),
-                cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(100, 200, 255), 2);
+    y += lineHeight + 10;               // title
+    y += sectionSpacing;                // separator
+    y += lineHeight;                    // "Source Face"
+    uploadButtonX = x;
+    uploadButtonY = y;
+    uploadButtonWidth = panelWidth - 2 * x;
+    uploadButtonHeight = 40;
+    y += uploadButtonHeight + sectionSpacing;
+    y += lineHeight;                    // "Blend Strength"
+    blendValueY = y;
     y += lineHeight + 10;
-    
-    // Separator
-    cv::line(panel, cv::Point(x, y), cv::Point(panel.cols - x, y), cv::Scalar(80, 80, 85), 1);
+    sliderX = x;
+    sliderY = y;
+    sliderWidth = panelWidth - 2 * x;
+    sliderHeight = 30;
+    y += sliderHeight + sectionSpacing;
+    y += lineHeight;                    // "Statistics"
+    faceCountY = y;
+    y += lineHeight;
+    fpsY = y;
     y += sectionSpacing;
+    y += lineHeight;                    // "Virtual Camera"
+    virtualCameraY = y;
+}
+
+void ModernGUI::renderStaticLayer() {
+    int panelWidth = windowWidth - previewWidth;
+    int x = 20;
+    int lineHeight = 35;
+    int sectionSpacing = 50;
+    cv::Scalar headingColor(255, 255, 255);
+    cv::Scalar hintColor(180, 180, 180);
     
-    // Source Face Upload Section
-    cv::putText(panel, "Source Face", cv::Point(x, y),
-                cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(255, 255, 255), 2);
+    panelBase.create(windowHeight, panelWidth, CV_8UC3);
+    panelBase.setTo(cv::Scalar(45, 45, 48)); // Dark gray background
+    
+    // Separator against the preview, inset so its full 2 px width is visible
+    cv::line(panelBase, cv::Point(1, 0), cv::Point(1, windowHeight), cv::Scalar(60, 60, 63), 2);
+    
+    // Title
+    cv::putText(panelBase, "FACE SWAPPER", cv::Point(x, 30),
+                cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(100, 200, 255), 2);
+    int separatorY = 30 + lineHeight + 10;
+    cv::line(panelBase, cv::Point(x, separatorY), cv::Point(panelWidth - x, separatorY), cv::Scalar(80, 80, 85), 1);
+    
+    // Section headings sit one line above their first widget
+    cv::putText(panelBase, "Source Face", cv::Point(x, uploadButtonY - lineHeight),
+                cv::FONT_HERSHEY_SIMPLEX, 0.7, headingColor, 2);
+    cv::putText(panelBase, "Blend Strength", cv::Point(x, blendValueY - lineHeight),
+                cv::FONT_HERSHEY_SIMPLEX, 0.7, headingColor, 2);
+    cv::putText(panelBase, "Statistics", cv::Point(x, faceCountY - lineHeight),
+                cv::FONT_HERSHEY_SIMPLEX, 0.7, headingColor, 2);
+    cv::putText(panelBase, "Virtual Camera", cv::Point(x, virtualCameraY - lineHeight),
+                cv::FONT_HERSHEY_SIMPLEX, 0.7, headingColor, 2);
+    
+    // Instructions, below the status and device lines
+    int y = virtualCameraY + lineHeight + sectionSpacing;
+    cv::putText(panelBase, "Controls", cv::Point(x, y),
+                cv::FONT_HERSHEY_SIMPLEX, 0.7, headingColor, 2);
     y += lineHeight;
+    const char* hints[] = {"Press 'U' to upload", "face image", "Mouse: Click slider",
+                           "to adjust blend", "Press 'Q' or ESC", "to exit"};
+    for (int i = 0; i < 6; i++) {
+        cv::putText(panelBase, hints[i], cv::Point(x, y),
+                    cv::FONT_HERSHEY_SIMPLEX, 0.5, hintColor, 1);
+        y += (i % 2 == 0) ? lineHeight - 5 : lineHeight;
+    }
+}
+
+void ModernGUI::renderGUI(const cv::Mat& frame) {
+    ScopedProfile profile(ProfileStage::GuiRender);
+    
+    if (!layersValid) {
+        computeLayout();
+        renderStaticLayer();
+        canvas = cv::Mat::zeros(windowHeight, windowWidth, CV_8UC3);
+        layersValid = true;
+        drawnState = DisplayState();
+    }
     
-    // Upload button
-    uploadButtonX = x;
-    uploadButtonY = y;
-    uploadButtonWidth = panel.cols - 2 * x;
-    uploadButtonHeight = 40;
+    // Resize straight into the preview area of the canvas
+    cv::Mat previewArea = canvas(cv::Rect(0, 0, previewWidth, windowHeight));
+    cv::resize(frame, previewArea, previewArea.size());
+    
+    // The panel half of the canvas keeps its pixels between frames; redraw
+    // it and the overlay text only when something they show has changed
+    DisplayState state = currentState();
+    if (!(state == drawnState)) {
+        renderControlPanel(state);
+        renderStatsLayer(state);
+        drawnState = state;
+    }
+    
+    // Overlay: darken the preview behind the stats, then stamp the cached text
+    cv::Mat overlayArea = canvas(statsRect);
+    overlayArea.convertTo(overlayArea, -1, 0.3);
+    statsText.copyTo(overlayArea, statsMask);
     
-    cv::Scalar buttonColor = sourceFaceLoaded ? cv::Scalar(60, 200, 100) : cv::Scalar(60, 120, 200);
-    cv::rectangle(panel, cv::Rect(uploadButtonX, uploadButtonY, uploadButtonWidth, uploadButtonHeight),
-                  buttonColor, -1);
-    cv::rectangle(panel, cv::Rect(uploadButtonX, uploadButtonY, uploadButtonWidth, uploadButtonHeight),
-                  cv::Scalar(100, 100, 105), 2);
+    cv::imshow(windowName, canvas);
+}
+
+void ModernGUI::renderControlPanel(const DisplayState& state) {
+    int x = 20;
+    int lineHeight = 35;
+    cv::Mat panel = canvas(cv::Rect(previewWidth, 0, windowWidth - previewWidth, windowHeight));
+    panelBase.copyTo(panel);
     
-    std::string buttonText = sourceFaceLoaded ? "Source Face Loaded" : "Upload Face Image (U)";
+    // Upload button
+    cv::Rect buttonRect(uploadButtonX, uploadButtonY, uploadButtonWidth, uploadButtonHeight);
+    cv::Scalar buttonColor = state.sourceFaceLoaded ? cv::Scalar(60, 200, 100) : cv::Scalar(60, 120, 200);
+    cv::rectangle(panel, buttonRect, buttonColor, -1);
+    cv::rectangle(panel, buttonRect, cv::Scalar(100, 100, 105), 2);
+    
+    std::string buttonText = state.sourceFaceLoaded ? "Source Face Loaded" : "Upload Face Image (U)";
+    if (state.sourceFaceLoaded && !state.sourceName.empty()) {
+        buttonText = "Source: " + state.sourceName;
+    }
     cv::Size textSize = cv::getTextSize(buttonText, cv::FONT_HERSHEY_SIMPLEX, 0.6, 2, nullptr);
     cv::putText(panel, buttonText, 
                 cv::Point(uploadButtonX + (uploadButtonWidth - textSize.width) / 2,
                          uploadButtonY + (uploadButtonHeight + textSize.height) / 2),
                 cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(255, 255, 255), 2);
     
-    y += uploadButtonHeight + sectionSpacing;
-    
-    // Blend Strength Section
-    cv::putText(panel, "Blend Strength", cv::Point(x, y),
-                cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(255, 255, 255), 2);
-    y += lineHeight;
-    
     // Blend strength value with colored background
-    std::ostringstream blendOss;
-    blendOss << std::fixed << std::setprecision(0) << (blendStrength * 100) << "%";
-    
-    // Draw value box
-    textSize = cv::getTextSize(blendOss.str(), cv::FONT_HERSHEY_SIMPLEX, 0.9, 2, nullptr);
-    cv::Rect valueRect(x, y - textSize.height - 5, textSize.width + 20, textSize.height + 10);
+    std::string blendText = std::to_string(state.blendPercent) + "%";
+    textSize = cv::getTextSize(blendText, cv::FONT_HERSHEY_SIMPLEX, 0.9, 2, nullptr);
+    cv::Rect valueRect(x, blendValueY - textSize.height - 5, textSize.width + 20, textSize.height + 10);
     cv::rectangle(panel, valueRect, cv::Scalar(60, 120, 200), -1);
-    cv::putText(panel, blendOss.str(), cv::Point(x + 10, y),
+    cv::putText(panel, blendText, cv::Point(x + 10, blendValueY),
                 cv::FONT_HERSHEY_SIMPLEX, 0.9, cv::Scalar(255, 255, 255), 2);
-    y += lineHeight + 10;
-    
-    // Visual slider representation
-    sliderX = x;
-    sliderY = y;
-    sliderWidth = panel.cols - 2 * x;
-    sliderHeight = 30;
     
-    // Slider track
-    cv::rectangle(panel, cv::Rect(x, sliderY, sliderWidth, sliderHeight),
-                  cv::Scalar(60, 60, 65), -1);
-    cv::rectangle(panel, cv::Rect(x, sliderY, sliderWidth, sliderHeight),
-                  cv::Scalar(100, 100, 105), 1);
+    // Slider track, fill and handle
+    cv::Rect trackRect(sliderX, sliderY, sliderWidth, sliderHeight);
+    cv::rectangle(panel, trackRect, cv::Scalar(60, 60, 65), -1);
+    cv::rectangle(panel, trackRect, cv::Scalar(100, 100, 105), 1);
     
-    // Slider fill (showing current value)
-    int fillWidth = static_cast<int>(sliderWidth * blendStrength);
-    cv::rectangle(panel, cv::Rect(x, sliderY, fillWidth, sliderHeight),
+    int fillWidth = sliderWidth * state.blendPercent / 100;
+    cv::rectangle(panel, cv::Rect(sliderX, sliderY, fillWidth, sliderHeight),
                   cv::Scalar(60, 150, 255), -1);
     
-    // Slider handle
-    int handlePos = x + fillWidth - 8;
-    cv::circle(panel, cv::Point(handlePos, sliderY + sliderHeight / 2), 12,
-               cv::Scalar(255, 255, 255), -1);
-    cv::circle(panel, cv::Point(handlePos, sliderY + sliderHeight / 2), 12,
-               cv::Scalar(200, 200, 200), 2);
-    
-    y += sliderHeight + sectionSpacing;
-    
-    // Stats Section
-    cv::putText(panel, "Statistics", cv::Point(x, y),
-                cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(255, 255, 255), 2);
-    y += lineHeight;
+    cv::Point handle(sliderX + fillWidth - 8, sliderY + sliderHeight / 2);
+    cv::circle(panel, handle, 12, cv::Scalar(255, 255, 255), -1);
+    cv::circle(panel, handle, 12, cv::Scalar(200, 200, 200), 2);
     
-    // Face count
-    std::ostringstream faceOss;
-    faceOss << "Faces Detected: " << faceCount;
-    cv::Scalar faceColor = (faceCount > 0) ? cv::Scalar(100, 255, 150) : cv::Scalar(150, 150, 150);
-    cv::putText(panel, faceOss.str(), cv::Point(x, y),
+    // Statistics
+    cv::Scalar faceColor = (state.faceCount > 0) ? cv::Scalar(100, 255, 150) : cv::Scalar(150, 150, 150);
+    cv::putText(panel, "Faces Detected: " + std::to_string(state.faceCount), cv::Point(x, faceCountY),
                 cv::FONT_HERSHEY_SIMPLEX, 0.6, faceColor, 2);
-    y += lineHeight;
     
-    // FPS
     std::ostringstream fpsOss;
-    fpsOss << "FPS: " << std::fixed << std::setprecision(1) << currentFPS;
-    cv::putText(panel, fpsOss.str(), cv::Point(x, y),
+    fpsOss << "FPS: " << std::fixed << std::setprecision(1) << state.fpsTenths / 10.0;
+    cv::putText(panel, fpsOss.str(), cv::Point(x, fpsY),
                 cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(200, 200, 255), 2);
-    y += sectionSpacing;
     
     // Virtual Camera Status
-    cv::putText(panel, "Virtual Camera", cv::Point(x, y),
-                cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(255, 255, 255), 2);
-    y += lineHeight;
-    
-    if (virtualCameraEnabled) {
-        cv::putText(panel, "Status: Active", cv::Point(x, y),
+    if (state.virtualCameraEnabled) {
+        cv::putText(panel, "Status: Active", cv::Point(x, virtualCameraY),
                     cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(100, 255, 100), 2);
-        y += lineHeight;
-        if (!virtualCameraDevice.empty()) {
-            std::string deviceText = "Device: " + virtualCameraDevice;
-            cv::putText(panel, deviceText, cv::Point(x, y),
+        if (!state.virtualCameraDevice.empty()) {
+            cv::putText(panel, "Device: " + state.virtualCameraDevice, cv::Point(x, virtualCameraY + lineHeight),
                         cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(200, 200, 200), 1);
         }
     } else {
-        cv::putText(panel, "Status: Inactive", cv::Point(x, y),
+        cv::putText(panel, "Status: Inactive", cv::Point(x, virtualCameraY),
                     cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(100, 100, 255), 2);
     }
-    y += sectionSpacing;
-    
-    // Instructions
-    cv::putText(panel, "Controls", cv::Point(x, y),
-                cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(255, 255, 255), 2);
-    y += lineHeight;
-    
-    cv::putText(panel, "Press 'U' to upload", cv::Point(x, y),
-                cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(180, 180, 180), 1);
-    y += lineHeight - 5;
-    cv::putText(panel, "face image", cv::Point(x, y),
-                cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(180, 180, 180), 1);
-    y += lineHeight;
-    cv::putText(panel, "Mouse: Click slider", cv::Point(x, y),
-                cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(180, 180, 180), 1);
-    y += lineHeight - 5;
-    cv::putText(panel, "to adjust blend", cv::Point(x, y),
-                cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(180, 180, 180), 1);
-    y += lineHeight;
-    cv::putText(panel, "Press 'Q' or ESC", cv::Point(x, y),
-                cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(180, 180, 180), 1);
-    y += lineHeight - 5;
-    cv::putText(panel, "to exit", cv::Point(x, y),
-                cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(180, 180, 180), 1);
 }
 
-void ModernGUI::renderStatsPanel(cv::Mat& canvas, int previewWidth) {
-    // Add overlay stats in top-left corner of preview
-    int x = 20;
-    int y = 30;
-    
-    // Semi-transparent background
-    cv::Rect bgRect(x - 10, y - 25, 300, 100);
-    cv::Mat overlay = canvas(bgRect).clone();
-    cv::rectangle(canvas, bgRect, cv::Scalar(0, 0, 0), -1);
-    cv::addWeighted(canvas(bgRect), 0.7, overlay, 0.3, 0, canvas(bgRect));
+void ModernGUI::renderStatsLayer(const DisplayState& state) {
+    // Overlay in the top-left corner of the preview (taller when the quality
+    // governor is active). Text is drawn once into its own layer; the mask
+    // marks its pixels so they can be stamped onto every frame.
+    int x = 10;
+    int y = 25;
+    int bgHeight = state.qualityStatus.empty() ? 100 : 130;
+    if (!state.modeName.empty()) {
+        bgHeight += 30;
+    }
+    int bgWidth = state.qualityStatus.empty() ? 300 : 420;
+    statsRect = cv::Rect(10, 5, bgWidth, bgHeight) & cv::Rect(0, 0, previewWidth, windowHeight);
+    statsText = cv::Mat::zeros(statsRect.size(), CV_8UC3);
     
     // Source face status
-    std::string statusText = sourceFaceLoaded ? "Face Loaded" : "No Face";
-    cv::Scalar statusColor = sourceFaceLoaded ? cv::Scalar(100, 255, 100) : cv::Scalar(100, 100, 255);
-    cv::putText(canvas, statusText, cv::Point(x, y),
+    std::string statusText = state.sourceFaceLoaded ? "Face Loaded" : "No Face";
+    cv::Scalar statusColor = state.sourceFaceLoaded ? cv::Scalar(100, 255, 100) : cv::Scalar(100, 100, 255);
+    cv::putText(statsText, statusText, cv::Point(x, y),
                 cv::FONT_HERSHEY_SIMPLEX, 0.8, statusColor, 2);
     y += 30;
     
     // Blend strength
-    std::ostringstream blendOss;
-    blendOss << "Blend: " << std::fixed << std::setprecision(0) << (blendStrength * 100) << "%";
-    cv::putText(canvas, blendOss.str(), cv::Point(x, y),
+    cv::putText(statsText, "Blend: " + std::to_string(state.blendPercent) + "%", cv::Point(x, y),
                 cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(100, 255, 100), 2);
     y += 30;
     
     // Face count
-    std::ostringstream faceOss;
-    faceOss << "Faces: " << faceCount;
-    cv::Scalar faceColor = (faceCount > 0) ? cv::Scalar(100, 200, 255) : cv::Scalar(150, 150, 150);
-    cv::putText(canvas, faceOss.str(), cv::Point(x, y),
+    cv::Scalar faceColor = (state.faceCount > 0) ? cv::Scalar(100, 200, 255) : cv::Scalar(150, 150, 150);
+    cv::putText(statsText, "Faces: " + std::to_string(state.faceCount), cv::Point(x, y),
                 cv::FONT_HERSHEY_SIMPLEX, 0.8, faceColor, 2);
     y += 30;
     
     // FPS
     std::ostringstream fpsOss;
-    fpsOss << "FPS: " << std::fixed << std::setprecision(1) << currentFPS;
-    cv::putText(canvas, fpsOss.str(), cv::Point(x, y),
+    fpsOss << "FPS: " << std::fixed << std::setprecision(1) << state.fpsTenths / 10.0;
+    cv::putText(statsText, fpsOss.str(), cv::Point(x, y),
                 cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(255, 200, 100), 2);
+    
+    // Processing mode
+    if (!state.modeName.empty()) {
+        y += 30;
+        cv::putText(statsText, "Mode: " + state.modeName, cv::Point(x, y),
+                    cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(200, 150, 255), 2);
+    }
+    
+    // Quality governor decision
+    if (!state.qualityStatus.empty()) {
+        y += 30;
+        cv::putText(statsText, "Quality: " + state.qualityStatus, cv::Point(x, y),
+                    cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(200, 200, 200), 1);
+    }
+    
+    cv::Mat gray;
+    cv::cvtColor(statsText, gray, cv::COLOR_BGR2GRAY);
+    statsMask = gray > 0;
 }
 
 void ModernGUI::handleMouse(int event, int x, int y, int flags) {
@@ -325,10 +570,7 @@ void ModernGUI::handleMouse(int event, int x, int y, int flags) {
     if (panelX >= uploadButtonX && panelX <= uploadButtonX + uploadButtonWidth &&
         y >= uploadButtonY && y <= uploadButtonY + uploadButtonHeight) {
         if (event == cv::EVENT_LBUTTONDOWN) {
-            std::string filePath = openFileDialog();
-            if (!filePath.empty() && imageUploadCallback) {
-                imageUploadCallback(filePath);
-            }
+            openFileDialogAsync();
         }
     }
     
@@ -341,7 +583,12 @@ void ModernGUI::handleMouse(int event, int x, int y, int flags) {
             // Calculate new blend strength based on mouse X position
             float relativePos = static_cast<float>(panelX - sliderX) / sliderWidth;
             relativePos = std::max(0.0f, std::min(1.0f, relativePos));
-            setBlendStrength(relativePos);
+            {
+                std::lock_guard<std::mutex> lock(stateMutex);
+                blendStrength = relativePos;
+            }
+            blendInput.writeBuffer() = relativePos;
+            blendInput.publish();
             draggingSlider = true;
         }
     }
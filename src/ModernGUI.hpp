@@ -1,84 +1,172 @@
 #ifndef MODERN_GUI_HPP
 #define MODERN_GUI_HPP
 
+#include "TripleBuffer.hpp"
 #include <opencv2/opencv.hpp>
 #include <string>
 #include <functional>
 #include <cstdio>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
+// Preview window with a control panel.
+//
+// Display and input run on their own thread at display rate: the processing
+// loop hands over its latest frame with processFrame() through a triple
+// buffer, so neither side waits for the other, and never blocks on
+// highgui. Mouse and key input is handled on the display thread and the file
+// dialog on a thread of its own; the blend and upload callbacks are queued
+// and run on the thread that calls processFrame()/pollEvents(), so they
+// never race the processing loop.
 class ModernGUI {
 public:
     ModernGUI();
     ~ModernGUI();
     
-    // Initialize GUI with window dimensions
-    bool initialize(int width = 1280, int height = 720);
+    // Create the window and start the display thread (refreshing at displayFps)
+    bool initialize(int width = 1280, int height = 720, double displayFps = 60.0);
     
-    // Process events and render GUI
+    // Close the window and stop the display thread
+    void shutdown();
+    
+    // Hand a frame to the display thread and run pending input callbacks.
+    // Returns false once exit was requested.
     bool processFrame(const cv::Mat& frame);
     
+    // Run pending input callbacks without a new frame
+    bool pollEvents();
+    
     // Getters for GUI state
-    float getBlendStrength() const { return blendStrength; }
+    float getBlendStrength() const;
     bool shouldExit() const { return exitRequested; }
-    bool isVirtualCameraEnabled() const { return virtualCameraEnabled; }
-    bool isSourceFaceLoaded() const { return sourceFaceLoaded; }
-    
-    // Setters
-    void setBlendStrength(float strength) { 
-        blendStrength = std::max(0.0f, std::min(1.0f, strength));
-        if (blendStrengthCallback) {
-            blendStrengthCallback(blendStrength);
-        }
-    }
-    void setFaceCount(int count) { faceCount = count; }
-    void setVirtualCameraStatus(bool enabled, const std::string& device = "") {
-        virtualCameraEnabled = enabled;
-        virtualCameraDevice = device;
-    }
-    void setFPS(float fps) { currentFPS = fps; }
-    void setSourceFaceLoaded(bool loaded) { sourceFaceLoaded = loaded; }
+    bool isVirtualCameraEnabled() const;
+    bool isSourceFaceLoaded() const;
     
-    // Callbacks
+    // Setters (any thread); setBlendStrength runs the callback on the caller
+    // unless `notify` is false (e.g. to show a change made elsewhere)
+    void setBlendStrength(float strength, bool notify = true);
+    void setFaceCount(int count);
+    void setVirtualCameraStatus(bool enabled, const std::string& device = "");
+    void setFPS(float fps);
+    void setSourceFaceLoaded(bool loaded);
+    void setQualityStatus(const std::string& status);
+    void setSourceName(const std::string& name);
+    void setModeName(const std::string& name);
+    
+    // Callbacks, run from processFrame()/pollEvents()
     void setBlendStrengthCallback(std::function<void(float)> callback) {
         blendStrengthCallback = callback;
     }
     void setImageUploadCallback(std::function<void(const std::string&)> callback) {
         imageUploadCallback = callback;
     }
+    // Next/previous source face (N/P keys); the argument is the net step
+    void setSourceCycleCallback(std::function<void(int)> callback) {
+        sourceCycleCallback = callback;
+    }
+    // Next processing mode (M key); the argument is the net step
+    void setModeCycleCallback(std::function<void(int)> callback) {
+        modeCycleCallback = callback;
+    }
     
-    // Mouse callback handler
+    // Mouse callback handler (display thread)
     void handleMouse(int event, int x, int y, int flags);
 
 private:
+    // Everything the dynamic widgets show; they are redrawn only when this changes
+    struct DisplayState {
+        int blendPercent = -1;
+        int faceCount = -1;
+        int fpsTenths = -1;
+        bool virtualCameraEnabled = false;
+        std::string virtualCameraDevice;
+        bool sourceFaceLoaded = false;
+        std::string qualityStatus;
+        std::string sourceName;
+        std::string modeName;
+        
+        bool operator==(const DisplayState& other) const;
+    };
+    
+    void displayLoop();
+    void handleKey(int key);
+    void openFileDialogAsync();
+    void dispatchEvents();
+    static void onMouse(int event, int x, int y, int flags, void* userdata);
+    
+    void computeLayout();
+    void renderStaticLayer();
     void renderGUI(const cv::Mat& frame);
-    void renderControlPanel(cv::Mat& panel);
-    void renderStatsPanel(cv::Mat& canvas, int previewWidth);
-    cv::Mat frameTexture;
+    void renderControlPanel(const DisplayState& state);
+    void renderStatsLayer(const DisplayState& state);
+    DisplayState currentState() const;
+    
+    // Cached layers: the full window, the panel chrome that never changes and
+    // the stats overlay text with its mask
+    cv::Mat canvas;
+    cv::Mat panelBase;
+    cv::Mat statsText;
+    cv::Mat statsMask;
+    cv::Rect statsRect;
+    DisplayState drawnState;
+    bool layersValid;
+    
+    // Display thread and the latest frame handed over by processFrame().
+    // The slots are reused, so steady-state hand-over does not allocate, and
+    // neither side waits for the other.
+    std::thread displayThread;
+    std::atomic<bool> running;
+    TripleBuffer<cv::Mat> frames;
+    std::mutex windowMutex;
+    std::condition_variable windowReady;
+    bool windowCreated;
+    int displayIntervalMs;
     
-    // GUI state
+    // GUI state, written by the processing loop and read by the display thread
+    mutable std::mutex stateMutex;
     float blendStrength;
     int faceCount;
     bool virtualCameraEnabled;
     std::string virtualCameraDevice;
     float currentFPS;
-    bool exitRequested;
+    std::atomic<bool> exitRequested;
     bool sourceFaceLoaded;
+    std::string qualityStatus;
+    std::string sourceName;
+    std::string modeName;
+    
+    // File dialog, run on its own thread so the preview keeps updating
+    std::thread dialogThread;
+    std::atomic<bool> dialogOpen;
+    
+    // Slider position from the display thread, dispatched on the processing thread
+    TripleBuffer<float> blendInput;
+    
+    // Input waiting to be dispatched on the processing thread (stateMutex)
+    std::string pendingUpload;
+    int pendingSourceStep;
+    int pendingModeStep;
     
     // Callbacks
     std::function<void(float)> blendStrengthCallback;
     std::function<void(const std::string&)> imageUploadCallback;
+    std::function<void(int)> sourceCycleCallback;
+    std::function<void(int)> modeCycleCallback;
     
     // Window dimensions
     int windowWidth;
     int windowHeight;
     
-    // OpenCV window for display (we'll enhance it)
+    // OpenCV window for display, owned by the display thread
     std::string windowName;
     bool initialized;
     
-    // Slider bounds (calculated during rendering)
+    // Widget layout (calculated once in computeLayout())
     int sliderX, sliderY, sliderWidth, sliderHeight;
     int uploadButtonX, uploadButtonY, uploadButtonWidth, uploadButtonHeight;
+    int blendValueY, faceCountY, fpsY, virtualCameraY;
     int previewWidth;
     bool draggingSlider;
     
@@ -0,0 +1,78 @@
+#include "ProcessorSelector.hpp"
+#include <iostream>
+
+ProcessorSelector::ProcessorSelector()
+    : requested(static_cast<int>(ProcessingMode::Advanced))
+    , fallback(false)
+    , active(static_cast<int>(ProcessingMode::Advanced))
+    , switches(0)
+    , started(false)
+{
+}
+
+void ProcessorSelector::add(std::unique_ptr<FrameProcessor> processor) {
+    if (!processor) {
+        return;
+    }
+    size_t index = static_cast<size_t>(processor->getMode());
+    processors[index] = std::move(processor);
+}
+
+bool ProcessorSelector::has(ProcessingMode mode) const {
+    return get(mode) != nullptr;
+}
+
+FrameProcessor* ProcessorSelector::get(ProcessingMode mode) const {
+    size_t index = static_cast<size_t>(mode);
+    return index < processors.size() ? processors[index].get() : nullptr;
+}
+
+bool ProcessorSelector::request(ProcessingMode mode) {
+    if (!has(mode)) {
+        std::cerr << "Error: Mode not available: " << FrameProcessor::modeName(mode) << std::endl;
+        return false;
+    }
+    requested = static_cast<int>(mode);
+    return true;
+}
+
+ProcessingMode ProcessorSelector::cycle(int step) {
+    int count = static_cast<int>(ProcessingMode::Count);
+    int mode = requested;
+    int direction = step >= 0 ? 1 : -1;
+    for (int remaining = step >= 0 ? step : -step; remaining > 0; remaining--) {
+        // Skip modes that were not loaded; there is always at least one
+        for (int tries = 0; tries < count; tries++) {
+            mode = (mode + direction + count) % count;
+            if (has(static_cast<ProcessingMode>(mode))) {
+                break;
+            }
+        }
+    }
+    request(static_cast<ProcessingMode>(mode));
+    return static_cast<ProcessingMode>(mode);
+}
+
+ProcessingMode ProcessorSelector::resolve() const {
+    ProcessingMode mode = getRequestedMode();
+    if (mode == ProcessingMode::Advanced && fallback && has(ProcessingMode::Basic)) {
+        return ProcessingMode::Basic;
+    }
+    return mode;
+}
+
+FrameProcessor& ProcessorSelector::acquire() {
+    ProcessingMode mode = resolve();
+    if (!started || static_cast<int>(mode) != active) {
+        FrameProcessor* processor = get(mode);
+        if (started) {
+            processor->reset();
+            switches++;
+            std::cout << "Mode: " << FrameProcessor::modeName(mode)
+                      << (mode != getRequestedMode() ? " (fallback)" : "") << std::endl;
+        }
+        active = static_cast<int>(mode);
+        started = true;
+    }
+    return *get(mode);
+}
@@ -0,0 +1,57 @@
+#ifndef PROCESSOR_SELECTOR_HPP
+#define PROCESSOR_SELECTOR_HPP
+
+#include "FrameProcessor.hpp"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+// The frame processors loaded at startup and which one runs next.
+//
+// Any thread can request a mode; the frame thread picks it up at the next
+// frame boundary in acquire(), so a switch never interrupts a frame and
+// never loads anything. Independently of the requested mode, an automatic
+// fallback (QualityGovernor's last level) can divert Advanced frames to the
+// Basic processor while the CPU cannot keep up.
+class ProcessorSelector {
+public:
+    ProcessorSelector();
+
+    // Takes ownership; replaces any processor of the same mode
+    void add(std::unique_ptr<FrameProcessor> processor);
+    bool has(ProcessingMode mode) const;
+    FrameProcessor* get(ProcessingMode mode) const;
+
+    // Any thread. False if no processor for `mode` was added.
+    bool request(ProcessingMode mode);
+    ProcessingMode getRequestedMode() const { return static_cast<ProcessingMode>(requested.load()); }
+
+    // Request the next (step > 0) or previous loaded mode
+    ProcessingMode cycle(int step);
+
+    // Any thread: run Basic instead of Advanced while set
+    void setFallback(bool enable) { fallback = enable; }
+    bool isFallbackActive() const { return fallback; }
+
+    // Frame thread: the processor for the frame about to run. A processor
+    // that becomes active again is reset, so it does not pick up tracks and
+    // stabilization history from before it was switched away.
+    FrameProcessor& acquire();
+
+    // Mode of the processor that ran last (any thread)
+    ProcessingMode getActiveMode() const { return static_cast<ProcessingMode>(active.load()); }
+    uint64_t getSwitchCount() const { return switches; }
+
+private:
+    std::array<std::unique_ptr<FrameProcessor>, static_cast<size_t>(ProcessingMode::Count)> processors;
+    std::atomic<int> requested;
+    std::atomic<bool> fallback;
+    std::atomic<int> active;
+    std::atomic<uint64_t> switches;
+    bool started;
+
+    ProcessingMode resolve() const;
+};
+
+#endif // PROCESSOR_SELECTOR_HPP
@@ -0,0 +1,24 @@
+#ifndef PROFILE_STAGE_HPP
+#define PROFILE_STAGE_HPP
+
+// Timed stages, in pipeline order
+enum class ProfileStage {
+    Capture,
+    Preprocess,
+    Detect,
+    Align,
+    Embed,
+    Swap,
+    Decode,
+    Restore,
+    Stabilize,
+    Mask,
+    Blend,
+    Gui,
+    GuiRender,          // drawing the preview window, without event handling
+    VirtualCameraWrite,
+    Frame,              // whole detectAndSwap() / pipeline frame
+    Count
+};
+
+#endif // PROFILE_STAGE_HPP
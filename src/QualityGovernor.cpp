@@ -0,0 +1,174 @@
+#include "QualityGovernor.hpp"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+
+namespace {
+// Smoothing factor for the per-stage moving averages
+const double SMOOTHING = 0.2;
+
+// Degrade after this many frames above DEGRADE_RATIO * budget
+const int DEGRADE_FRAMES = 5;
+const double DEGRADE_RATIO = 1.1;
+
+// Recover after this many frames below RECOVER_RATIO * budget
+const int RECOVER_FRAMES = 45;
+const double RECOVER_RATIO = 0.7;
+
+// Leaving basic mode: its timings say little about the model pipeline's cost
+const int BASIC_MODE_RECOVER_FRAMES = 450;
+
+// Frames ignored after a level change while timings settle
+const int COOLDOWN_FRAMES = 15;
+
+// Stages cheaper than this are not worth degrading for
+const double MIN_RELIEF_MS = 1.0;
+}
+
+QualityGovernor::QualityGovernor()
+    : currentLevel(0)
+    , enabled(false)
+    , frameBudgetMs(33.0)
+    , smoothedTotalMs(0.0)
+    , smoothedDetectMs(0.0)
+    , smoothedSwapMs(0.0)
+    , smoothedRestoreMs(0.0)
+    , smoothedStabilizeMs(0.0)
+    , haveSamples(false)
+    , overBudgetFrames(0)
+    , underBudgetFrames(0)
+    , cooldownFrames(0)
+{
+    // Each step keeps everything the previous one gave up
+    QualitySettings q;
+    levels.push_back({"full quality", Relief::None, q, RECOVER_FRAMES});
+
+    q.allowRestoration = false;
+    levels.push_back({"restoration off", Relief::Restore, q, RECOVER_FRAMES});
+
+    q.detectionInterval = 2;
+    levels.push_back({"detect every 2nd frame", Relief::Detect, q, RECOVER_FRAMES});
+
+    q.allowStabilization = false;
+    levels.push_back({"stabilization off", Relief::Stabilize, q, RECOVER_FRAMES});
+
+    q.detectionScale = 0.5f;
+    levels.push_back({"detector at half size", Relief::Detect, q, RECOVER_FRAMES});
+
+    q.maxModelSwapFaces = 1;
+    levels.push_back({"model swap on 1 face", Relief::Swap, q, RECOVER_FRAMES});
+
+    q.detectionInterval = 3;
+    levels.push_back({"detect every 3rd frame", Relief::Detect, q, RECOVER_FRAMES});
+
+    q.maxModelSwapFaces = 0;
+    levels.push_back({"geometric only", Relief::Swap, q, RECOVER_FRAMES});
+
+    q.basicMode = true;
+    levels.push_back({"basic mode", Relief::Mode, q, BASIC_MODE_RECOVER_FRAMES});
+}
+
+void QualityGovernor::setFrameBudget(double ms) {
+    frameBudgetMs = std::max(1.0, ms);
+}
+
+void QualityGovernor::setEnabled(bool enable) {
+    enabled = enable;
+    if (!enabled) {
+        changeLevel(0);
+    }
+}
+
+const QualitySettings& QualityGovernor::getSettings() const {
+    return levels[currentLevel].settings;
+}
+
+const std::string& QualityGovernor::getLevelName() const {
+    return levels[currentLevel].name;
+}
+
+double QualityGovernor::reliefCost(Relief relief) const {
+    switch (relief) {
+        case Relief::Restore: return smoothedRestoreMs;
+        case Relief::Detect: return smoothedDetectMs;
+        case Relief::Stabilize: return smoothedStabilizeMs;
+        case Relief::Swap: return smoothedSwapMs;
+        case Relief::Mode: return smoothedTotalMs;
+        default: return 0.0;
+    }
+}
+
+void QualityGovernor::changeLevel(int level) {
+    level = std::max(0, std::min(getLevelCount() - 1, level));
+    overBudgetFrames = 0;
+    underBudgetFrames = 0;
+    if (level == currentLevel) {
+        return;
+    }
+
+    currentLevel = level;
+    cooldownFrames = COOLDOWN_FRAMES;
+    std::cout << "Quality governor: " << describe() << std::endl;
+}
+
+bool QualityGovernor::update(const FrameTimings& timings) {
+    if (!enabled) {
+        return false;
+    }
+
+    if (!haveSamples) {
+        smoothedTotalMs = timings.totalMs;
+        smoothedDetectMs = timings.detectMs;
+        smoothedSwapMs = timings.swapMs;
+        smoothedRestoreMs = timings.restoreMs;
+        smoothedStabilizeMs = timings.stabilizeMs;
+        haveSamples = true;
+    } else {
+        smoothedTotalMs += SMOOTHING * (timings.totalMs - smoothedTotalMs);
+        smoothedSwapMs += SMOOTHING * (timings.swapMs - smoothedSwapMs);
+        smoothedRestoreMs += SMOOTHING * (timings.restoreMs - smoothedRestoreMs);
+        smoothedStabilizeMs += SMOOTHING * (timings.stabilizeMs - smoothedStabilizeMs);
+        // Detection only runs on some frames; track its cost when it does
+        if (timings.detectionRan) {
+            smoothedDetectMs += SMOOTHING * (timings.detectMs - smoothedDetectMs);
+        }
+    }
+
+    if (cooldownFrames > 0) {
+        cooldownFrames--;
+        return false;
+    }
+
+    int previousLevel = currentLevel;
+
+    if (smoothedTotalMs > frameBudgetMs * DEGRADE_RATIO) {
+        underBudgetFrames = 0;
+        if (++overBudgetFrames >= DEGRADE_FRAMES && currentLevel + 1 < getLevelCount()) {
+            // Skip steps that relieve a stage which currently costs nothing,
+            // unless it is the last step left
+            int next = currentLevel + 1;
+            while (next + 1 < getLevelCount() && reliefCost(levels[next].relief) < MIN_RELIEF_MS) {
+                next++;
+            }
+            changeLevel(next);
+        }
+    } else if (smoothedTotalMs < frameBudgetMs * RECOVER_RATIO) {
+        overBudgetFrames = 0;
+        if (++underBudgetFrames >= levels[currentLevel].recoverFrames && currentLevel > 0) {
+            changeLevel(currentLevel - 1);
+        }
+    } else {
+        overBudgetFrames = 0;
+        underBudgetFrames = 0;
+    }
+
+    return currentLevel != previousLevel;
+}
+
+std::string QualityGovernor::describe() const {
+    std::ostringstream oss;
+    oss << "L" << currentLevel << "/" << (getLevelCount() - 1) << " " << getLevelName()
+        << " (" << std::fixed << std::setprecision(1) << smoothedTotalMs << " ms)";
+    return oss.str();
+}
@@ -0,0 +1,79 @@
+#ifndef QUALITY_GOVERNOR_HPP
+#define QUALITY_GOVERNOR_HPP
+
+#include "AdvancedFaceSwapper.hpp"
+#include <string>
+#include <vector>
+
+// Deadline-driven quality controller.
+//
+// Watches the per-stage timings of each processed frame against a target
+// frame budget and walks a ladder of QualitySettings: restoration off,
+// sparser detection, stabilization off, smaller detector input, fewer model
+// swaps, geometric-only and finally basic mode (the separate FaceSwapper
+// processor, which skips the model pipeline entirely). Steps that would not relieve a stage that
+// currently costs anything are skipped when degrading.
+//
+// Hysteresis: degrade only after the smoothed frame time has been over budget
+// for several frames, recover only after a longer run well under budget, and
+// ignore a short cooldown after every change while the new level settles.
+// Basic mode is much cheaper than anything above it, so leaving it takes a
+// far longer run under budget; otherwise it would flip back and forth.
+class QualityGovernor {
+public:
+    QualityGovernor();
+
+    // Target time per processed frame (e.g. 33 ms for 30 FPS)
+    void setFrameBudget(double ms);
+    double getFrameBudget() const { return frameBudgetMs; }
+
+    void setEnabled(bool enable);
+    bool isEnabled() const { return enabled; }
+
+    // Feed the timings of the frame that just completed.
+    // Returns true if the quality level changed.
+    bool update(const FrameTimings& timings);
+
+    // Current decision
+    const QualitySettings& getSettings() const;
+    int getLevel() const { return currentLevel; }
+    int getLevelCount() const { return static_cast<int>(levels.size()); }
+    const std::string& getLevelName() const;
+    double getSmoothedFrameMs() const { return smoothedTotalMs; }
+
+    // Short human readable status, e.g. "L2/7 detect every 2nd frame (41.3 ms)"
+    std::string describe() const;
+
+private:
+    // Which stage a ladder step takes load off
+    enum class Relief { None, Restore, Detect, Stabilize, Swap, Mode };
+
+    struct Level {
+        std::string name;
+        Relief relief;
+        QualitySettings settings;
+        int recoverFrames;          // frames well under budget before stepping back up
+    };
+
+    std::vector<Level> levels;
+    int currentLevel;
+    bool enabled;
+    double frameBudgetMs;
+
+    // Exponentially smoothed timings
+    double smoothedTotalMs;
+    double smoothedDetectMs;
+    double smoothedSwapMs;
+    double smoothedRestoreMs;
+    double smoothedStabilizeMs;
+    bool haveSamples;
+
+    int overBudgetFrames;
+    int underBudgetFrames;
+    int cooldownFrames;
+
+    double reliefCost(Relief relief) const;
+    void changeLevel(int level);
+};
+
+#endif // QUALITY_GOVERNOR_HPP
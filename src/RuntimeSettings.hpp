@@ -0,0 +1,55 @@
+#ifndef RUNTIME_SETTINGS_HPP
+#define RUNTIME_SETTINGS_HPP
+
+#include "TripleBuffer.hpp"
+#include <functional>
+#include <mutex>
+
+// Swap settings that can change while frames are running (GUI, control
+// socket). Quality limits are separate (QualitySettings).
+struct RuntimeSettings {
+    float blendStrength = 0.95f;
+    bool temporalStabilization = true;
+    bool enableGFPGAN = false;
+};
+
+// Publishes RuntimeSettings to the frame loop.
+//
+// Writers change a copy and publish it through a TripleBuffer; the frame
+// loop polls it at a frame boundary without locking or waiting, and only
+// applies the settings when poll() says they changed. Writers serialize
+// among themselves, never with the frame loop.
+class RuntimeSettingsChannel {
+public:
+    explicit RuntimeSettingsChannel(const RuntimeSettings& initial = RuntimeSettings())
+        : current(initial) {
+        buffer.writeBuffer() = initial;
+        buffer.publish();
+    }
+
+    // Any thread: let `change` modify the settings and publish the result
+    void update(const std::function<void(RuntimeSettings&)>& change) {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        change(current);
+        buffer.writeBuffer() = current;
+        buffer.publish();
+    }
+
+    // Any thread: the most recently published settings
+    RuntimeSettings get() const {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        return current;
+    }
+
+    // Frame loop only: true if settings were published since the last call;
+    // latest() then returns them
+    bool poll() { return buffer.update(); }
+    const RuntimeSettings& latest() const { return buffer.read(); }
+
+private:
+    mutable std::mutex writeMutex;
+    RuntimeSettings current;
+    TripleBuffer<RuntimeSettings> buffer;
+};
+
+#endif // RUNTIME_SETTINGS_HPP
@@ -0,0 +1,511 @@
+#include "SessionRecorder.hpp"
+#include "Logger.hpp"
+#include <cstring>
+#include <iostream>
+
+namespace {
+const char kFileMagic[8] = {'F', 'S', 'R', 'E', 'C', '0', '1', '\0'};
+const char kTrailerMagic[8] = {'F', 'S', 'R', 'E', 'C', 'E', 'N', 'D'};
+const uint32_t kFormatVersion = 1;
+
+const uint32_t kChunkFrame = 1;
+const uint32_t kChunkDetections = 2;
+const uint32_t kChunkIndex = 3;
+
+const uint64_t kHeaderBytes = 16;       // magic, version, codec
+const uint64_t kChunkHeaderBytes = 24;  // type, payload size, frame index, timestamp
+const uint64_t kTrailerBytes = 16;      // index offset, magic
+
+template<typename T>
+void put(std::vector<uint8_t>& out, T value) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+template<typename T>
+bool get(const std::vector<uint8_t>& in, size_t& offset, T& value) {
+    if (offset + sizeof(T) > in.size()) {
+        return false;
+    }
+    std::memcpy(&value, in.data() + offset, sizeof(T));
+    offset += sizeof(T);
+    return true;
+}
+
+template<typename T>
+void writeValue(std::ofstream& out, T value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+bool readValue(std::ifstream& in, T& value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+}
+
+// ---------------------------------------------------------------------------
+// SessionRecorder
+
+SessionRecorder::SessionRecorder()
+    : codec(SessionCodec::Png)
+    , frameDepth(0)
+    , running(false)
+    , recordedFrames(0)
+    , droppedFrames(0)
+    , droppedDetections(0)
+    , haveEpoch(false)
+{
+}
+
+SessionRecorder::~SessionRecorder() {
+    close();
+}
+
+bool SessionRecorder::parseCodec(const std::string& name, SessionCodec& codec) {
+    if (name == "raw") {
+        codec = SessionCodec::Raw;
+    } else if (name == "png") {
+        codec = SessionCodec::Png;
+    } else if (name == "jpg" || name == "jpeg") {
+        codec = SessionCodec::Jpeg;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool SessionRecorder::open(const std::string& filePath, SessionCodec frameCodec, size_t queueDepth) {
+    if (running) {
+        close();
+    }
+
+    file.open(filePath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not create recording: " << filePath << std::endl;
+        return false;
+    }
+
+    path = filePath;
+    codec = frameCodec;
+    file.write(kFileMagic, sizeof(kFileMagic));
+    writeValue(file, kFormatVersion);
+    writeValue(file, static_cast<uint32_t>(codec));
+
+    index.clear();
+    recordedFrames = 0;
+    droppedFrames = 0;
+    droppedDetections = 0;
+    haveEpoch = false;
+    // The second half of the queue is kept for detection chunks
+    frameDepth = queueDepth;
+    queue = std::make_unique<BoundedQueue<Chunk>>(queueDepth * 2);
+    running = true;
+    writer = std::thread(&SessionRecorder::writeLoop, this);
+    return true;
+}
+
+void SessionRecorder::close() {
+    if (!running) {
+        return;
+    }
+    running = false;
+
+    // The writer drains what is queued before it exits
+    queue->close();
+    if (writer.joinable()) {
+        writer.join();
+    }
+    writeIndex();
+    file.close();
+
+    std::cout << "Recording: " << path << " (" << recordedFrames << " frames";
+    if (droppedFrames > 0) {
+        std::cout << ", " << droppedFrames << " dropped while the writer was behind";
+    }
+    if (droppedDetections > 0) {
+        std::cout << ", " << droppedDetections << " without detections";
+    }
+    std::cout << ")" << std::endl;
+}
+
+bool SessionRecorder::recordFrame(uint64_t frameIndex, std::chrono::steady_clock::time_point timestamp,
+                                  const cv::Mat& frame) {
+    if (!running || frame.empty()) {
+        return false;
+    }
+    if (!haveEpoch) {
+        epoch = timestamp;
+        haveEpoch = true;
+    }
+
+    // Check for room before copying, so a writer that is behind costs the
+    // capture thread nothing per dropped frame. Only this thread queues
+    // frames, so the room cannot be taken by another frame meanwhile.
+    if (queue->size() >= frameDepth) {
+        droppedFrames++;
+        return false;
+    }
+
+    Chunk chunk;
+    chunk.type = kChunkFrame;
+    chunk.frameIndex = frameIndex;
+    chunk.timestampUs = std::chrono::duration_cast<std::chrono::microseconds>(timestamp - epoch).count();
+    chunk.data = frame.clone();
+
+    if (!queue->tryPush(std::move(chunk))) {
+        droppedFrames++;
+        return false;
+    }
+    return true;
+}
+
+bool SessionRecorder::recordDetections(uint64_t frameIndex, const cv::Mat& faces) {
+    if (!running) {
+        return false;
+    }
+
+    Chunk chunk;
+    chunk.type = kChunkDetections;
+    chunk.frameIndex = frameIndex;
+    if (!faces.empty()) {
+        faces.convertTo(chunk.data, CV_32F);
+    }
+
+    // Losing them while the frame made it makes the replay fall back to the
+    // detector for that frame, so they may use the room frames leave free;
+    // waiting for more would stall the frame loop or the pipeline
+    if (!queue->tryPush(std::move(chunk))) {
+        droppedDetections++;
+        return false;
+    }
+    return true;
+}
+
+void SessionRecorder::writeLoop() {
+    Chunk chunk;
+    while (queue->pop(chunk)) {
+        if (!writeChunk(chunk)) {
+            LOG_ERROR("Could not write recording chunk for frame " << chunk.frameIndex << " to " << path);
+        }
+    }
+}
+
+bool SessionRecorder::writeChunk(const Chunk& chunk) {
+    std::vector<uint8_t> payload;
+
+    if (chunk.type == kChunkFrame) {
+        const cv::Mat& frame = chunk.data;
+        put<int32_t>(payload, frame.rows);
+        put<int32_t>(payload, frame.cols);
+        put<int32_t>(payload, frame.type());
+        put<uint32_t>(payload, static_cast<uint32_t>(codec));
+
+        if (codec == SessionCodec::Raw) {
+            cv::Mat continuous = frame.isContinuous() ? frame : frame.clone();
+            payload.insert(payload.end(), continuous.data, continuous.data + continuous.total() * continuous.elemSize());
+        } else {
+            std::vector<uint8_t> encoded;
+            std::vector<int> params;
+            if (codec == SessionCodec::Png) {
+                params = {cv::IMWRITE_PNG_COMPRESSION, 1};
+            } else {
+                params = {cv::IMWRITE_JPEG_QUALITY, 95};
+            }
+            if (!cv::imencode(codec == SessionCodec::Png ? ".png" : ".jpg", frame, encoded, params)) {
+                return false;
+            }
+            payload.insert(payload.end(), encoded.begin(), encoded.end());
+        }
+    } else {
+        const cv::Mat& faces = chunk.data;
+        put<int32_t>(payload, faces.rows);
+        put<int32_t>(payload, faces.cols);
+        for (int r = 0; r < faces.rows; r++) {
+            const float* row = faces.ptr<float>(r);
+            for (int c = 0; c < faces.cols; c++) {
+                put<float>(payload, row[c]);
+            }
+        }
+    }
+
+    uint64_t offset = static_cast<uint64_t>(file.tellp());
+    writeValue(file, chunk.type);
+    writeValue(file, static_cast<uint32_t>(payload.size()));
+    writeValue(file, chunk.frameIndex);
+    writeValue(file, chunk.timestampUs);
+    file.write(reinterpret_cast<const char*>(payload.data()), static_cast<std::streamsize>(payload.size()));
+    if (!file) {
+        return false;
+    }
+
+    SessionIndexEntry& entry = index[chunk.frameIndex];
+    if (chunk.type == kChunkFrame) {
+        entry.frameOffset = offset;
+        recordedFrames++;
+    } else {
+        entry.detectionOffset = offset;
+    }
+    return true;
+}
+
+void SessionRecorder::writeIndex() {
+    std::vector<uint8_t> payload;
+    uint64_t count = 0;
+    for (const auto& item : index) {
+        if (item.second.frameOffset != 0) {
+            count++;
+        }
+    }
+    put<uint64_t>(payload, count);
+    for (const auto& item : index) {
+        // Detections whose frame was dropped have nothing to replay against
+        if (item.second.frameOffset == 0) continue;
+        put<uint64_t>(payload, item.first);
+        put<uint64_t>(payload, item.second.frameOffset);
+        put<uint64_t>(payload, item.second.detectionOffset);
+    }
+
+    uint64_t indexOffset = static_cast<uint64_t>(file.tellp());
+    writeValue(file, kChunkIndex);
+    writeValue(file, static_cast<uint32_t>(payload.size()));
+    writeValue(file, static_cast<uint64_t>(0));
+    writeValue(file, static_cast<int64_t>(0));
+    file.write(reinterpret_cast<const char*>(payload.data()), static_cast<std::streamsize>(payload.size()));
+    writeValue(file, indexOffset);
+    file.write(kTrailerMagic, sizeof(kTrailerMagic));
+}
+
+// ---------------------------------------------------------------------------
+// SessionReader
+
+SessionReader::SessionReader()
+    : width(0)
+    , height(0)
+    , position(0)
+{
+}
+
+bool SessionReader::open(const std::string& filePath) {
+    close();
+    file.open(filePath, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open recording: " << filePath << std::endl;
+        return false;
+    }
+    path = filePath;
+
+    char magic[sizeof(kFileMagic)];
+    uint32_t version = 0;
+    uint32_t codec = 0;
+    if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, kFileMagic, sizeof(magic)) != 0 ||
+        !readValue(file, version) || version != kFormatVersion || !readValue(file, codec)) {
+        std::cerr << "Error: Not a session recording: " << filePath << std::endl;
+        close();
+        return false;
+    }
+
+    file.seekg(0, std::ios::end);
+    uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+    if (!readIndex(fileSize)) {
+        std::cerr << "Warning: Recording has no index (interrupted?), scanning " << filePath << std::endl;
+        if (!scanChunks(fileSize)) {
+            close();
+            return false;
+        }
+    }
+    if (entries.empty()) {
+        std::cerr << "Error: Recording contains no frames: " << filePath << std::endl;
+        close();
+        return false;
+    }
+
+    // Frame size from the first frame chunk
+    int64_t timestampUs = 0;
+    std::vector<uint8_t> payload;
+    size_t offset = 0;
+    int32_t rows = 0;
+    int32_t cols = 0;
+    if (!readChunkAt(entries.front().second.frameOffset, kChunkFrame, timestampUs, payload) ||
+        !get(payload, offset, rows) || !get(payload, offset, cols)) {
+        std::cerr << "Error: Corrupt recording: " << filePath << std::endl;
+        close();
+        return false;
+    }
+    width = cols;
+    height = rows;
+    position = 0;
+    return true;
+}
+
+void SessionReader::close() {
+    if (file.is_open()) {
+        file.close();
+    }
+    file.clear();
+    entries.clear();
+    width = 0;
+    height = 0;
+    position = 0;
+}
+
+bool SessionReader::readIndex(uint64_t fileSize) {
+    if (fileSize < kHeaderBytes + kChunkHeaderBytes + kTrailerBytes) {
+        return false;
+    }
+
+    uint64_t indexOffset = 0;
+    char magic[sizeof(kTrailerMagic)];
+    file.clear();
+    file.seekg(static_cast<std::streamoff>(fileSize - kTrailerBytes));
+    if (!readValue(file, indexOffset) || !file.read(magic, sizeof(magic)) ||
+        std::memcmp(magic, kTrailerMagic, sizeof(magic)) != 0 || indexOffset < kHeaderBytes) {
+        return false;
+    }
+
+    int64_t timestampUs = 0;
+    std::vector<uint8_t> payload;
+    if (!readChunkAt(indexOffset, kChunkIndex, timestampUs, payload)) {
+        return false;
+    }
+
+    size_t offset = 0;
+    uint64_t count = 0;
+    if (!get(payload, offset, count)) {
+        return false;
+    }
+    entries.clear();
+    entries.reserve(static_cast<size_t>(count));
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t frameIndex = 0;
+        SessionIndexEntry entry;
+        if (!get(payload, offset, frameIndex) || !get(payload, offset, entry.frameOffset) ||
+            !get(payload, offset, entry.detectionOffset)) {
+            entries.clear();
+            return false;
+        }
+        entries.emplace_back(frameIndex, entry);
+    }
+    return true;
+}
+
+bool SessionReader::scanChunks(uint64_t fileSize) {
+    std::map<uint64_t, SessionIndexEntry> found;
+    uint64_t offset = kHeaderBytes;
+
+    file.clear();
+    while (offset + kChunkHeaderBytes <= fileSize) {
+        uint32_t type = 0;
+        uint32_t payloadBytes = 0;
+        uint64_t frameIndex = 0;
+        file.seekg(static_cast<std::streamoff>(offset));
+        if (!readValue(file, type) || !readValue(file, payloadBytes) || !readValue(file, frameIndex)) {
+            break;
+        }
+        // A truncated last chunk ends the usable part of the file
+        if (offset + kChunkHeaderBytes + payloadBytes > fileSize) {
+            break;
+        }
+        if (type == kChunkFrame) {
+            found[frameIndex].frameOffset = offset;
+        } else if (type == kChunkDetections) {
+            found[frameIndex].detectionOffset = offset;
+        } else {
+            break;
+        }
+        offset += kChunkHeaderBytes + payloadBytes;
+    }
+
+    entries.clear();
+    for (const auto& item : found) {
+        if (item.second.frameOffset != 0) {
+            entries.emplace_back(item.first, item.second);
+        }
+    }
+    file.clear();
+    return true;
+}
+
+bool SessionReader::readChunkAt(uint64_t offset, uint32_t expectedType, int64_t& timestampUs,
+                                std::vector<uint8_t>& payload) {
+    uint32_t type = 0;
+    uint32_t payloadBytes = 0;
+    uint64_t frameIndex = 0;
+
+    file.clear();
+    file.seekg(static_cast<std::streamoff>(offset));
+    if (!readValue(file, type) || type != expectedType || !readValue(file, payloadBytes) ||
+        !readValue(file, frameIndex) || !readValue(file, timestampUs)) {
+        return false;
+    }
+    payload.resize(payloadBytes);
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(payload.data()), payloadBytes));
+}
+
+bool SessionReader::seek(size_t newPosition) {
+    if (newPosition >= entries.size()) {
+        return false;
+    }
+    position = newPosition;
+    return true;
+}
+
+bool SessionReader::next(RecordedFrame& out) {
+    if (!file.is_open() || position >= entries.size()) {
+        return false;
+    }
+    const uint64_t frameIndex = entries[position].first;
+    const SessionIndexEntry entry = entries[position].second;
+    position++;
+
+    std::vector<uint8_t> payload;
+    int64_t timestampUs = 0;
+    if (!readChunkAt(entry.frameOffset, kChunkFrame, timestampUs, payload)) {
+        LOG_ERROR("Could not read frame " << frameIndex << " from " << path);
+        return false;
+    }
+
+    size_t offset = 0;
+    int32_t rows = 0;
+    int32_t cols = 0;
+    int32_t type = 0;
+    uint32_t codec = 0;
+    if (!get(payload, offset, rows) || !get(payload, offset, cols) || !get(payload, offset, type) ||
+        !get(payload, offset, codec)) {
+        return false;
+    }
+
+    if (codec == static_cast<uint32_t>(SessionCodec::Raw)) {
+        cv::Mat raw(rows, cols, type);
+        size_t bytes = raw.total() * raw.elemSize();
+        if (offset + bytes > payload.size()) {
+            return false;
+        }
+        std::memcpy(raw.data, payload.data() + offset, bytes);
+        out.frame = raw;
+    } else {
+        cv::Mat encoded(1, static_cast<int>(payload.size() - offset), CV_8UC1, payload.data() + offset);
+        out.frame = cv::imdecode(encoded, cv::IMREAD_UNCHANGED);
+        if (out.frame.empty()) {
+            return false;
+        }
+    }
+    out.frameIndex = frameIndex;
+    out.timestampUs = timestampUs;
+    out.faces.release();
+    out.hasFaces = false;
+
+    if (entry.detectionOffset != 0) {
+        int64_t unused = 0;
+        offset = 0;
+        if (readChunkAt(entry.detectionOffset, kChunkDetections, unused, payload) &&
+            get(payload, offset, rows) && get(payload, offset, cols) &&
+            offset + static_cast<size_t>(rows) * cols * sizeof(float) <= payload.size()) {
+            out.faces = cv::Mat(rows, cols, CV_32F);
+            if (rows > 0 && cols > 0) {
+                std::memcpy(out.faces.data, payload.data() + offset, static_cast<size_t>(rows) * cols * sizeof(float));
+            }
+            out.hasFaces = true;
+        }
+    }
+    return true;
+}
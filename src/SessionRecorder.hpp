@@ -0,0 +1,141 @@
+#ifndef SESSION_RECORDER_HPP
+#define SESSION_RECORDER_HPP
+
+#include "BoundedQueue.hpp"
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Session recordings (.fsrec): captured frames with their capture timestamps
+// and, optionally, the detector output for each frame, so a live session can
+// be replayed through AdvancedFaceSwapper deterministically.
+//
+// Layout (native byte order, a diagnostic format rather than an exchange one):
+//
+//   header | chunk* | index chunk | trailer
+//
+// Every chunk carries the capture frame index and timestamp it belongs to.
+// Frame chunks hold raw pixels or a PNG/JPEG encoding; detection chunks hold
+// the YuNet rows as float32. The index at the end maps frame indices to chunk
+// offsets for seeking. A recording cut short without an index (crash, kill)
+// is still readable: the reader rebuilds the index by scanning the chunks.
+
+enum class SessionCodec : uint32_t {
+    Raw = 0,    // fastest, largest
+    Png = 1,    // lossless (default)
+    Jpeg = 2    // smallest, lossy; replayed pixels differ from the capture
+};
+
+// Chunk offsets of one recorded frame
+struct SessionIndexEntry {
+    uint64_t frameOffset = 0;
+    uint64_t detectionOffset = 0;   // 0 = no detections recorded
+};
+
+// Writes a recording on a background thread. Encoding and disk I/O never
+// block the caller: if the writer falls behind, frames are dropped from the
+// recording and counted instead of stalling capture. Frames may only fill
+// part of the queue, so the (tiny) detection chunks still fit while frames
+// are being dropped; they are dropped and counted only past that.
+class SessionRecorder {
+public:
+    SessionRecorder();
+    ~SessionRecorder();
+
+    bool open(const std::string& path, SessionCodec codec = SessionCodec::Png, size_t queueDepth = 64);
+
+    // Flush queued chunks, write the index and close the file
+    void close();
+
+    bool isOpen() const { return running; }
+
+    // Queue a copy of `frame` captured at `timestamp`. Returns false if it
+    // was dropped because the writer is behind.
+    bool recordFrame(uint64_t frameIndex, std::chrono::steady_clock::time_point timestamp, const cv::Mat& frame);
+
+    // Queue the detector output (YuNet rows) used for frame `frameIndex`.
+    // Returns false if it was dropped because the writer is behind.
+    bool recordDetections(uint64_t frameIndex, const cv::Mat& faces);
+
+    uint64_t getRecordedFrames() const { return recordedFrames; }
+    uint64_t getDroppedFrames() const { return droppedFrames; }
+    uint64_t getDroppedDetections() const { return droppedDetections; }
+
+    static bool parseCodec(const std::string& name, SessionCodec& codec);
+
+private:
+    struct Chunk {
+        uint32_t type = 0;
+        uint64_t frameIndex = 0;
+        int64_t timestampUs = 0;
+        cv::Mat data;
+    };
+
+    std::ofstream file;
+    std::string path;
+    SessionCodec codec;
+    std::unique_ptr<BoundedQueue<Chunk>> queue;
+    size_t frameDepth;          // queued chunks beyond which frames are dropped
+    std::thread writer;
+    std::atomic<bool> running;
+    std::atomic<uint64_t> recordedFrames;
+    std::atomic<uint64_t> droppedFrames;
+    std::atomic<uint64_t> droppedDetections;
+    bool haveEpoch;
+    std::chrono::steady_clock::time_point epoch;
+    std::map<uint64_t, SessionIndexEntry> index;   // writer thread only
+
+    void writeLoop();
+    bool writeChunk(const Chunk& chunk);
+    void writeIndex();
+};
+
+// One frame read back from a recording
+struct RecordedFrame {
+    uint64_t frameIndex = 0;
+    int64_t timestampUs = 0;    // since the first recorded frame
+    cv::Mat frame;
+    cv::Mat faces;              // empty if no detections were recorded
+    bool hasFaces = false;
+};
+
+// Sequential, seekable reader for .fsrec files
+class SessionReader {
+public:
+    SessionReader();
+
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const { return file.is_open(); }
+    size_t getFrameCount() const { return entries.size(); }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+    // Position the reader at the `position`-th recorded frame
+    bool seek(size_t position);
+
+    // Read the next recorded frame. Returns false at the end.
+    bool next(RecordedFrame& out);
+
+private:
+    std::ifstream file;
+    std::string path;
+    int width;
+    int height;
+    std::vector<std::pair<uint64_t, SessionIndexEntry>> entries;
+    size_t position;
+
+    bool readIndex(uint64_t fileSize);
+    bool scanChunks(uint64_t fileSize);
+    bool readChunkAt(uint64_t offset, uint32_t expectedType, int64_t& timestampUs, std::vector<uint8_t>& payload);
+};
+
+#endif // SESSION_RECORDER_HPP
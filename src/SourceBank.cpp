@@ -0,0 +1,259 @@
+#include "SourceBank.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+int SourceBankSnapshot::match(const cv::Mat& embedding, float* similarity) const {
+    if (targetEmbeddings.empty() || embedding.total() != static_cast<size_t>(targetEmbeddings.cols)) {
+        return -1;
+    }
+
+    cv::Mat query = embedding.reshape(1, 1);
+    if (query.type() != CV_32F) {
+        query.convertTo(query, CV_32F);
+    }
+
+    // Rows and query are unit length, so the dot products are the cosine
+    // similarities: scores = targetEmbeddings * query^T (N x 1)
+    cv::Mat scores;
+    cv::gemm(targetEmbeddings, query, 1.0, cv::Mat(), 0.0, scores, cv::GEMM_2_T);
+
+    double best = 0.0;
+    cv::Point bestLoc;
+    cv::minMaxLoc(scores, nullptr, &best, nullptr, &bestLoc);
+    if (similarity) {
+        *similarity = static_cast<float>(best);
+    }
+    return best >= threshold ? bestLoc.y : -1;
+}
+
+SourceBank::SourceBank()
+    : threshold(0.4f)
+    , version(0)
+    , current(std::make_shared<SourceBankSnapshot>())
+    , publishedVersion(0)
+    , publishedRules(false)
+{
+}
+
+void SourceBank::addSource(const std::string& name, std::shared_ptr<const SourceFace> source) {
+    std::lock_guard<std::mutex> lock(mutex);
+    sources[name] = std::move(source);
+    publish();
+}
+
+bool SourceBank::removeSource(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (sources.erase(name) == 0) {
+        return false;
+    }
+    // Rules naming it stay and apply again if the name is added back
+    publish();
+    return true;
+}
+
+std::shared_ptr<const SourceFace> SourceBank::getSource(const std::string& name) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = sources.find(name);
+    return it != sources.end() ? it->second : nullptr;
+}
+
+bool SourceBank::addRule(const std::string& targetName, const cv::Mat& targetEmbedding, const std::string& sourceName) {
+    if (targetEmbedding.empty()) {
+        std::cerr << "Error: No embedding for target identity: " << targetName << std::endl;
+        return false;
+    }
+
+    Rule rule;
+    rule.targetName = targetName;
+    rule.sourceName = sourceName;
+    targetEmbedding.reshape(1, 1).convertTo(rule.embedding, CV_32F);
+    double norm = cv::norm(rule.embedding, cv::NORM_L2);
+    if (norm <= 0.0) {
+        std::cerr << "Error: Zero embedding for target identity: " << targetName << std::endl;
+        return false;
+    }
+    rule.embedding = rule.embedding / norm;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!rules.empty() && rules.front().embedding.cols != rule.embedding.cols) {
+        std::cerr << "Error: Embedding size mismatch for target identity: " << targetName << std::endl;
+        return false;
+    }
+    auto it = std::find_if(rules.begin(), rules.end(),
+                           [&](const Rule& r) { return r.targetName == targetName; });
+    if (it != rules.end()) {
+        *it = rule;
+    } else {
+        rules.push_back(rule);
+    }
+    publish();
+    return true;
+}
+
+bool SourceBank::removeRule(const std::string& targetName) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = std::find_if(rules.begin(), rules.end(),
+                           [&](const Rule& r) { return r.targetName == targetName; });
+    if (it == rules.end()) {
+        return false;
+    }
+    rules.erase(it);
+    publish();
+    return true;
+}
+
+void SourceBank::copyFrom(const SourceBank& other) {
+    if (&other == this) {
+        return;
+    }
+    std::map<std::string, std::shared_ptr<const SourceFace>> otherSources;
+    std::vector<Rule> otherRules;
+    float otherThreshold;
+    std::string otherDefault;
+    {
+        std::lock_guard<std::mutex> lock(other.mutex);
+        otherSources = other.sources;
+        otherRules = other.rules;
+        otherThreshold = other.threshold;
+        otherDefault = other.defaultSourceName;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    sources.swap(otherSources);
+    rules.swap(otherRules);
+    threshold = otherThreshold;
+    defaultSourceName = otherDefault;
+    publish();
+}
+
+void SourceBank::setThreshold(float value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    threshold = value;
+    publish();
+}
+
+size_t SourceBank::getSourceCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return sources.size();
+}
+
+std::vector<std::string> SourceBank::getSourceNames() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::string> names;
+    for (const auto& entry : sources) {
+        names.push_back(entry.first);
+    }
+    return names;
+}
+
+size_t SourceBank::getRuleCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return rules.size();
+}
+
+void SourceBank::publish() {
+    auto next = std::make_shared<SourceBankSnapshot>();
+    next->version = ++version;
+    next->threshold = threshold;
+
+    // Only rules whose source exists take part in matching
+    std::vector<const Rule*> active;
+    for (const Rule& rule : rules) {
+        auto it = sources.find(rule.sourceName);
+        if (it != sources.end() && it->second) {
+            active.push_back(&rule);
+            next->ruleSources.push_back(it->second);
+            next->targetNames.push_back(rule.targetName);
+        }
+    }
+    if (!active.empty()) {
+        next->targetEmbeddings.create(static_cast<int>(active.size()), active.front()->embedding.cols, CV_32F);
+        for (size_t i = 0; i < active.size(); i++) {
+            active[i]->embedding.copyTo(next->targetEmbeddings.row(static_cast<int>(i)));
+        }
+    }
+
+    bool rules = next->hasRules();
+    std::atomic_store(&current, std::shared_ptr<const SourceBankSnapshot>(std::move(next)));
+    publishedRules.store(rules, std::memory_order_release);
+    publishedVersion.store(version, std::memory_order_release);
+}
+
+bool SourceBank::loadFile(const std::string& path, const PrepareFunction& prepare) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open source bank file: " << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) {
+            line = line.substr(0, comment);
+        }
+        if (!parseLine(line, prepare)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SourceBank::parseLine(const std::string& line, const PrepareFunction& prepare) {
+    std::istringstream in(line);
+    std::string kind;
+    if (!(in >> kind)) {
+        return true;
+    }
+
+    // Prepared face of an image, or null with a message
+    auto prepareImage = [&](const std::string& imagePath) -> std::shared_ptr<const SourceFace> {
+        cv::Mat image = cv::imread(imagePath);
+        if (image.empty()) {
+            std::cerr << "Error: Could not load image: " << imagePath << std::endl;
+            return nullptr;
+        }
+        std::shared_ptr<const SourceFace> face = prepare(image);
+        if (!face) {
+            std::cerr << "Error: No usable face in: " << imagePath << std::endl;
+        }
+        return face;
+    };
+
+    std::string name;
+    std::string imagePath;
+    std::string sourceName;
+    if (kind == "source" && in >> name >> imagePath) {
+        std::shared_ptr<const SourceFace> face = prepareImage(imagePath);
+        if (!face) {
+            return false;
+        }
+        addSource(name, face);
+        return true;
+    } else if (kind == "target" && in >> name >> imagePath >> sourceName) {
+        std::shared_ptr<const SourceFace> face = prepareImage(imagePath);
+        if (!face) {
+            return false;
+        }
+        if (face->embedding.empty()) {
+            std::cerr << "Error: Target identities need the ArcFace model (--arcface)" << std::endl;
+            return false;
+        }
+        return addRule(name, face->embedding, sourceName);
+    } else if (kind == "default" && in >> sourceName) {
+        std::lock_guard<std::mutex> lock(mutex);
+        defaultSourceName = sourceName;
+        return true;
+    } else if (kind == "threshold") {
+        float value;
+        if (in >> value) {
+            setThreshold(value);
+            return true;
+        }
+    }
+
+    std::cerr << "Error: Invalid source bank entry: " << line << std::endl;
+    return false;
+}
@@ -0,0 +1,109 @@
+#ifndef SOURCE_BANK_HPP
+#define SOURCE_BANK_HPP
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Everything derived from the source face image. Built off the frame path
+// by FaceSwapEngine::prepareSourceFace() and then published whole, so
+// a frame never sees a half-updated source.
+struct SourceFace {
+    cv::Mat image;
+    cv::Rect faceRect;
+    std::vector<cv::Point2f> landmarks;
+    cv::Mat aligned;            // 512x512 aligned crop
+    cv::Mat embedding;          // ArcFace output (empty without ArcFace)
+    cv::Mat latent;             // embedding as the INSwapper input, 1x512 CV_32F
+};
+
+// Immutable view of the bank used by frames. Row i of targetEmbeddings is
+// the L2-normalized ArcFace embedding of target identity i, which is
+// swapped with ruleSources[i].
+struct SourceBankSnapshot {
+    uint64_t version = 0;
+    float threshold = 0.4f;
+    cv::Mat targetEmbeddings;   // N x 512 CV_32F, one contiguous block
+    std::vector<std::string> targetNames;
+    std::vector<std::shared_ptr<const SourceFace>> ruleSources;
+
+    bool hasRules() const { return !ruleSources.empty(); }
+
+    // Best-matching target identity by cosine similarity (one matrix-vector
+    // product over all identities), or -1 below the threshold
+    int match(const cv::Mat& embedding, float* similarity = nullptr) const;
+};
+
+// Named source faces plus rules mapping target identities to them.
+//
+// Changes are copy-on-write: every mutation builds a new snapshot and
+// publishes it atomically, so frames only ever take a reference to the
+// current snapshot and are never blocked by adds or removes.
+class SourceBank {
+public:
+    using PrepareFunction = std::function<std::shared_ptr<const SourceFace>(const cv::Mat&)>;
+
+    SourceBank();
+
+    // Sources are referenced by rules by name
+    void addSource(const std::string& name, std::shared_ptr<const SourceFace> source);
+    bool removeSource(const std::string& name);
+    std::shared_ptr<const SourceFace> getSource(const std::string& name) const;
+
+    // Swap faces matching `targetEmbedding` with source `sourceName`
+    bool addRule(const std::string& targetName, const cv::Mat& targetEmbedding, const std::string& sourceName);
+    bool removeRule(const std::string& targetName);
+
+    // Replace this bank's sources, rules and settings with `other`'s. The
+    // prepared faces are immutable and shared, not copied.
+    void copyFrom(const SourceBank& other);
+
+    // Minimum cosine similarity for a target to match a rule
+    void setThreshold(float threshold);
+
+    // Source used for faces no rule matches ("" = the swapper's own source face)
+    const std::string& getDefaultSourceName() const { return defaultSourceName; }
+
+    // Read "source", "target", "default" and "threshold" lines from a file
+    // (see README), preparing images with `prepare`
+    bool loadFile(const std::string& path, const PrepareFunction& prepare);
+
+    std::shared_ptr<const SourceBankSnapshot> snapshot() const { return std::atomic_load(&current); }
+    // Version and rules of the latest snapshot, without loading it: sessions
+    // keep their snapshot and only call snapshot() when the version moved
+    uint64_t getVersion() const { return publishedVersion.load(std::memory_order_acquire); }
+    bool hasRules() const { return publishedRules.load(std::memory_order_acquire); }
+
+    size_t getSourceCount() const;
+    std::vector<std::string> getSourceNames() const;    // sorted
+    size_t getRuleCount() const;
+
+private:
+    struct Rule {
+        std::string targetName;
+        cv::Mat embedding;
+        std::string sourceName;
+    };
+
+    mutable std::mutex mutex;
+    std::map<std::string, std::shared_ptr<const SourceFace>> sources;
+    std::vector<Rule> rules;
+    float threshold;
+    uint64_t version;
+    std::string defaultSourceName;
+    std::shared_ptr<const SourceBankSnapshot> current;
+    std::atomic<uint64_t> publishedVersion;     // set after `current`
+    std::atomic<bool> publishedRules;
+
+    // Rebuild and publish the snapshot (mutex held)
+    void publish();
+    bool parseLine(const std::string& line, const PrepareFunction& prepare);
+};
+
+#endif // SOURCE_BANK_HPP
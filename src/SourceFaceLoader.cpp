@@ -0,0 +1,98 @@
+#include "SourceFaceLoader.hpp"
+#include "TraceRecorder.hpp"
+#include <chrono>
+#include <iostream>
+
+SourceFaceLoader::SourceFaceLoader(AdvancedFaceSwapper& swapper)
+    : swapper(swapper)
+    , preparing(false)
+    , running(false)
+{
+}
+
+SourceFaceLoader::~SourceFaceLoader() {
+    stop();
+}
+
+void SourceFaceLoader::start(ResultCallback callback) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (running) {
+        return;
+    }
+    onResult = callback;
+    running = true;
+    worker = std::thread(&SourceFaceLoader::loaderLoop, this);
+}
+
+void SourceFaceLoader::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running) {
+            return;
+        }
+        running = false;
+        pendingPath.clear();
+    }
+    wake.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+void SourceFaceLoader::request(const std::string& imagePath) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running) {
+            std::cerr << "Error: Source face loader is not running" << std::endl;
+            return;
+        }
+        pendingPath = imagePath;
+    }
+    wake.notify_one();
+}
+
+bool SourceFaceLoader::isBusy() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return preparing || !pendingPath.empty();
+}
+
+void SourceFaceLoader::loaderLoop() {
+    TraceRecorder::setThreadName("source-loader");
+    while (true) {
+        std::string imagePath;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return !running || !pendingPath.empty(); });
+            if (!running) {
+                return;
+            }
+            imagePath.swap(pendingPath);
+            preparing = true;
+        }
+
+        bool loaded = false;
+        cv::Mat image = cv::imread(imagePath);
+        if (image.empty()) {
+            std::cerr << "Error: Could not load source face image: " << imagePath << std::endl;
+        } else {
+            auto start = std::chrono::steady_clock::now();
+            std::shared_ptr<const SourceFace> source = swapper.prepareSourceFace(image);
+            if (source) {
+                // Frames started from here on use the new face
+                swapper.setSourceFace(source);
+                loaded = true;
+                double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                std::cout << "Source face prepared in " << static_cast<int>(ms) << " ms ("
+                          << source->faceRect.width << "x" << source->faceRect.height << ")" << std::endl;
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            preparing = false;
+        }
+        if (onResult) {
+            onResult(imagePath, loaded);
+        }
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef SOURCE_FACE_LOADER_HPP
+#define SOURCE_FACE_LOADER_HPP
+
+#include "AdvancedFaceSwapper.hpp"
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Loads source face images on a background thread and publishes them to
+// the swapper when ready, so decoding, detection and ArcFace never run on
+// the frame path. Output keeps flowing with the previous source face (or
+// unswapped) until the new one is swapped in.
+//
+// Only the newest request matters: a request made while another image is
+// being prepared replaces any request still waiting.
+class SourceFaceLoader {
+public:
+    // Runs on the loader thread once a request has finished
+    using ResultCallback = std::function<void(const std::string& imagePath, bool loaded)>;
+
+    explicit SourceFaceLoader(AdvancedFaceSwapper& swapper);
+    ~SourceFaceLoader();
+
+    void start(ResultCallback onResult = nullptr);
+    void stop();
+
+    // Queue an image file; returns immediately
+    void request(const std::string& imagePath);
+
+    // True while a request is waiting or being prepared
+    bool isBusy() const;
+
+private:
+    AdvancedFaceSwapper& swapper;
+    ResultCallback onResult;
+
+    std::thread worker;
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::string pendingPath;
+    bool preparing;
+    bool running;
+
+    void loaderLoop();
+};
+
+#endif // SOURCE_FACE_LOADER_HPP
@@ -0,0 +1,229 @@
+#include "StageProfiler.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+LatencyHistogram::LatencyHistogram()
+    : count(0)
+    , sumMicros(0)
+    , maxMicros(0)
+{
+    for (auto& bucket : buckets) {
+        bucket = 0;
+    }
+}
+
+int LatencyHistogram::bucketIndex(uint64_t micros) {
+    if (micros < 8) {
+        return static_cast<int>(micros);
+    }
+    int msb = 63 - __builtin_clzll(micros);
+    int sub = static_cast<int>((micros >> (msb - 3)) & 7);
+    return std::min((msb - 2) * 8 + sub, BUCKETS - 1);
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(int index) {
+    if (index < 8) {
+        return static_cast<uint64_t>(index);
+    }
+    int msb = index / 8 + 2;
+    uint64_t sub = static_cast<uint64_t>(index % 8);
+    return ((8 + sub + 1) << (msb - 3)) - 1;
+}
+
+void LatencyHistogram::record(uint64_t micros) {
+    buckets[bucketIndex(micros)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sumMicros.fetch_add(micros, std::memory_order_relaxed);
+
+    uint64_t seen = maxMicros.load(std::memory_order_relaxed);
+    while (micros > seen && !maxMicros.compare_exchange_weak(seen, micros, std::memory_order_relaxed)) {
+    }
+}
+
+LatencyHistogram::Summary LatencyHistogram::summarize(bool reset) {
+    std::array<uint64_t, BUCKETS> snapshot;
+    uint64_t n = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        snapshot[i] = reset ? buckets[i].exchange(0, std::memory_order_relaxed)
+                            : buckets[i].load(std::memory_order_relaxed);
+        n += snapshot[i];
+    }
+    uint64_t sum = reset ? sumMicros.exchange(0) : sumMicros.load();
+    uint64_t maximum = reset ? maxMicros.exchange(0) : maxMicros.load();
+    if (reset) {
+        count = 0;
+    }
+
+    Summary summary;
+    summary.count = n;
+    if (n == 0) {
+        return summary;
+    }
+    summary.meanMs = sum / 1000.0 / n;
+    summary.maxMs = maximum / 1000.0;
+
+    // Percentiles report the upper bound of the bucket they fall in
+    auto percentile = [&](double q) {
+        uint64_t rank = static_cast<uint64_t>(q * (n - 1)) + 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < BUCKETS; i++) {
+            seen += snapshot[i];
+            if (seen >= rank) {
+                return std::min(bucketUpperBound(i), maximum) / 1000.0;
+            }
+        }
+        return summary.maxMs;
+    };
+    summary.p50Ms = percentile(0.50);
+    summary.p95Ms = percentile(0.95);
+    summary.p99Ms = percentile(0.99);
+    return summary;
+}
+
+StageProfiler& StageProfiler::instance() {
+    static StageProfiler profiler;
+    return profiler;
+}
+
+StageProfiler::StageProfiler()
+    : enabled(false)
+    , qualityLevel(0)
+    , json(false)
+    , interval(std::chrono::seconds(5))
+    , runStart(std::chrono::steady_clock::now())
+    , windowStart(runStart)
+{
+}
+
+const char* StageProfiler::stageName(ProfileStage stage) {
+    switch (stage) {
+        case ProfileStage::Capture: return "capture";
+        case ProfileStage::Preprocess: return "preprocess";
+        case ProfileStage::Detect: return "detect";
+        case ProfileStage::Align: return "align";
+        case ProfileStage::Embed: return "embed";
+        case ProfileStage::Swap: return "swap";
+        case ProfileStage::Decode: return "decode";
+        case ProfileStage::Restore: return "restore";
+        case ProfileStage::Stabilize: return "stabilize";
+        case ProfileStage::Mask: return "mask";
+        case ProfileStage::Blend: return "blend";
+        case ProfileStage::Gui: return "gui";
+        case ProfileStage::GuiRender: return "gui_render";
+        case ProfileStage::VirtualCameraWrite: return "vcam_write";
+        case ProfileStage::Frame: return "frame";
+        default: return "unknown";
+    }
+}
+
+bool StageProfiler::open(const std::string& path, double intervalSeconds) {
+    std::lock_guard<std::mutex> lock(outputMutex);
+    output.open(path, std::ios::out | std::ios::trunc);
+    if (!output.is_open()) {
+        std::cerr << "Error: Could not open profile output: " << path << std::endl;
+        return false;
+    }
+
+    json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+    if (!json) {
+        output << "time_s,window_s,quality_level,stage,count,mean_ms,p50_ms,p95_ms,p99_ms,max_ms\n";
+    }
+    interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(std::max(0.1, intervalSeconds)));
+    runStart = windowStart = std::chrono::steady_clock::now();
+    enabled = true;
+    return true;
+}
+
+void StageProfiler::close() {
+    std::lock_guard<std::mutex> lock(outputMutex);
+    if (output.is_open()) {
+        writeWindow(std::chrono::steady_clock::now());
+        output.close();
+    }
+}
+
+void StageProfiler::record(ProfileStage stage, std::chrono::steady_clock::duration elapsed) {
+    size_t index = static_cast<size_t>(stage);
+    if (index >= STAGE_COUNT) {
+        return;
+    }
+    auto micros = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    uint64_t value = micros > 0 ? static_cast<uint64_t>(micros) : 0;
+    total[index].record(value);
+    window[index].record(value);
+}
+
+void StageProfiler::tick() {
+    if (!isEnabled()) {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (now - windowStart < interval) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(outputMutex);
+    if (output.is_open()) {
+        writeWindow(now);
+    }
+}
+
+void StageProfiler::writeWindow(std::chrono::steady_clock::time_point now) {
+    double timeS = std::chrono::duration<double>(now - runStart).count();
+    double windowS = std::chrono::duration<double>(now - windowStart).count();
+    int level = qualityLevel;
+    windowStart = now;
+
+    output << std::fixed << std::setprecision(3);
+    if (json) {
+        output << "{\"time_s\":" << timeS << ",\"window_s\":" << windowS
+               << ",\"quality_level\":" << level << ",\"stages\":{";
+    }
+
+    bool first = true;
+    for (size_t i = 0; i < STAGE_COUNT; i++) {
+        LatencyHistogram::Summary s = window[i].summarize(true);
+        if (s.count == 0) continue;
+
+        const char* name = stageName(static_cast<ProfileStage>(i));
+        if (json) {
+            output << (first ? "" : ",") << "\"" << name << "\":{\"count\":" << s.count
+                   << ",\"mean_ms\":" << s.meanMs << ",\"p50_ms\":" << s.p50Ms
+                   << ",\"p95_ms\":" << s.p95Ms << ",\"p99_ms\":" << s.p99Ms
+                   << ",\"max_ms\":" << s.maxMs << "}";
+        } else {
+            output << timeS << "," << windowS << "," << level << "," << name << "," << s.count
+                   << "," << s.meanMs << "," << s.p50Ms << "," << s.p95Ms << "," << s.p99Ms
+                   << "," << s.maxMs << "\n";
+        }
+        first = false;
+    }
+
+    if (json) {
+        output << "}}\n";
+    }
+    output.flush();
+}
+
+LatencyHistogram::Summary StageProfiler::getRunSummary(ProfileStage stage) {
+    size_t index = static_cast<size_t>(stage);
+    if (index >= STAGE_COUNT) {
+        return LatencyHistogram::Summary();
+    }
+    return total[index].summarize(false);
+}
+
+void StageProfiler::printSummary(std::ostream& os) {
+    os << "Stage latency (ms):" << std::endl;
+    os << "  stage          count      mean       p50       p95       p99       max" << std::endl;
+    for (size_t i = 0; i < STAGE_COUNT; i++) {
+        LatencyHistogram::Summary s = total[i].summarize(false);
+        if (s.count == 0) continue;
+
+        os << "  " << std::left << std::setw(12) << stageName(static_cast<ProfileStage>(i)) << std::right
+           << std::setw(8) << s.count << std::fixed << std::setprecision(2)
+           << std::setw(10) << s.meanMs << std::setw(10) << s.p50Ms << std::setw(10) << s.p95Ms
+           << std::setw(10) << s.p99Ms << std::setw(10) << s.maxMs << std::endl;
+    }
+}
@@ -0,0 +1,143 @@
+#ifndef STAGE_PROFILER_HPP
+#define STAGE_PROFILER_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include "AllocationTracker.hpp"
+#include "ProfileStage.hpp"
+#include "TraceRecorder.hpp"
+
+// Lock-free latency histogram.
+//
+// Log-linear microsecond buckets: exact below 8 us, then 8 buckets per power
+// of two (about 12% resolution) up to ~16.8 s; longer samples land in the
+// last bucket. record() is a handful of relaxed atomic adds, so it can be
+// called from any thread.
+class LatencyHistogram {
+public:
+    static const int BUCKETS = 176;     // last bucket ends at 2^24 us
+
+    struct Summary {
+        uint64_t count = 0;
+        double meanMs = 0.0;
+        double p50Ms = 0.0;
+        double p95Ms = 0.0;
+        double p99Ms = 0.0;
+        double maxMs = 0.0;
+    };
+
+    LatencyHistogram();
+
+    void record(uint64_t micros);
+
+    // Summary of everything recorded so far; with `reset` the histogram is
+    // cleared as it is read (samples racing with the reset may be lost)
+    Summary summarize(bool reset);
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKETS> buckets;
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sumMicros;
+    std::atomic<uint64_t> maxMicros;
+
+    static int bucketIndex(uint64_t micros);
+    static uint64_t bucketUpperBound(int index);
+};
+
+// Process-wide per-stage timing.
+//
+// Every stage feeds two histograms: one for the whole run (printed on exit)
+// and one for the current dump window. tick() writes the window to the
+// output file every `interval` seconds and starts a new one. The file is CSV
+// unless its name ends in ".json", in which case each window is one JSON
+// object per line.
+//
+// Disabled by default; a disabled profiler does not even read the clock.
+class StageProfiler {
+public:
+    static StageProfiler& instance();
+
+    void setEnabled(bool enable) { enabled = enable; }
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    // Start writing windows to `path` (enables the profiler)
+    bool open(const std::string& path, double intervalSeconds);
+    void close();
+
+    void record(ProfileStage stage, std::chrono::steady_clock::duration elapsed);
+
+    // Tagged onto every window, e.g. the quality governor level
+    void setQualityLevel(int level) { qualityLevel = level; }
+
+    // Dump the current window if it is due. Call from one thread.
+    void tick();
+
+    // p50/p95/p99/max over the whole run
+    void printSummary(std::ostream& os);
+    LatencyHistogram::Summary getRunSummary(ProfileStage stage);
+
+    static const char* stageName(ProfileStage stage);
+
+private:
+    StageProfiler();
+    StageProfiler(const StageProfiler&) = delete;
+    StageProfiler& operator=(const StageProfiler&) = delete;
+
+    static const size_t STAGE_COUNT = static_cast<size_t>(ProfileStage::Count);
+
+    std::atomic<bool> enabled;
+    std::atomic<int> qualityLevel;
+    std::array<LatencyHistogram, STAGE_COUNT> total;
+    std::array<LatencyHistogram, STAGE_COUNT> window;
+
+    std::mutex outputMutex;
+    std::ofstream output;
+    bool json;
+    std::chrono::steady_clock::duration interval;
+    std::chrono::steady_clock::time_point runStart;
+    std::chrono::steady_clock::time_point windowStart;
+
+    void writeWindow(std::chrono::steady_clock::time_point now);
+};
+
+// Records the lifetime of the scope under `stage` with the profiler and,
+// when tracing, as a span
+class ScopedProfile {
+public:
+    explicit ScopedProfile(ProfileStage stage)
+        : stage(stage)
+        , active(StageProfiler::instance().isEnabled() || TraceRecorder::instance().isEnabled())
+        , allocationStage(stage)
+    {
+        if (active) {
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~ScopedProfile() {
+        if (active) {
+            auto end = std::chrono::steady_clock::now();
+            if (StageProfiler::instance().isEnabled()) {
+                StageProfiler::instance().record(stage, end - start);
+            }
+            TraceRecorder::instance().record(StageProfiler::stageName(stage), start, end);
+        }
+    }
+
+    ScopedProfile(const ScopedProfile&) = delete;
+    ScopedProfile& operator=(const ScopedProfile&) = delete;
+
+private:
+    ProfileStage stage;
+    bool active;
+    AllocationStage allocationStage;
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif // STAGE_PROFILER_HPP
@@ -0,0 +1,301 @@
+#include "StreamServer.hpp"
+#include "TraceRecorder.hpp"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+// Camera index from "2" or "/dev/video2", -1 for anything else
+int cameraIndex(const std::string& input) {
+    const std::string prefix = "/dev/video";
+    std::string digits = input.compare(0, prefix.size(), prefix) == 0 ? input.substr(prefix.size()) : input;
+    if (digits.empty() || !std::all_of(digits.begin(), digits.end(), [](unsigned char c) { return std::isdigit(c); })) {
+        return -1;
+    }
+    return std::stoi(digits);
+}
+
+// Whole-field number parsing, so "weight=2x" or "fps=15fps" are rejected
+int parseInt(const std::string& text) {
+    size_t used = 0;
+    int value = std::stoi(text, &used);
+    if (used != text.size()) {
+        throw std::invalid_argument(text);
+    }
+    return value;
+}
+
+double parseDouble(const std::string& text) {
+    size_t used = 0;
+    double value = std::stod(text, &used);
+    if (used != text.size() || !std::isfinite(value)) {
+        throw std::invalid_argument(text);
+    }
+    return value;
+}
+}
+
+bool StreamConfig::parse(const std::string& spec, StreamConfig& config) {
+    config = StreamConfig();
+    std::stringstream ss(spec);
+    std::string field;
+    int position = 0;
+    while (std::getline(ss, field, ',')) {
+        try {
+            if (field.compare(0, 7, "weight=") == 0) {
+                config.weight = parseInt(field.substr(7));
+            } else if (field.compare(0, 4, "fps=") == 0) {
+                config.maxFps = parseDouble(field.substr(4));
+            } else if (position == 0) {
+                config.input = field;
+                position++;
+            } else if (position == 1) {
+                config.output = field == "none" ? std::string() : field;
+                position++;
+            } else {
+                std::cerr << "Error: Unexpected field in stream spec: " << field << std::endl;
+                return false;
+            }
+        } catch (const std::exception&) {
+            std::cerr << "Error: Invalid number in stream spec: " << field << std::endl;
+            return false;
+        }
+    }
+    if (config.input.empty() || config.weight < 1 || config.maxFps < 0.0) {
+        std::cerr << "Error: Invalid stream spec: " << spec << std::endl;
+        return false;
+    }
+    return true;
+}
+
+StreamServer::StreamServer(AdvancedFaceSwapper& prototype, InferenceScheduler& scheduler)
+    : prototype(prototype)
+    , scheduler(scheduler)
+    , stopping(false)
+    , wallSeconds(0.0)
+{
+}
+
+StreamServer::~StreamServer() {
+    stopping = true;
+    for (auto& stream : streams) {
+        if (stream->thread.joinable()) {
+            stream->thread.join();
+        }
+    }
+}
+
+bool StreamServer::addStream(const StreamConfig& config) {
+    auto stream = std::make_unique<Stream>();
+    stream->config = config;
+    stream->name = "stream" + std::to_string(streams.size());
+
+    int camera = cameraIndex(config.input);
+    bool opened = camera >= 0 ? stream->source.openCamera(camera, 640, 480)
+                              : stream->source.openFile(config.input, true);
+    if (!opened) {
+        return false;
+    }
+    if (!config.output.empty()
+        && !stream->output.initialize(config.output, stream->source.getWidth(), stream->source.getHeight())) {
+        std::cerr << "Error: Could not open output for " << stream->name << ": " << config.output << std::endl;
+        return false;
+    }
+
+    // Own detector and temporal state on the prototype's engine: shared
+    // networks (through the scheduler) and source faces
+    if (!prototype.getEngine()->hasDetector()) {
+        std::cerr << "Error: No face detection model for " << stream->name << std::endl;
+        return false;
+    }
+    stream->schedulerStream = scheduler.addStream(stream->name, config.weight);
+    stream->swapper = std::make_unique<AdvancedFaceSwapper>(prototype.getEngine(), stream->schedulerStream);
+    stream->swapper->setBlendStrength(prototype.getBlendStrength());
+    stream->swapper->setEnableGFPGAN(prototype.getEnableGFPGAN());
+    stream->swapper->setTemporalStabilization(prototype.getTemporalStabilization());
+
+    // Model calls block the thread that makes them, so a stream only has as
+    // many requests queued as it has faces in flight. Enough face workers
+    // for `weight` of them let the weight decide its share of each round.
+    int faceWorkers = std::max(prototype.getFaceWorkerCount(), config.weight);
+    if (faceWorkers > 1 && !stream->swapper->setFaceWorkers(faceWorkers)) {
+        std::cerr << "Warning: Could not create face workers for " << stream->name
+                  << ", its weight has no effect." << std::endl;
+    }
+
+    std::cout << "Stream " << stream->name << ": " << stream->source.describe() << " -> "
+              << (config.output.empty() ? std::string("(no output)") : config.output)
+              << " (weight " << config.weight;
+    if (config.maxFps > 0.0) {
+        std::cout << ", max " << config.maxFps << " FPS";
+    }
+    std::cout << ")" << std::endl;
+    streams.push_back(std::move(stream));
+    return true;
+}
+
+bool StreamServer::run(const std::function<bool()>& shouldStop, double reportSeconds) {
+    if (streams.empty()) {
+        std::cerr << "Error: No streams to run" << std::endl;
+        return false;
+    }
+
+    stopping = false;
+    for (auto& stream : streams) {
+        stream->thread = std::thread(&StreamServer::streamLoop, this, std::ref(*stream));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto lastReport = start;
+    std::vector<Snapshot> previous(streams.size());
+    while (!(shouldStop && shouldStop())) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        bool allFinished = std::all_of(streams.begin(), streams.end(),
+                                       [](const std::unique_ptr<Stream>& stream) { return stream->finished.load(); });
+        if (allFinished) {
+            break;
+        }
+        auto now = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(now - lastReport).count();
+        if (reportSeconds > 0.0 && elapsed >= reportSeconds) {
+            printReport(std::cout, previous, elapsed);
+            lastReport = now;
+        }
+    }
+
+    stopping = true;
+    for (auto& stream : streams) {
+        stream->thread.join();
+        stream->output.release();
+        stream->source.release();
+    }
+    wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+void StreamServer::streamLoop(Stream& stream) {
+    TraceRecorder::setThreadName(stream.name);
+    AdvancedFaceSwapper& swapper = *stream.swapper;
+
+    const auto frameInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(stream.config.maxFps > 0.0 ? 1.0 / stream.config.maxFps : 0.0));
+    auto nextFrame = std::chrono::steady_clock::now();
+
+    cv::Mat frame;
+    while (!stopping) {
+        if (!stream.source.read(frame) || frame.empty()) {
+            if (!stream.source.isFile()) {
+                std::cerr << "Error: Capture failed on " << stream.name << std::endl;
+            }
+            break;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        swapper.detectAndSwap(frame);
+        double processMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        bool written = !stream.output.isReady() || stream.output.writeFrame(frame);
+
+        // Fairness: a capped stream leaves the cores and the inference thread
+        // to the others instead of running ahead of its target rate
+        double throttledMs = 0.0;
+        if (stream.config.maxFps > 0.0) {
+            nextFrame += frameInterval;
+            auto now = std::chrono::steady_clock::now();
+            if (nextFrame > now) {
+                std::this_thread::sleep_until(nextFrame);
+                throttledMs = std::chrono::duration<double, std::milli>(nextFrame - now).count();
+            } else {
+                nextFrame = now;
+            }
+        }
+
+        const FrameTimings& timings = swapper.getLastFrameTimings();
+        std::lock_guard<std::mutex> lock(stream.statsMutex);
+        StreamStats& stats = stream.stats;
+        stats.frames++;
+        stats.faces += swapper.getFaceCount();
+        stats.modelSwaps += timings.modelSwaps;
+        stats.fallbackSwaps += timings.fallbackSwaps;
+        stats.outputFailures += written ? 0 : 1;
+        stats.processMs += processMs;
+        stats.maxProcessMs = std::max(stats.maxProcessMs, processMs);
+        stats.throttledMs += throttledMs;
+        stream.windowMaxMs = std::max(stream.windowMaxMs, processMs);
+    }
+    stream.finished = true;
+}
+
+StreamServer::StreamStats StreamServer::getStreamStats(size_t stream) const {
+    if (stream >= streams.size()) {
+        return StreamStats();
+    }
+    std::lock_guard<std::mutex> lock(streams[stream]->statsMutex);
+    return streams[stream]->stats;
+}
+
+void StreamServer::printReport(std::ostream& os, std::vector<Snapshot>& previous, double seconds) {
+    os << std::fixed << std::setprecision(1);
+    os << "Streams (last " << seconds << " s):" << std::endl;
+    for (size_t i = 0; i < streams.size(); i++) {
+        Stream& stream = *streams[i];
+        Snapshot current;
+        double windowMaxMs;
+        {
+            std::lock_guard<std::mutex> lock(stream.statsMutex);
+            current.stream = stream.stats;
+            windowMaxMs = stream.windowMaxMs;
+            stream.windowMaxMs = 0.0;
+        }
+        current.inference = scheduler.getStreamStats(stream.schedulerStream);
+
+        const Snapshot& last = previous[i];
+        uint64_t frames = current.stream.frames - last.stream.frames;
+        uint64_t requests = (current.inference.swaps + current.inference.embeds)
+                          - (last.inference.swaps + last.inference.embeds);
+        uint64_t shared = current.inference.batched - last.inference.batched;
+        double waitMs = current.inference.waitMs - last.inference.waitMs;
+
+        os << "  " << std::left << std::setw(9) << stream.name << std::right
+           << std::setw(6) << frames / seconds << " FPS  "
+           << std::setw(6) << (frames > 0 ? (current.stream.processMs - last.stream.processMs) / frames : 0.0)
+           << " ms avg  " << std::setw(6) << windowMaxMs << " ms max  "
+           << std::setprecision(2) << (frames > 0 ? static_cast<double>(current.stream.faces - last.stream.faces) / frames : 0.0)
+           << " faces  inference wait " << (requests > 0 ? waitMs / requests : 0.0) << " ms"
+           << std::setprecision(1) << "  shared " << (requests > 0 ? 100.0 * shared / requests : 0.0) << "%";
+        if (current.stream.outputFailures > last.stream.outputFailures) {
+            os << "  " << current.stream.outputFailures - last.stream.outputFailures << " output failures";
+        }
+        if (stream.finished) {
+            os << "  (ended)";
+        }
+        os << std::endl;
+        previous[i] = current;
+    }
+}
+
+void StreamServer::printSummary(std::ostream& os) const {
+    os << std::fixed << std::setprecision(1);
+    os << "Streams: " << streams.size() << " in " << wallSeconds << " s" << std::endl;
+    for (size_t i = 0; i < streams.size(); i++) {
+        StreamStats stats = getStreamStats(i);
+        const Stream& stream = *streams[i];
+        os << "  " << std::left << std::setw(9) << stream.name << std::right << std::setw(8) << stats.frames
+           << " frames, " << std::setw(6) << (wallSeconds > 0.0 ? stats.frames / wallSeconds : 0.0) << " FPS, "
+           << std::setw(6) << (stats.frames > 0 ? stats.processMs / stats.frames : 0.0) << " ms avg / "
+           << stats.maxProcessMs << " ms max, " << stats.modelSwaps << " model + " << stats.fallbackSwaps
+           << " geometric swaps";
+        if (stats.throttledMs > 0.0) {
+            os << ", " << stats.throttledMs / 1000.0 << " s throttled";
+        }
+        if (stats.outputFailures > 0) {
+            os << ", " << stats.outputFailures << " output failures";
+        }
+        os << std::endl;
+    }
+}
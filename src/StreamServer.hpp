@@ -0,0 +1,98 @@
+#ifndef STREAM_SERVER_HPP
+#define STREAM_SERVER_HPP
+
+#include "AdvancedFaceSwapper.hpp"
+#include "FrameSource.hpp"
+#include "InferenceScheduler.hpp"
+#include "VirtualCamera.hpp"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct StreamConfig {
+    std::string input;          // camera index, /dev/videoN or a video file
+    std::string output;         // virtual camera device ("" = process only)
+    int weight = 1;             // requests per round in each inference batch; also the
+                                // least number of face workers, so that many can be queued
+    double maxFps = 0.0;        // frame rate cap (0 = as fast as the input delivers)
+
+    // "<input>[,<output>][,weight=<n>][,fps=<n>]"
+    static bool parse(const std::string& spec, StreamConfig& config);
+};
+
+// Several camera-to-virtual-camera streams in one process.
+//
+// Every stream runs on its own thread with its own swapper: detector, face
+// tracks and stabilization history. The swappers share the prototype's
+// FaceSwapEngine, so a source face published there (upload, face directory)
+// is picked up by every stream at its next frame. ArcFace and INSwapper are
+// loaded once, in the InferenceScheduler set on the engine, which runs the
+// model calls of all streams and batches the ones that arrive together.
+class StreamServer {
+public:
+    struct StreamStats {
+        uint64_t frames = 0;
+        uint64_t faces = 0;
+        uint64_t modelSwaps = 0;
+        uint64_t fallbackSwaps = 0;
+        uint64_t outputFailures = 0;
+        double processMs = 0.0;     // detectAndSwap(), summed
+        double maxProcessMs = 0.0;
+        double throttledMs = 0.0;   // slept to stay under maxFps
+    };
+
+    StreamServer(AdvancedFaceSwapper& prototype, InferenceScheduler& scheduler);
+    ~StreamServer();
+
+    // Open the input and output and create the stream's swapper
+    bool addStream(const StreamConfig& config);
+    size_t getStreamCount() const { return streams.size(); }
+
+    // Run every stream until all inputs end or `shouldStop` returns true.
+    // Prints per-stream rates every `reportSeconds` (0 = only at the end).
+    bool run(const std::function<bool()>& shouldStop, double reportSeconds = 5.0);
+
+    StreamStats getStreamStats(size_t stream) const;
+
+    // Totals per stream over the whole run
+    void printSummary(std::ostream& os) const;
+
+private:
+    struct Stream {
+        StreamConfig config;
+        std::string name;
+        int schedulerStream = -1;
+        FrameSource source;
+        VirtualCamera output;
+        std::unique_ptr<AdvancedFaceSwapper> swapper;
+        std::thread thread;
+        std::atomic<bool> finished{false};
+
+        mutable std::mutex statsMutex;
+        StreamStats stats;
+        double windowMaxMs = 0.0;   // reset by each report
+    };
+
+    // Counters at the previous report, for per-window rates
+    struct Snapshot {
+        StreamStats stream;
+        InferenceScheduler::StreamStats inference;
+    };
+
+    AdvancedFaceSwapper& prototype;
+    InferenceScheduler& scheduler;
+    std::vector<std::unique_ptr<Stream>> streams;
+    std::atomic<bool> stopping;
+    double wallSeconds;
+
+    void streamLoop(Stream& stream);
+    void printReport(std::ostream& os, std::vector<Snapshot>& previous, double seconds);
+};
+
+#endif // STREAM_SERVER_HPP
@@ -0,0 +1,286 @@
+#include "ThreadBudget.hpp"
+#include <opencv2/core.hpp>
+#include <opencv2/core/utility.hpp>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+namespace {
+ThreadBudget g_activeBudget;
+
+std::string trim(const std::string& s) {
+    size_t start = s.find_first_not_of(" \t\r\n");
+    if (start == std::string::npos) return "";
+    size_t end = s.find_last_not_of(" \t\r\n");
+    return s.substr(start, end - start + 1);
+}
+
+// std::stoi that also rejects trailing characters ("4x", "3-6abc")
+int parseInt(const std::string& text) {
+    size_t used = 0;
+    int value = std::stoi(text, &used);
+    if (used != text.size()) {
+        throw std::invalid_argument(text);
+    }
+    return value;
+}
+
+bool stageFromName(const std::string& name, PipelineStage& stage) {
+    if (name == "capture") stage = PipelineStage::Capture;
+    else if (name == "detection" || name == "detect") stage = PipelineStage::Detection;
+    else if (name == "swap" || name == "inference") stage = PipelineStage::SwapInference;
+    else if (name == "restore" || name == "restoration") stage = PipelineStage::Restoration;
+    else if (name == "composite" || name == "compositing") stage = PipelineStage::Compositing;
+    else if (name == "output") stage = PipelineStage::Output;
+    else return false;
+    return true;
+}
+}
+
+ThreadBudget::ThreadBudget() : configured(false) {
+    // Inference stages default to "let OpenCV decide", everything else is a single thread
+    stages[static_cast<int>(PipelineStage::Detection)].threads = 0;
+    stages[static_cast<int>(PipelineStage::SwapInference)].threads = 0;
+    stages[static_cast<int>(PipelineStage::Restoration)].threads = 0;
+}
+
+const char* ThreadBudget::stageName(PipelineStage stage) {
+    switch (stage) {
+        case PipelineStage::Capture: return "capture";
+        case PipelineStage::Detection: return "detection";
+        case PipelineStage::SwapInference: return "swap";
+        case PipelineStage::Restoration: return "restore";
+        case PipelineStage::Compositing: return "composite";
+        case PipelineStage::Output: return "output";
+        default: return "unknown";
+    }
+}
+
+const ThreadBudget& ThreadBudget::active() {
+    return g_activeBudget;
+}
+
+void ThreadBudget::setStage(PipelineStage stage, int threads, const std::vector<int>& cpus) {
+    StageThreadConfig& cfg = stages[static_cast<int>(stage)];
+    cfg.threads = std::max(0, threads);
+    cfg.cpus = cpus;
+    configured = true;
+}
+
+const StageThreadConfig& ThreadBudget::getStage(PipelineStage stage) const {
+    return stages[static_cast<int>(stage)];
+}
+
+bool ThreadBudget::parseCpuList(const std::string& text, std::vector<int>& cpus) {
+    std::stringstream ss(text);
+    std::string range;
+    long cpuCount = sysconf(_SC_NPROCESSORS_CONF);
+
+    while (std::getline(ss, range, '+')) {
+        range = trim(range);
+        if (range.empty()) continue;
+
+        size_t dash = range.find('-');
+        int first = 0, last = 0;
+        try {
+            if (dash == std::string::npos) {
+                first = last = parseInt(range);
+            } else {
+                first = parseInt(trim(range.substr(0, dash)));
+                last = parseInt(trim(range.substr(dash + 1)));
+            }
+        } catch (const std::exception&) {
+            std::cerr << "Error: Invalid CPU range '" << range << "'" << std::endl;
+            return false;
+        }
+
+        if (first < 0 || last < first || (cpuCount > 0 && last >= cpuCount)) {
+            std::cerr << "Error: CPU range '" << range << "' outside 0-" << (cpuCount - 1) << std::endl;
+            return false;
+        }
+        for (int cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return true;
+}
+
+bool ThreadBudget::parseEntry(const std::string& rawEntry) {
+    std::string entry = trim(rawEntry);
+    if (entry.empty()) return true;
+
+    size_t eq = entry.find('=');
+    if (eq == std::string::npos) {
+        std::cerr << "Error: Thread budget entry '" << entry << "' must be stage=threads[@cpus]" << std::endl;
+        return false;
+    }
+
+    std::string name = trim(entry.substr(0, eq));
+    std::string value = trim(entry.substr(eq + 1));
+
+    PipelineStage stage;
+    if (!stageFromName(name, stage)) {
+        std::cerr << "Error: Unknown pipeline stage '" << name << "'" << std::endl;
+        return false;
+    }
+
+    std::string threadsText = value;
+    std::vector<int> cpus;
+    size_t at = value.find('@');
+    if (at != std::string::npos) {
+        threadsText = value.substr(0, at);
+        if (!parseCpuList(value.substr(at + 1), cpus)) {
+            return false;
+        }
+    }
+
+    int threads = 0;
+    try {
+        threads = parseInt(trim(threadsText));
+    } catch (const std::exception&) {
+        threads = -1;
+    }
+    if (threads < 0) {
+        std::cerr << "Error: Invalid thread count '" << threadsText << "' for stage " << name << std::endl;
+        return false;
+    }
+
+    setStage(stage, threads, cpus);
+    return true;
+}
+
+bool ThreadBudget::parseSpec(const std::string& spec) {
+    std::stringstream ss(spec);
+    std::string entry;
+    while (std::getline(ss, entry, ',')) {
+        if (!parseEntry(entry)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ThreadBudget::loadFromFile(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open thread budget file: " << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) {
+            line = line.substr(0, comment);
+        }
+        if (!parseEntry(line)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int ThreadBudget::getOpenCVThreads() const {
+    int threads = 0;
+    for (PipelineStage stage : {PipelineStage::Detection, PipelineStage::SwapInference,
+                                PipelineStage::Restoration, PipelineStage::Compositing}) {
+        threads = std::max(threads, getStage(stage).threads);
+    }
+    return threads;
+}
+
+bool ThreadBudget::setCurrentThreadAffinity(const std::vector<int>& cpus) {
+    if (cpus.empty()) {
+        return true;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        CPU_SET(cpu, &set);
+    }
+
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (rc != 0) {
+        std::cerr << "Warning: Could not set thread affinity (error " << rc << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool ThreadBudget::applyToCurrentThread(PipelineStage stage) const {
+    return setCurrentThreadAffinity(getStage(stage).cpus);
+}
+
+void ThreadBudget::apply() const {
+    g_activeBudget = *this;
+
+    if (!configured) {
+        return;
+    }
+
+    // OpenCV's workers are spawned lazily from whichever thread first runs a
+    // parallel region and inherit its mask, so widen the caller to every
+    // stage that uses the pool before (re)creating it.
+    std::vector<int> poolCpus;
+    std::vector<int> allCpus;
+    for (int i = 0; i < static_cast<int>(PipelineStage::Count); i++) {
+        PipelineStage stage = static_cast<PipelineStage>(i);
+        const std::vector<int>& cpus = stages[i].cpus;
+        allCpus.insert(allCpus.end(), cpus.begin(), cpus.end());
+        if (stage != PipelineStage::Capture && stage != PipelineStage::Output) {
+            poolCpus.insert(poolCpus.end(), cpus.begin(), cpus.end());
+        }
+    }
+    for (std::vector<int>* cpus : {&poolCpus, &allCpus}) {
+        std::sort(cpus->begin(), cpus->end());
+        cpus->erase(std::unique(cpus->begin(), cpus->end()), cpus->end());
+    }
+    setCurrentThreadAffinity(poolCpus);
+
+    int poolThreads = getOpenCVThreads();
+    if (poolThreads > 0) {
+        cv::setNumThreads(poolThreads);
+
+        // Force the pool to spin up now, while the wide mask is in effect
+        cv::parallel_for_(cv::Range(0, poolThreads), [](const cv::Range&) {});
+    }
+
+    setCurrentThreadAffinity(allCpus);
+}
+
+void ThreadBudget::print(std::ostream& os) const {
+    os << "Thread budget (OpenCV pool: ";
+    int poolThreads = getOpenCVThreads();
+    if (poolThreads > 0) {
+        os << poolThreads;
+    } else {
+        os << "default";
+    }
+    os << " threads)" << std::endl;
+
+    for (int i = 0; i < static_cast<int>(PipelineStage::Count); i++) {
+        const StageThreadConfig& cfg = stages[i];
+        os << "  " << stageName(static_cast<PipelineStage>(i)) << ": ";
+        if (cfg.threads > 0) {
+            os << cfg.threads << " thread(s)";
+        } else {
+            os << "auto";
+        }
+        if (!cfg.cpus.empty()) {
+            os << " on CPUs";
+            for (int cpu : cfg.cpus) {
+                os << " " << cpu;
+            }
+        }
+        os << std::endl;
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef THREAD_BUDGET_HPP
+#define THREAD_BUDGET_HPP
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+// Pipeline stages that own CPU time. Each stage gets a thread count and an
+// optional set of CPUs it may run on.
+enum class PipelineStage {
+    Capture = 0,
+    Detection,
+    SwapInference,
+    Restoration,
+    Compositing,
+    Output,
+    Count
+};
+
+struct StageThreadConfig {
+    int threads = 1;            // 0 = let OpenCV decide
+    std::vector<int> cpus;      // empty = no affinity restriction
+};
+
+// Per-stage CPU thread budget and core affinity.
+//
+// OpenCV has a single global worker pool (used by cv::dnn and parallel_for_),
+// so it is sized to the largest inference stage budget. Pool workers inherit
+// the affinity of the thread that spawns them, so apply() pins the calling
+// thread to the union of the inference stage CPUs, warms the pool up and then
+// leaves the caller on the union of all stage CPUs (the main loop runs every
+// stage when nothing else is threaded). Threads we create ourselves call
+// applyToCurrentThread() with their stage when they start.
+//
+// Spec format (comma separated, CPU ranges joined with '+'):
+//   capture=1@0,detection=2@1-2,swap=4@3-6,restore=1@3-6,composite=1@7,output=1@7
+class ThreadBudget {
+public:
+    ThreadBudget();
+
+    // Parse "stage=threads[@cpus]" entries. Returns false on malformed input.
+    bool parseSpec(const std::string& spec);
+
+    // Load one "stage=threads[@cpus]" entry per line ('#' starts a comment)
+    bool loadFromFile(const std::string& path);
+
+    void setStage(PipelineStage stage, int threads, const std::vector<int>& cpus = {});
+    const StageThreadConfig& getStage(PipelineStage stage) const;
+
+    // Size of OpenCV's global pool (max over detection/swap/restoration/compositing)
+    int getOpenCVThreads() const;
+
+    // True if any stage has an explicit thread count or affinity
+    bool isConfigured() const { return configured; }
+
+    // Configure OpenCV's pool and pin the calling thread to the instance's CPUs.
+    // Also makes this budget the one returned by active().
+    void apply() const;
+
+    // Pin the calling thread to the CPUs of `stage` (no-op without affinity)
+    bool applyToCurrentThread(PipelineStage stage) const;
+
+    void print(std::ostream& os) const;
+
+    static const char* stageName(PipelineStage stage);
+
+    // Budget most recently applied in this process (defaults if none)
+    static const ThreadBudget& active();
+
+private:
+    StageThreadConfig stages[static_cast<int>(PipelineStage::Count)];
+    bool configured;
+
+    bool parseEntry(const std::string& entry);
+    static bool parseCpuList(const std::string& text, std::vector<int>& cpus);
+    static bool setCurrentThreadAffinity(const std::vector<int>& cpus);
+};
+
+#endif // THREAD_BUDGET_HPP
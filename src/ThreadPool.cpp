@@ -0,0 +1,86 @@
+#include "ThreadPool.hpp"
+#include "Logger.hpp"
+#include "TraceRecorder.hpp"
+#include <string>
+
+ThreadPool::ThreadPool(size_t threads, PipelineStage stage)
+    : stage(stage)
+    , task(nullptr)
+    , taskCount(0)
+    , nextIndex(0)
+    , activeWorkers(0)
+    , generation(0)
+    , stopping(false)
+{
+    if (threads == 0) {
+        threads = 1;
+    }
+    for (size_t i = 0; i < threads; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (auto& worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t, size_t)>& fn) {
+    if (count == 0) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    task = &fn;
+    taskCount = count;
+    nextIndex = 0;
+    activeWorkers = workers.size();
+    generation++;
+    workAvailable.notify_all();
+
+    workDone.wait(lock, [this] { return activeWorkers == 0; });
+    task = nullptr;
+}
+
+void ThreadPool::workerLoop(size_t worker) {
+    ThreadBudget::active().applyToCurrentThread(stage);
+    TraceRecorder::setThreadName("face-worker-" + std::to_string(worker));
+
+    uint64_t seenGeneration = 0;
+    while (true) {
+        const std::function<void(size_t, size_t)>* batch = nullptr;
+        size_t count = 0;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            workAvailable.wait(lock, [this, seenGeneration] { return stopping || generation != seenGeneration; });
+            if (stopping) {
+                return;
+            }
+            seenGeneration = generation;
+            batch = task;
+            count = taskCount;
+        }
+
+        // Claim indices until the batch is exhausted
+        for (size_t index = nextIndex++; index < count; index = nextIndex++) {
+            try {
+                (*batch)(index, worker);
+            } catch (const std::exception& e) {
+                LOG_ERROR("Exception in worker " << worker << ": " << e.what());
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--activeWorkers == 0) {
+            workDone.notify_one();
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include "ThreadBudget.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for fork/join work inside a frame.
+// Every worker has a stable index, so callers can keep per-worker state
+// (e.g. a cv::dnn::Net, which is not thread-safe) in a plain vector.
+class ThreadPool {
+public:
+    // Workers pin themselves to `stage` in the active ThreadBudget
+    explicit ThreadPool(size_t threads, PipelineStage stage = PipelineStage::SwapInference);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return workers.size(); }
+
+    // Run fn(index, worker) for every index in [0, count) and wait for all of
+    // them. `worker` is in [0, size()). Not reentrant: one batch at a time.
+    void parallelFor(size_t count, const std::function<void(size_t, size_t)>& fn);
+
+private:
+    std::vector<std::thread> workers;
+    PipelineStage stage;
+
+    std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::condition_variable workDone;
+
+    // Current batch
+    const std::function<void(size_t, size_t)>* task;
+    size_t taskCount;
+    std::atomic<size_t> nextIndex;
+    size_t activeWorkers;
+    uint64_t generation;
+    bool stopping;
+
+    void workerLoop(size_t worker);
+};
+
+#endif // THREAD_POOL_HPP
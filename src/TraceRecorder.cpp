@@ -0,0 +1,182 @@
+#include "TraceRecorder.hpp"
+#include <unistd.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+namespace {
+thread_local uint64_t tlsFrame = 0;
+thread_local int tlsTrack = -1;
+std::atomic<uint32_t> nextThreadId(1);
+
+// Copy of one ring slot taken by stop()
+struct Snapshot {
+    const char* name;
+    uint64_t frame;
+    int32_t track;
+    uint32_t thread;
+    int64_t startUs;
+    int64_t durationUs;
+};
+
+// Stage names and thread names are plain identifiers, but escape anyway
+void writeJsonString(std::ostream& out, const std::string& text) {
+    out << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out << ' ';
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+}
+
+TraceRecorder& TraceRecorder::instance() {
+    static TraceRecorder recorder;
+    return recorder;
+}
+
+TraceRecorder::TraceRecorder()
+    : enabled(false)
+    , mask(0)
+    , nextSlot(0)
+{
+}
+
+uint32_t TraceRecorder::currentThreadId() {
+    thread_local uint32_t id = nextThreadId.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+void TraceRecorder::setThreadName(const std::string& name) {
+    TraceRecorder& recorder = instance();
+    uint32_t id = currentThreadId();
+    std::lock_guard<std::mutex> lock(recorder.threadNamesMutex);
+    for (auto& entry : recorder.threadNames) {
+        if (entry.first == id) {
+            entry.second = name;
+            return;
+        }
+    }
+    recorder.threadNames.emplace_back(id, name);
+}
+
+void TraceRecorder::setThreadFrame(uint64_t frame) { tlsFrame = frame; }
+uint64_t TraceRecorder::getThreadFrame() { return tlsFrame; }
+void TraceRecorder::setThreadTrack(int track) { tlsTrack = track; }
+int TraceRecorder::getThreadTrack() { return tlsTrack; }
+
+bool TraceRecorder::start(const std::string& tracePath, size_t capacity) {
+    if (enabled) {
+        return true;
+    }
+
+    // A thread that saw isEnabled() just before stop() may still be writing
+    // into the buffer, so it is never freed or reused for a second session
+    if (events) {
+        std::cerr << "Error: Tracing can only be started once per run" << std::endl;
+        return false;
+    }
+
+    // Fail now rather than after a long session
+    std::ofstream probe(tracePath);
+    if (!probe.is_open()) {
+        std::cerr << "Error: Could not create trace file: " << tracePath << std::endl;
+        return false;
+    }
+
+    size_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    events.reset(new Event[size]);
+    mask = size - 1;
+    nextSlot = 0;
+    path = tracePath;
+    epoch = std::chrono::steady_clock::now();
+    enabled = true;
+    return true;
+}
+
+void TraceRecorder::record(const char* name, std::chrono::steady_clock::time_point start,
+                           std::chrono::steady_clock::time_point end) {
+    if (!isEnabled()) {
+        return;
+    }
+
+    uint64_t slot = nextSlot.fetch_add(1, std::memory_order_relaxed);
+    Event& event = events[slot & mask];
+    event.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    event.name = name;
+    event.frame = tlsFrame;
+    event.track = tlsTrack;
+    event.thread = currentThreadId();
+    event.startUs = std::chrono::duration_cast<std::chrono::microseconds>(start - epoch).count();
+    event.durationUs = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    event.sequence.store(slot + 1, std::memory_order_release);
+}
+
+void TraceRecorder::stop() {
+    if (!enabled.exchange(false)) {
+        return;
+    }
+
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not write trace file: " << path << std::endl;
+        return;
+    }
+
+    // Oldest surviving span first. Recorders that passed isEnabled() before
+    // the exchange above can still be writing, so each slot is read as a
+    // seqlock: copy it, then drop it if its sequence changed meanwhile
+    uint64_t end = nextSlot.load();
+    uint64_t size = mask + 1;
+    uint64_t begin = end > size ? end - size : 0;
+    int pid = static_cast<int>(getpid());
+    size_t written = 0;
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    {
+        std::lock_guard<std::mutex> lock(threadNamesMutex);
+        for (const auto& entry : threadNames) {
+            out << (written++ ? ",\n" : "") << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << pid
+                << ",\"tid\":" << entry.first << ",\"args\":{\"name\":";
+            writeJsonString(out, entry.second);
+            out << "}}";
+        }
+    }
+    for (uint64_t slot = begin; slot < end; slot++) {
+        const Event& shared = events[slot & mask];
+        if (shared.sequence.load(std::memory_order_acquire) != slot + 1) {
+            continue;
+        }
+        Snapshot event{shared.name, shared.frame, shared.track, shared.thread,
+                       shared.startUs, shared.durationUs};
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (shared.sequence.load(std::memory_order_relaxed) != slot + 1) {
+            continue;
+        }
+        out << (written++ ? ",\n" : "") << "{\"ph\":\"X\",\"cat\":\"stage\",\"name\":\"" << event.name
+            << "\",\"pid\":" << pid << ",\"tid\":" << event.thread
+            << ",\"ts\":" << event.startUs << ",\"dur\":" << std::max<int64_t>(event.durationUs, 0)
+            << ",\"args\":{\"frame\":" << event.frame;
+        if (event.track >= 0) {
+            out << ",\"track\":" << event.track;
+        }
+        out << "}}";
+    }
+    out << "\n]}\n";
+
+    uint64_t lost = begin;
+    std::cout << "Trace: " << path << " (" << (end - begin) << " spans";
+    if (lost > 0) {
+        std::cout << ", " << lost << " older spans overwritten";
+    }
+    std::cout << ")" << std::endl;
+}
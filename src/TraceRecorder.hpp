@@ -0,0 +1,107 @@
+#ifndef TRACE_RECORDER_HPP
+#define TRACE_RECORDER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Per-frame span tracing in Chrome trace-event format (opens in Perfetto or
+// chrome://tracing).
+//
+// Every timed stage becomes one complete ("X") event tagged with the frame
+// number, the face track ID (-1 if the span is not about one face) and the
+// recording thread. Events go into a fixed-size ring buffer that overwrites
+// the oldest spans, so a long session keeps its most recent history in
+// bounded memory; the JSON is only written by stop().
+//
+// Frame and track tags are per thread: whoever works on a frame sets them
+// (see TraceFrame/TraceTrack) and every span recorded on that thread picks
+// them up. When tracing is off, recording a span is one relaxed load.
+class TraceRecorder {
+public:
+    static TraceRecorder& instance();
+
+    // Start recording (capacity = spans kept, rounded up to a power of two).
+    // Only one session per process: the buffer outlives stop() for late writers
+    bool start(const std::string& path, size_t capacity = 1 << 18);
+
+    // Stop recording and write the JSON file
+    void stop();
+
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    // `name` must outlive the recorder (stage names are string literals)
+    void record(const char* name, std::chrono::steady_clock::time_point start,
+                std::chrono::steady_clock::time_point end);
+
+    // Label the calling thread in the trace
+    static void setThreadName(const std::string& name);
+
+    static void setThreadFrame(uint64_t frame);
+    static uint64_t getThreadFrame();
+    static void setThreadTrack(int track);
+    static int getThreadTrack();
+
+private:
+    TraceRecorder();
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+    struct Event {
+        std::atomic<uint64_t> sequence{0};     // slot index + 1 once written
+        const char* name = nullptr;
+        uint64_t frame = 0;
+        int32_t track = -1;
+        uint32_t thread = 0;
+        int64_t startUs = 0;
+        int64_t durationUs = 0;
+    };
+
+    std::atomic<bool> enabled;
+    std::unique_ptr<Event[]> events;
+    size_t mask;
+    std::atomic<uint64_t> nextSlot;
+    std::string path;
+    std::chrono::steady_clock::time_point epoch;
+
+    std::mutex threadNamesMutex;
+    std::vector<std::pair<uint32_t, std::string>> threadNames;
+
+    static uint32_t currentThreadId();
+};
+
+// Tags spans on this thread with `frame` for the lifetime of the scope
+class TraceFrame {
+public:
+    explicit TraceFrame(uint64_t frame) : previous(TraceRecorder::getThreadFrame()) {
+        TraceRecorder::setThreadFrame(frame);
+    }
+    ~TraceFrame() { TraceRecorder::setThreadFrame(previous); }
+
+    TraceFrame(const TraceFrame&) = delete;
+    TraceFrame& operator=(const TraceFrame&) = delete;
+
+private:
+    uint64_t previous;
+};
+
+// Tags spans on this thread with face track `track` for the lifetime of the scope
+class TraceTrack {
+public:
+    explicit TraceTrack(int track) : previous(TraceRecorder::getThreadTrack()) {
+        TraceRecorder::setThreadTrack(track);
+    }
+    ~TraceTrack() { TraceRecorder::setThreadTrack(previous); }
+
+    TraceTrack(const TraceTrack&) = delete;
+    TraceTrack& operator=(const TraceTrack&) = delete;
+
+private:
+    int previous;
+};
+
+#endif // TRACE_RECORDER_HPP
@@ -0,0 +1,63 @@
+#ifndef TRIPLE_BUFFER_HPP
+#define TRIPLE_BUFFER_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Lock-free "latest value" exchange between one producer and one consumer.
+//
+// Three slots: the producer fills its own, publish() swaps it with the
+// shared middle slot, and the consumer's update() swaps the middle slot with
+// its own if something new was published. Neither side ever waits for the
+// other; values the consumer was too slow to take are simply overwritten.
+// Each side works on its slot in place, so large values (cv::Mat headers,
+// settings structs) are handed over without copying.
+//
+// The producer and consumer roles may move between threads as long as the
+// hand-over itself is synchronized (e.g. a queue drain or thread join).
+template<typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : slots(), middle(1), writeIndex(0), readIndex(2) {}
+
+    // Producer: the slot to fill before publish(). It still holds whatever
+    // was in it last, so buffers can be reused (e.g. cv::Mat::copyTo).
+    T& writeBuffer() { return slots[writeIndex]; }
+
+    // Producer: make the write slot the latest value. Returns true if that
+    // replaced a value the consumer never took.
+    bool publish() {
+        uint8_t previous = middle.exchange(static_cast<uint8_t>(writeIndex | kFresh), std::memory_order_acq_rel);
+        writeIndex = previous & kIndexMask;
+        return (previous & kFresh) != 0;
+    }
+
+    // Consumer: take the latest published value, if there is a new one.
+    // Returns false (and keeps the current value) otherwise.
+    bool update() {
+        if ((middle.load(std::memory_order_acquire) & kFresh) == 0) {
+            return false;
+        }
+        uint8_t previous = middle.exchange(readIndex, std::memory_order_acq_rel);
+        readIndex = previous & kIndexMask;
+        return true;
+    }
+
+    // Consumer: the value taken by the last successful update()
+    T& read() { return slots[readIndex]; }
+    const T& read() const { return slots[readIndex]; }
+
+private:
+    static constexpr uint8_t kIndexMask = 0x3;
+    static constexpr uint8_t kFresh = 0x4;
+
+    std::array<T, 3> slots;
+    // Index of the shared slot, plus kFresh while it holds an untaken value.
+    // Each side's index on its own cache line, away from the shared word.
+    alignas(64) std::atomic<uint8_t> middle;
+    alignas(64) uint8_t writeIndex;     // producer only
+    alignas(64) uint8_t readIndex;      // consumer only
+};
+
+#endif // TRIPLE_BUFFER_HPP
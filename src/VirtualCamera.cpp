@@ -46,7 +46,7 @@ std::string VirtualCamera::findVirtualCameraDevice() {
     return "";
 }
 
-bool VirtualCamera::initialize(const std::string& devicePath, int width, int height) {
+bool VirtualCamera::initialize(const std::string& devicePath, int width, int height, double fps) {
     release();
     
     this->width = width;
@@ -78,7 +78,7 @@ bool VirtualCamera::initialize(const std::string& devicePath, int width, int hei
     std::ostringstream cmd;
     cmd << "ffmpeg -f rawvideo -pixel_format bgr24 -video_size " 
         << width << "x" << height 
-        << " -framerate 30 -i - -vf format=yuv420p -f v4l2 " 
+        << " -framerate " << fps << " -i - -vf format=yuv420p -f v4l2 " 
         << this->devicePath << " 2>/dev/null";
     
     ffmpegCommand = cmd.str();
@@ -11,8 +11,8 @@ public:
     ~VirtualCamera();
     
     // Initialize virtual camera with specified device path (e.g., "/dev/video2")
-    // Returns true if successful
-    bool initialize(const std::string& devicePath, int width = 640, int height = 480);
+    // and the frame rate frames will be written at. Returns true if successful
+    bool initialize(const std::string& devicePath, int width = 640, int height = 480, double fps = 30.0);
     
     // Write a frame to the virtual camera
     bool writeFrame(const cv::Mat& frame);
@@ -4,9 +4,32 @@
 #include <sstream>
 #include <chrono>
 #include <memory>
+#include <mutex>
+#include <csignal>
+#include <type_traits>
 #include "AdvancedFaceSwapper.hpp"
+#include "FrameProcessor.hpp"
+#include "ProcessorSelector.hpp"
+#include "BatchTranscoder.hpp"
+#include "InferenceScheduler.hpp"
+#include "StreamServer.hpp"
+#include "FramePipeline.hpp"
+#include "TripleBuffer.hpp"
 #include "VirtualCamera.hpp"
+#include "FramePacer.hpp"
+#include "FrameSource.hpp"
+#include "SourceFaceLoader.hpp"
+#include "FaceDirectoryWatcher.hpp"
 #include "ModernGUI.hpp"
+#include "ThreadBudget.hpp"
+#include "QualityGovernor.hpp"
+#include "Logger.hpp"
+#include "StageProfiler.hpp"
+#include "MetricsServer.hpp"
+#include "ControlServer.hpp"
+#include "SessionRecorder.hpp"
+#include "TraceRecorder.hpp"
+#include "AllocationTracker.hpp"
 
 // Advanced Face Swapper Wrapper - The only pipeline used
 // 
@@ -65,8 +88,8 @@ public:
     
     // Execute the full pipeline: preprocessing → detection → landmarks → alignment → 
     // embedding → swap → restoration → mask → blending → stabilization → output
-    void processFrame(cv::Mat& frame) {
-        swapper.detectAndSwap(frame);
+    void processFrame(cv::Mat& frame, const cv::Mat* knownFaces = nullptr) {
+        swapper.detectAndSwap(frame, knownFaces);
     }
     
     int getFaceCount() const {
@@ -88,16 +111,62 @@ public:
     void setTemporalStabilization(bool enable) {
         swapper.setTemporalStabilization(enable);
     }
+    
+    // Underlying swapper, for running its stages on a FramePipeline
+    AdvancedFaceSwapper& getSwapper() {
+        return swapper;
+    }
+    
+    void setQualitySettings(const QualitySettings& settings) {
+        swapper.setQualitySettings(settings);
+    }
+    
+    const FrameTimings& getLastFrameTimings() const {
+        return swapper.getLastFrameTimings();
+    }
 };
 
-// Global variables for mouse callback
-ModernGUI* g_gui = nullptr;
+// Swapper on `prototype`'s engine, with its own detector and networks, the
+// shared source faces and `prototype`'s settings (one per batch worker)
+std::unique_ptr<AdvancedFaceSwapper> cloneSwapper(const AdvancedFaceSwapper& prototype) {
+    auto swapper = std::make_unique<AdvancedFaceSwapper>(prototype.getEngine());
+    swapper->setBlendStrength(prototype.getBlendStrength());
+    swapper->setEnableGFPGAN(prototype.getEnableGFPGAN());
+    swapper->setTemporalStabilization(prototype.getTemporalStabilization());
+    return swapper;
+}
 
-// Mouse callback function
-void onMouse(int event, int x, int y, int flags, void* userdata) {
-    if (g_gui) {
-        g_gui->handleMouse(event, x, y, flags);
+// Basic and anonymize processors, which only need the detection model.
+// Basic mode swaps in the source face of `sourceProvider`.
+std::unique_ptr<FrameProcessor> makeDetectorProcessor(ProcessingMode mode,
+                                                      const AdvancedFaceSwapper& sourceProvider,
+                                                      const std::string& detectionModel,
+                                                      AnonymizeMode blurMode,
+                                                      float blurIntensity) {
+    if (mode == ProcessingMode::Basic) {
+        auto processor = std::make_unique<BasicFrameProcessor>(&sourceProvider);
+        if (!processor->loadModel(detectionModel)) {
+            return nullptr;
+        }
+        return processor;
+    }
+    if (mode == ProcessingMode::Anonymize) {
+        auto processor = std::make_unique<AnonymizeFrameProcessor>();
+        processor->getAnonymizer().setMode(blurMode);
+        processor->getAnonymizer().setBlurIntensity(blurIntensity);
+        if (!processor->loadModel(detectionModel)) {
+            return nullptr;
+        }
+        return processor;
     }
+    return nullptr;
+}
+
+// Set by SIGINT/SIGTERM; the frame loop finishes its frame and shuts down cleanly
+volatile std::sig_atomic_t g_stopRequested = 0;
+
+void onStopSignal(int) {
+    g_stopRequested = 1;
 }
 
 void printUsage(const char* programName) {
@@ -109,10 +178,43 @@ void printUsage(const char* programName) {
     std::cout << "Seamless Blending → Temporal Stabilization → Output Renderer → Virtual Camera" << std::endl;
     std::cout << "\nRequired Options:" << std::endl;
     std::cout << "  --face <path>             Path to source face image" << std::endl;
+    std::cout << "  --source-bank <file>      Per-identity source faces and target rules (see README)" << std::endl;
+    std::cout << "  --face-dir <path>         Watch a directory of source face images; N/P switch between them" << std::endl;
     std::cout << "\nOptional Parameters:" << std::endl;
+    std::cout << "  --mode <mode>             advanced (default): models, with geometric fallback per face;" << std::endl;
+    std::cout << "                            basic: fast geometric swap, detector only; anonymize: blur faces." << std::endl;
+    std::cout << "                            All three are loaded; press 'M' in the preview to switch" << std::endl;
+    std::cout << "  --blur-mode <mode>        Anonymize with gaussian (default), box, downsample or pixelate" << std::endl;
+    std::cout << "  --blur-intensity <0-1>    Anonymize strength (default: 0.5)" << std::endl;
     std::cout << "  --camera <index>          Camera index (default: 0)" << std::endl;
+    std::cout << "  --input <file>            Read frames from a video or image file instead of the camera" << std::endl;
+    std::cout << "  --realtime                Play --input at its native frame rate, or --replay with its" << std::endl;
+    std::cout << "                            original capture timing (default: as fast as possible)" << std::endl;
     std::cout << "  --device <path>           Virtual camera device path (default: auto-detect)" << std::endl;
-    std::cout << "  --no-preview              Disable preview window" << std::endl;
+    std::cout << "  --no-preview              Disable preview window (stop with Ctrl+C)" << std::endl;
+    std::cout << "  --output-fps <n>          Write the virtual camera at a steady n FPS, repeating the last" << std::endl;
+    std::cout << "                            frame when processing is late (default: as frames arrive)" << std::endl;
+    std::cout << "  --output-deadline <ms>    With --output-fps: frame age after which it counts as late (default: 100)" << std::endl;
+    std::cout << "  --output-passthrough      With --output-fps: show the unprocessed capture instead of a repeat" << std::endl;
+    std::cout << "                            once it has waited --output-deadline (not in anonymize mode)" << std::endl;
+    std::cout << "  --pipeline                Run detection, swap inference and compositing on separate" << std::endl;
+    std::cout << "                            threads for consecutive frames (higher FPS, some added latency)" << std::endl;
+    std::cout << "  --face-workers <n>        Process up to n faces of a frame in parallel (default: 1)" << std::endl;
+    std::cout << "\nOffline Batch Processing:" << std::endl;
+    std::cout << "  --batch <file>            Process all of --input into <file> as fast as possible, frames in" << std::endl;
+    std::cout << "                            parallel across cores in the --mode given, then exit (no camera," << std::endl;
+    std::cout << "                            preview or virtual camera)" << std::endl;
+    std::cout << "  --batch-workers <n>       Worker threads, each with its own models (default: one per CPU)" << std::endl;
+    std::cout << "  --batch-chunk <n>         Consecutive frames per unit of work (default: 32)" << std::endl;
+    std::cout << "  --batch-warmup <n>        Frames before each chunk replayed to rebuild tracking and" << std::endl;
+    std::cout << "                            stabilization (default: 8 in advanced mode, otherwise 0)" << std::endl;
+    std::cout << "  --batch-codec <fourcc>    Output codec (default: mp4v)" << std::endl;
+    std::cout << "\nMulti-Stream Server:" << std::endl;
+    std::cout << "  --stream <spec>           Serve a stream, repeat for more: <input>[,<output>][,weight=<n>][,fps=<n>]" << std::endl;
+    std::cout << "                            input: camera index, /dev/videoN or video file; output: virtual" << std::endl;
+    std::cout << "                            camera device. All streams share one copy of the models (no preview)" << std::endl;
+    std::cout << "  --infer-batch <n>         Most model requests from all streams run in one pass (default: 8)" << std::endl;
+    std::cout << "  --infer-window <ms>       Time a request waits for other streams to join its pass (default: 0)" << std::endl;
     std::cout << "\nDeep Learning Models:" << std::endl;
     std::cout << "  --detection-model <path>  Face detection model (default: assets/face_detection_yunet_2023mar.onnx)" << std::endl;
     std::cout << "  --arcface <path>          ArcFace ONNX model for face embeddings" << std::endl;
@@ -121,7 +223,31 @@ void printUsage(const char* programName) {
     std::cout << "\nPipeline Options:" << std::endl;
     std::cout << "  --enable-gfpgan           Enable GFPGAN face restoration in pipeline" << std::endl;
     std::cout << "  --disable-stabilization   Disable temporal stabilization" << std::endl;
+    std::cout << "  --frame-budget <ms>       Enable the quality governor with this per-frame target (e.g. 33)" << std::endl;
+    std::cout << "\nCPU Budget:" << std::endl;
+    std::cout << "  --threads <spec>          Per-stage threads and CPUs, e.g." << std::endl;
+    std::cout << "                            capture=1@0,detection=2@1-2,swap=4@3-6,composite=1@7,output=1@7" << std::endl;
+    std::cout << "                            (stages: capture, detection, swap, restore, composite, output)" << std::endl;
+    std::cout << "  --thread-config <file>    Read the same entries from a file, one per line" << std::endl;
+    std::cout << "\nProfiling:" << std::endl;
+    std::cout << "  --profile <file>          Write per-stage p50/p95/p99/max latencies to a .csv or .json file" << std::endl;
+    std::cout << "  --profile-interval <sec>  Seconds per profile window (default: 5)" << std::endl;
+    std::cout << "  --metrics-port <port>     Serve Prometheus metrics on http://127.0.0.1:<port>/metrics" << std::endl;
+    std::cout << "  --trace <file>            Write per-frame stage spans as Chrome trace JSON (open in Perfetto)" << std::endl;
+    std::cout << "  --trace-capacity <n>      Most recent spans kept for --trace (default: 262144)" << std::endl;
+    std::cout << "\nRecording and Replay:" << std::endl;
+    std::cout << "  --record <file>           Record captured frames with timestamps to a .fsrec file" << std::endl;
+    std::cout << "  --record-detections       Also record the detector output for each frame" << std::endl;
+    std::cout << "  --record-codec <codec>    raw, png (lossless, default) or jpg" << std::endl;
+    std::cout << "  --replay <file>           Read frames from a .fsrec recording instead of the camera" << std::endl;
+    std::cout << "  --replay-detections       Use the recorded detections instead of running the detector" << std::endl;
+    std::cout << "                            (not with --pipeline)" << std::endl;
+    std::cout << "  --replay-from <n>         Start the replay at the nth recorded frame" << std::endl;
     std::cout << "\nOther:" << std::endl;
+    std::cout << "  --control-socket <path>   Take setting changes, source faces and stats queries on a Unix socket" << std::endl;
+    std::cout << "  --log-level <level>       trace, debug, info, warn, error or off (default: info;" << std::endl;
+    std::cout << "                            debug and trace are compiled out of release builds)" << std::endl;
+    std::cout << "  --log-rate <n>            Max lines per second from one log site, 0 = unlimited (default: 10)" << std::endl;
     std::cout << "  --help, -h                Show this help message" << std::endl;
     std::cout << "\nExamples:" << std::endl;
     std::cout << "  " << programName << " --face image.jpg" << std::endl;
@@ -129,18 +255,81 @@ void printUsage(const char* programName) {
     std::cout << "  " << programName << " --arcface models/arcface.onnx --inswapper models/inswapper_128.onnx --gfpgan models/gfpgan.onnx --face image.jpg --enable-gfpgan" << std::endl;
 }
 
+// Parse the value of a numeric option, which must lie in [minValue, maxValue].
+// Prints an error and the usage otherwise.
+template<typename T>
+bool parseNumber(const char* programName, const std::string& option, const std::string& text,
+                 T minValue, T maxValue, T& value) {
+    bool valid = false;
+    try {
+        size_t used = 0;
+        if (std::is_integral<T>::value) {
+            long long parsed = std::stoll(text, &used);
+            valid = used == text.size() && parsed >= static_cast<long long>(minValue)
+                    && parsed <= static_cast<long long>(maxValue);
+            value = static_cast<T>(parsed);
+        } else {
+            double parsed = std::stod(text, &used);
+            valid = used == text.size() && parsed >= minValue && parsed <= maxValue;
+            value = static_cast<T>(parsed);
+        }
+    } catch (const std::exception&) {
+        valid = false;
+    }
+    if (!valid) {
+        std::cerr << "Error: " << option << " expects a number from " << minValue << " to " << maxValue
+                  << ", got: " << text << std::endl;
+        printUsage(programName);
+    }
+    return valid;
+}
+
 int main(int argc, char** argv) {
+    // Count cv::Mat buffers too (tracking builds only)
+    AllocationTracker::install();
+    
     // Default values - Always use advanced pipeline
     std::string detectionModel = "assets/face_detection_yunet_2023mar.onnx";
     std::string arcFaceModel = "";
     std::string inSwapperModel = "";
     std::string gfpganModel = "";
     std::string sourceFacePath = "";
+    std::string sourceBankPath = "";
+    std::string faceDirectory = "";
     int cameraIndex = 0;
+    std::string inputPath = "";
+    bool realtimeInput = false;
     std::string virtualCameraDevice = "";
     bool showPreview = true;
+    double outputFps = 0.0;
+    double outputDeadlineMs = 100.0;
+    bool outputPassthrough = false;
+    bool usePipeline = false;
     bool enableGFPGAN = false;
     bool useTemporalStabilization = true;
+    ThreadBudget threadBudget;
+    double frameBudgetMs = 0.0;
+    int faceWorkers = 1;
+    std::string profilePath = "";
+    double profileInterval = 5.0;
+    int metricsPort = 0;
+    std::string controlSocketPath = "";
+    std::string tracePath = "";
+    size_t traceCapacity = 1 << 18;
+    std::string recordPath = "";
+    bool recordDetections = false;
+    SessionCodec recordCodec = SessionCodec::Png;
+    std::string replayPath = "";
+    bool replayDetections = false;
+    size_t replayFrom = 0;
+    ProcessingMode processingMode = ProcessingMode::Advanced;
+    AnonymizeMode blurMode = AnonymizeMode::Gaussian;
+    float blurIntensity = 0.5f;
+    BatchOptions batchOptions;
+    bool batchWarmupSet = false;
+    std::vector<StreamConfig> streamConfigs;
+    int inferBatch = 8;
+    double inferWindowMs = 0.0;
     
     // Parse command line arguments
     for (int i = 1; i < argc; i++) {
@@ -154,17 +343,148 @@ int main(int argc, char** argv) {
         } else if (arg == "--gfpgan" && i + 1 < argc) {
             gfpganModel = argv[++i];
         } else if (arg == "--camera" && i + 1 < argc) {
-            cameraIndex = std::stoi(argv[++i]);
+            if (!parseNumber(argv[0], arg, argv[++i], 0, 1023, cameraIndex)) {
+                return -1;
+            }
+        } else if (arg == "--input" && i + 1 < argc) {
+            inputPath = argv[++i];
+        } else if (arg == "--realtime") {
+            realtimeInput = true;
         } else if (arg == "--device" && i + 1 < argc) {
             virtualCameraDevice = argv[++i];
         } else if (arg == "--face" && i + 1 < argc) {
             sourceFacePath = argv[++i];
+        } else if (arg == "--source-bank" && i + 1 < argc) {
+            sourceBankPath = argv[++i];
+        } else if (arg == "--face-dir" && i + 1 < argc) {
+            faceDirectory = argv[++i];
         } else if (arg == "--no-preview") {
             showPreview = false;
+        } else if (arg == "--output-fps" && i + 1 < argc) {
+            if (!parseNumber(argv[0], arg, argv[++i], 1.0, 1000.0, outputFps)) {
+                return -1;
+            }
+        } else if (arg == "--output-deadline" && i + 1 < argc) {
+            if (!parseNumber(argv[0], arg, argv[++i], 1.0, 60000.0, outputDeadlineMs)) {
+                return -1;
+            }
+        } else if (arg == "--output-passthrough") {
+            outputPassthrough = true;
+        } else if (arg == "--pipeline") {
+            usePipeline = true;
+        } else if (arg == "--face-workers" && i + 1 < argc) {
+            if (!parseNumber(argv[0], arg, argv[++i], 1, 64, faceWorkers)) {
+                return -1;
+            }
         } else if (arg == "--enable-gfpgan") {
             enableGFPGAN = true;
         } else if (arg == "--disable-stabilization") {
             useTemporalStabilization = false;
+        } else if (arg == "--frame-budget" && i + 1 < argc) {
+            if (!parseNumber(argv[0], arg, argv[++i], 1.0, 60000.0, frameBudgetMs)) {
+                return -1;
+            }
+        } else if (arg == "--threads" && i + 1 < argc) {
+            if (!threadBudget.parseSpec(argv[++i])) {
+                return -1;
+            }
+        } else if (arg == "--thread-config" && i + 1 < argc) {
+            if (!threadBudget.loadFromFile(argv[++i])) {
+                return -1;
+            }
+        } else if (arg == "--profile" && i + 1 < argc) {
+            profilePath = argv[++i];
+        } else if (arg == "--profile-interval" && i + 1 < argc) {
+            if (!parseNumber(argv[0], arg, argv[++i], 0.1, 86400.0, profileInterval)) {
+                return -1;
+            }
+        } else if (arg == "--metrics-port" && i + 1 < argc) {
+            if (!parseNumber(argv[0], arg, argv[++i], 1, 65535, metricsPort)) {
+                return -1;
+            }
+        } else if (arg == "--control-socket" && i + 1 < argc) {
+            controlSocketPath = argv[++i];
+        } else if (arg == "--trace" && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (arg == "--trace-capacity" && i + 1 < argc) {
+            if (!parseNumber(argv[0], arg, argv[++i], size_t(1), size_t(1) << 28, traceCapacity)) {
+                return -1;
+            }
+        } else if (arg == "--record" && i + 1 < argc) {
+            recordPath = argv[++i];
+        } else if (arg == "--record-detections") {
+            recordDetections = true;
+        } else if (arg == "--record-codec" && i + 1 < argc) {
+            if (!SessionRecorder::parseCodec(argv[++i], recordCodec)) {
+                std::cerr << "Error: Unknown recording codec: " << argv[i] << std::endl;
+                return -1;
+            }
+        } else if (arg == "--replay" && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if (arg == "--replay-detections") {
+            replayDetections = true;
+        } else if (arg == "--replay-from" && i + 1 < argc) {
+            if (!parseNumber(argv[0], arg, argv[++i], size_t(0), size_t(1) << 40, replayFrom)) {
+                return -1;
+            }
+        } else if (arg == "--batch" && i + 1 < argc) {
+            batchOptions.outputPath = argv[++i];
+        } else if (arg == "--mode" && i + 1 < argc) {
+            if (!FrameProcessor::parseMode(argv[++i], processingMode)) {
+                std::cerr << "Error: Unknown mode: " << argv[i] << std::endl;
+                return -1;
+            }
+        } else if (arg == "--blur-mode" && i + 1 < argc) {
+            if (!FaceAnonymizer::parseMode(argv[++i], blurMode)) {
+                std::cerr << "Error: Unknown blur mode: " << argv[i] << std::endl;
+                return -1;
+            }
+        } else if (arg == "--blur-intensity" && i + 1 < argc) {
+            if (!parseNumber(argv[0], arg, argv[++i], 0.0f, 1.0f, blurIntensity)) {
+                return -1;
+            }
+        } else if (arg == "--batch-workers" && i + 1 < argc) {
+            if (!parseNumber(argv[0], arg, argv[++i], 0, 1024, batchOptions.workers)) {
+                return -1;
+            }
+        } else if (arg == "--batch-chunk" && i + 1 < argc) {
+            if (!parseNumber(argv[0], arg, argv[++i], 1, 100000, batchOptions.chunkFrames)) {
+                return -1;
+            }
+        } else if (arg == "--batch-warmup" && i + 1 < argc) {
+            if (!parseNumber(argv[0], arg, argv[++i], 0, 10000, batchOptions.warmupFrames)) {
+                return -1;
+            }
+            batchWarmupSet = true;
+        } else if (arg == "--batch-codec" && i + 1 < argc) {
+            batchOptions.fourcc = argv[++i];
+        } else if (arg == "--stream" && i + 1 < argc) {
+            StreamConfig config;
+            if (!StreamConfig::parse(argv[++i], config)) {
+                return -1;
+            }
+            streamConfigs.push_back(config);
+        } else if (arg == "--infer-batch" && i + 1 < argc) {
+            if (!parseNumber(argv[0], arg, argv[++i], 1, 256, inferBatch)) {
+                return -1;
+            }
+        } else if (arg == "--infer-window" && i + 1 < argc) {
+            if (!parseNumber(argv[0], arg, argv[++i], 0.0, 1000.0, inferWindowMs)) {
+                return -1;
+            }
+        } else if (arg == "--log-level" && i + 1 < argc) {
+            LogLevel level;
+            if (!Logger::parseLevel(argv[++i], level)) {
+                std::cerr << "Error: Unknown log level: " << argv[i] << std::endl;
+                return -1;
+            }
+            Logger::instance().setLevel(level);
+        } else if (arg == "--log-rate" && i + 1 < argc) {
+            uint32_t rate;
+            if (!parseNumber(argv[0], arg, argv[++i], uint32_t(0), uint32_t(1000000), rate)) {
+                return -1;
+            }
+            Logger::instance().setRateLimit(rate);
         } else if (arg == "--help" || arg == "-h") {
             printUsage(argv[0]);
             return 0;
@@ -189,16 +509,62 @@ int main(int argc, char** argv) {
         fclose(file);
     }
     
+    // Size OpenCV's pool and pin threads before anything spins up workers
+    threadBudget.apply();
+    if (threadBudget.isConfigured()) {
+        threadBudget.print(std::cout);
+    }
+    
     // Create and initialize the advanced face swapping pipeline
     std::cout << "=== Advanced Face Swapping Pipeline ===" << std::endl;
     std::cout << "Pipeline: Camera → Preprocessing → Detection → Landmarks → Alignment" << std::endl;
     std::cout << "           → Embedding → Swap → Restoration → Mask → Blending" << std::endl;
     std::cout << "           → Stabilization → Output → Virtual Camera" << std::endl;
     
+    // In server mode ArcFace and INSwapper are loaded once, by the scheduler
+    bool serverMode = !streamConfigs.empty();
     auto faceSwapper = std::make_unique<FaceSwapperPipeline>(
-        detectionModel, arcFaceModel, inSwapperModel, gfpganModel);
+        detectionModel, serverMode ? "" : arcFaceModel, serverMode ? "" : inSwapperModel, gfpganModel);
     faceSwapper->setEnableGFPGAN(enableGFPGAN);
     faceSwapper->setTemporalStabilization(useTemporalStabilization);
+    if (faceWorkers > 1 && !faceSwapper->getSwapper().setFaceWorkers(faceWorkers)) {
+        std::cerr << "Warning: Could not create face workers, processing faces serially." << std::endl;
+    }
+    
+    // Deadline-driven quality control (off unless a frame budget is given)
+    QualityGovernor governor;
+    if (frameBudgetMs > 0.0) {
+        governor.setFrameBudget(frameBudgetMs);
+        governor.setEnabled(true);
+        std::cout << "Quality governor enabled: " << frameBudgetMs << " ms per frame" << std::endl;
+    }
+    
+    // Per-stage latency histograms, dumped every profileInterval seconds
+    StageProfiler& profiler = StageProfiler::instance();
+    if (!profilePath.empty()) {
+        if (!profiler.open(profilePath, profileInterval)) {
+            return -1;
+        }
+        std::cout << "Stage profiling: " << profilePath << " every " << profileInterval << " s" << std::endl;
+    }
+    
+    // Stage spans per frame and thread, written on exit
+    if (!tracePath.empty()) {
+        if (!TraceRecorder::instance().start(tracePath, traceCapacity)) {
+            return -1;
+        }
+        TraceRecorder::setThreadName("main");
+        std::cout << "Tracing: " << tracePath << " (last " << traceCapacity << " spans)" << std::endl;
+    }
+    
+    // Scrape endpoint for headless monitoring
+    MetricsServer metrics;
+    if (metricsPort > 0) {
+        if (!metrics.start(metricsPort)) {
+            return -1;
+        }
+        std::cout << "Metrics: http://127.0.0.1:" << metricsPort << "/metrics" << std::endl;
+    }
     
     // Adjust model paths if relative and validate
     if (!arcFaceModel.empty()) {
@@ -246,6 +612,22 @@ int main(int argc, char** argv) {
         std::cout << "For optimal results with INSwapper, download models using: ./download_models.sh" << std::endl;
     }
     
+    // One copy of the networks for every stream; the prototype prepares
+    // the source faces on it too
+    InferenceScheduler scheduler;
+    if (serverMode) {
+        if (!arcFaceModel.empty()) {
+            scheduler.loadArcFaceModel(arcFaceModel);
+        }
+        if (!inSwapperModel.empty()) {
+            scheduler.loadInSwapperModel(inSwapperModel);
+        }
+        scheduler.setMaxBatch(inferBatch);
+        scheduler.setBatchWindow(inferWindowMs);
+        scheduler.start();
+        faceSwapper->getSwapper().getEngine()->setInferenceScheduler(&scheduler);
+    }
+    
     // Load source face if provided via command line
     if (!sourceFacePath.empty()) {
         FILE* f = fopen(sourceFacePath.c_str(), "r");
@@ -268,25 +650,221 @@ int main(int argc, char** argv) {
         }
     }
 
-    cv::VideoCapture cap(cameraIndex);
-    if (!cap.isOpened()) {
-        std::cerr << "Error: Could not open camera " << cameraIndex << "." << std::endl;
+    // Several sources, chosen per target identity
+    if (!sourceBankPath.empty()) {
+        AdvancedFaceSwapper& swapper = faceSwapper->getSwapper();
+        SourceBank& bank = swapper.getSourceBank();
+        if (!bank.loadFile(sourceBankPath, [&swapper](const cv::Mat& image) {
+                return swapper.prepareSourceFace(image);
+            })) {
+            return -1;
+        }
+        if (!bank.getDefaultSourceName().empty()) {
+            std::shared_ptr<const SourceFace> defaultSource = bank.getSource(bank.getDefaultSourceName());
+            if (!defaultSource) {
+                std::cerr << "Error: Unknown default source: " << bank.getDefaultSourceName() << std::endl;
+                return -1;
+            }
+            swapper.setSourceFace(defaultSource);
+        }
+        std::cout << "✓ Source bank: " << bank.getSourceCount() << " sources, "
+                  << bank.getRuleCount() << " target rules" << std::endl;
+    }
+
+    if (!controlSocketPath.empty() && (serverMode || !batchOptions.outputPath.empty())) {
+        std::cerr << "Warning: --control-socket only applies to the live loop; ignored." << std::endl;
+    }
+
+    // Several cameras in one process, sharing the models, then exit
+    if (serverMode) {
+        if (!batchOptions.outputPath.empty()) {
+            std::cerr << "Error: --stream and --batch cannot be combined" << std::endl;
+            return -1;
+        }
+        AdvancedFaceSwapper& prototype = faceSwapper->getSwapper();
+        if (!prototype.isReadyToSwap()) {
+            std::cerr << "Error: --stream needs a source face (--face or --source-bank)" << std::endl;
+            return -1;
+        }
+        StreamServer server(prototype, scheduler);
+        for (const StreamConfig& config : streamConfigs) {
+            if (!server.addStream(config)) {
+                return -1;
+            }
+        }
+        std::cout << "Serving " << server.getStreamCount() << " streams (stop with Ctrl+C)" << std::endl;
+        
+        std::signal(SIGINT, onStopSignal);
+        std::signal(SIGTERM, onStopSignal);
+        bool ok = server.run([] { return g_stopRequested != 0; });
+        scheduler.stop();
+        server.printSummary(std::cout);
+        scheduler.printSummary(std::cout);
+        TraceRecorder::instance().stop();
+        metrics.stop();
+        if (!profilePath.empty()) {
+            profiler.close();
+            profiler.printSummary(std::cout);
+        }
+        Logger::instance().flush();
+        return ok ? 0 : -1;
+    }
+
+    // Offline transcoding: frame-parallel over the whole file, then exit
+    if (!batchOptions.outputPath.empty()) {
+        if (inputPath.empty()) {
+            std::cerr << "Error: --batch needs a video file from --input" << std::endl;
+            return -1;
+        }
+        batchOptions.inputPath = inputPath;
+        
+        // Each worker gets its own processor, all on the prototype's models
+        AdvancedFaceSwapper& prototype = faceSwapper->getSwapper();
+        if (processingMode != ProcessingMode::Anonymize && !prototype.isReadyToSwap()) {
+            std::cerr << "Error: --batch needs a source face (--face or --source-bank)" << std::endl;
+            return -1;
+        }
+        if (processingMode == ProcessingMode::Basic && !prototype.isSourceFaceLoaded()) {
+            std::cerr << "Error: --batch in basic mode needs --face" << std::endl;
+            return -1;
+        }
+        // Only the model pipeline keeps state across frames
+        if (!batchWarmupSet && processingMode != ProcessingMode::Advanced) {
+            batchOptions.warmupFrames = 0;
+        }
+        BatchTranscoder::WorkerFactory factory = [&](int) -> std::unique_ptr<FrameProcessor> {
+            if (processingMode == ProcessingMode::Advanced) {
+                return std::make_unique<AdvancedFrameProcessor>(
+                    cloneSwapper(prototype));
+            }
+            return makeDetectorProcessor(processingMode, prototype, detectionModel, blurMode, blurIntensity);
+        };
+        std::cout << "Batch mode: " << FrameProcessor::modeName(processingMode);
+        if (processingMode == ProcessingMode::Anonymize) {
+            std::cout << " (" << FaceAnonymizer::modeName(blurMode) << ")";
+        }
+        std::cout << std::endl;
+        
+        // Parallelism comes from frames; OpenCV's own pool would only
+        // oversubscribe the cores (unless --threads says otherwise)
+        if (!threadBudget.isConfigured()) {
+            cv::setNumThreads(1);
+        }
+        
+        std::signal(SIGINT, onStopSignal);
+        std::signal(SIGTERM, onStopSignal);
+        BatchTranscoder transcoder(batchOptions);
+        bool ok = transcoder.run(factory, [] { return g_stopRequested != 0; });
+        transcoder.printSummary(std::cout);
+        TraceRecorder::instance().stop();
+        metrics.stop();
+        if (!profilePath.empty()) {
+            profiler.close();
+            profiler.printSummary(std::cout);
+        }
+        Logger::instance().flush();
+        return ok ? 0 : -1;
+    }
+
+    // Every mode is loaded up front so switching never waits on a model.
+    // The advanced processor drives the same swapper as the pipeline.
+    ProcessorSelector selector;
+    selector.add(std::make_unique<AdvancedFrameProcessor>(faceSwapper->getSwapper()));
+    for (ProcessingMode mode : {ProcessingMode::Basic, ProcessingMode::Anonymize}) {
+        std::unique_ptr<FrameProcessor> processor = makeDetectorProcessor(
+            mode, faceSwapper->getSwapper(), detectionModel, blurMode, blurIntensity);
+        if (processor) {
+            selector.add(std::move(processor));
+        } else {
+            std::cerr << "Warning: " << FrameProcessor::modeName(mode) << " mode unavailable" << std::endl;
+        }
+    }
+    if (!selector.request(processingMode)) {
         return -1;
     }
 
-    // Set a reasonable resolution
-    int width = 640;
-    int height = 480;
-    cap.set(cv::CAP_PROP_FRAME_WIDTH, width);
-    cap.set(cv::CAP_PROP_FRAME_HEIGHT, height);
+    // Source faces from a watched directory, prepared in the background
+    FaceDirectoryWatcher faceWatcher(faceSwapper->getSwapper());
+    if (!faceDirectory.empty()) {
+        if (!faceWatcher.start(faceDirectory)) {
+            return -1;
+        }
+        std::cout << "Watching " << faceDirectory << " for source faces" << std::endl;
+    }
+
+    // Settings changed while running (GUI, control socket); the frame loop
+    // applies them between frames
+    RuntimeSettings initialSettings;
+    initialSettings.temporalStabilization = useTemporalStabilization;
+    initialSettings.enableGFPGAN = enableGFPGAN;
+    RuntimeSettingsChannel runtimeSettings(initialSettings);
+    ControlServer control(runtimeSettings);
+    if (!controlSocketPath.empty()) {
+        // Source faces are prepared on the control thread with the engine's
+        // own networks and published like an upload
+        control.setSourceHandler([&faceSwapper](const std::string& imagePath, std::string& error) {
+            if (!faceSwapper->getSwapper().loadSourceFace(imagePath)) {
+                error = "no usable face in " + imagePath;
+                return false;
+            }
+            return true;
+        });
+        // Bank sources (--face-dir images, --source-bank names) switch by name
+        control.setSourceNameHandler([&faceWatcher](const std::string& name, std::string&) {
+            return faceWatcher.activate(name);
+        });
+        control.setActiveSourceProvider([&faceSwapper, &faceWatcher] {
+            AdvancedFaceSwapper& swapper = faceSwapper->getSwapper();
+            std::shared_ptr<const SourceFace> active = swapper.getSourceFace();
+            if (!active) {
+                return std::string("none");
+            }
+            std::string name = faceWatcher.getActiveName();
+            if (!name.empty() && swapper.getSourceBank().getSource(name) == active) {
+                return name;
+            }
+            // Loaded from an image path (--face, upload or `source`)
+            return std::string("unnamed");
+        });
+        control.setStatsProvider([&metrics] { return metrics.renderMetrics(); });
+        if (!control.start(controlSocketPath)) {
+            return -1;
+        }
+        std::cout << "Control socket: " << controlSocketPath << std::endl;
+    }
+
+    // Camera at a reasonable resolution, a file or a session recording
+    FrameSource cap;
+    bool opened;
+    if (!replayPath.empty()) {
+        opened = cap.openRecording(replayPath, realtimeInput, replayFrom);
+    } else if (!inputPath.empty()) {
+        opened = cap.openFile(inputPath, realtimeInput);
+    } else {
+        opened = cap.openCamera(cameraIndex, 640, 480);
+    }
+    if (!opened) {
+        return -1;
+    }
+    if (replayDetections && usePipeline) {
+        std::cerr << "Warning: --replay-detections is not supported with --pipeline; running the detector." << std::endl;
+        replayDetections = false;
+    }
     
-    // Get actual resolution
-    width = static_cast<int>(cap.get(cv::CAP_PROP_FRAME_WIDTH));
-    height = static_cast<int>(cap.get(cv::CAP_PROP_FRAME_HEIGHT));
+    // Raw captured frames (and optionally detections) for later replay
+    SessionRecorder recorder;
+    if (!recordPath.empty()) {
+        if (!recorder.open(recordPath, recordCodec)) {
+            return -1;
+        }
+        std::cout << "Recording session to " << recordPath << std::endl;
+    }
+    int width = cap.getWidth();
+    int height = cap.getHeight();
 
     // Initialize virtual camera
     VirtualCamera virtualCam;
-    if (!virtualCam.initialize(virtualCameraDevice, width, height)) {
+    if (!virtualCam.initialize(virtualCameraDevice, width, height, outputFps > 0.0 ? outputFps : 30.0)) {
         std::cerr << "Warning: Virtual camera initialization failed." << std::endl;
         std::cerr << "The swapped video will only be shown in the preview window." << std::endl;
         std::cerr << "To use with Zoom/video calls, set up v4l2loopback first." << std::endl;
@@ -294,52 +872,137 @@ int main(int argc, char** argv) {
         std::cout << "✓ Virtual camera ready! Select '" << virtualCam.getDevicePath() 
                   << "' as your camera in Zoom or other video call applications." << std::endl;
     }
+    
+    // Steady output cadence, independent of how long each frame took
+    FramePacer pacer(virtualCam);
+    pacer.setMetrics(&metrics);
+    if (outputFps > 0.0 && virtualCam.isReady()) {
+        if (!pacer.start(outputFps, outputDeadlineMs, outputPassthrough)) {
+            return -1;
+        }
+        std::cout << "Output pacing: " << outputFps << " FPS, deadline " << outputDeadlineMs << " ms"
+                  << (outputPassthrough ? ", passthrough when late" : "") << std::endl;
+    }
+    auto writeOutput = [&](const cv::Mat& output, std::chrono::steady_clock::time_point captureTime) {
+        if (pacer.isRunning()) {
+            pacer.submitComposite(output, captureTime);
+        } else if (virtualCam.isReady()) {
+            ScopedProfile profile(ProfileStage::VirtualCameraWrite);
+            if (!virtualCam.writeFrame(output)) {
+                metrics.recordOutputDrop();
+            }
+        }
+    };
+
+    // Staged execution across consecutive frames. The composite thread writes
+    // the virtual camera, feeds the governor and publishes the latest output
+    // for the preview without waiting on the frame loop.
+    std::mutex governorMutex;
+    TripleBuffer<cv::Mat> latestOutput;
+    std::unique_ptr<FramePipeline> pipeline;
+    if (usePipeline) {
+        pipeline = std::make_unique<FramePipeline>(faceSwapper->getSwapper());
+        FramePipeline* pipelinePtr = pipeline.get();
+        pipeline->start([&, pipelinePtr](PipelineFrame& out) {
+            writeOutput(out.frame, out.captureTime);
+            if (out.swapped) {
+                metrics.recordFrame(out.timings, out.analysis.faces.rows);
+                // Every captured frame is submitted once, so the pipeline
+                // index is the capture index
+                if (recordDetections && recorder.isOpen()) {
+                    recorder.recordDetections(out.index, out.analysis.faces);
+                }
+            }
+            
+            if (out.swapped) {
+                std::lock_guard<std::mutex> lock(governorMutex);
+                if (governor.update(out.timings)) {
+                    pipelinePtr->setQualitySettings(governor.getSettings());
+                    selector.setFallback(governor.getSettings().basicMode);
+                    profiler.setQualityLevel(governor.getLevel());
+                    metrics.setQualityLevel(governor.getLevel());
+                }
+            }
+            latestOutput.writeBuffer() = out.frame;
+            latestOutput.publish();
+        });
+        
+        // The calling thread only captures from here on
+        ThreadBudget::active().applyToCurrentThread(PipelineStage::Capture);
+        std::cout << "Pipelined execution enabled (detection | inference | compositing)" << std::endl;
+    }
 
     // Initialize modern GUI
     ModernGUI gui;
+    SourceFaceLoader sourceLoader(faceSwapper->getSwapper());
     if (showPreview) {
         if (!gui.initialize(1280, 720)) {
             std::cerr << "Failed to initialize GUI." << std::endl;
             return -1;
         }
         
-        // Set up blend strength callback
-        gui.setBlendStrengthCallback([&faceSwapper](float strength) {
-            faceSwapper->setBlendStrength(strength);
+        // The slider publishes like the control socket; the frame loop
+        // applies it to both swap modes
+        gui.setBlendStrengthCallback([&runtimeSettings](float strength) {
+            runtimeSettings.update([strength](RuntimeSettings& s) { s.blendStrength = strength; });
         });
         
         // Set initial blend strength
-        gui.setBlendStrength(0.95f);
-        faceSwapper->setBlendStrength(0.95f);
+        gui.setBlendStrength(runtimeSettings.get().blendStrength, false);
         
-        // Set up image upload callback
-        gui.setImageUploadCallback([&faceSwapper, &gui](const std::string& imagePath) {
-            if (faceSwapper->loadSourceFace(imagePath)) {
+        // Uploaded images are prepared in the background and swapped in
+        // between frames; output keeps flowing meanwhile
+        sourceLoader.start([&gui](const std::string& imagePath, bool loaded) {
+            if (loaded) {
                 gui.setSourceFaceLoaded(true);
                 std::cout << "✓ Source face loaded from: " << imagePath << std::endl;
             } else {
-                gui.setSourceFaceLoaded(false);
                 std::cerr << "Failed to load source face from: " << imagePath << std::endl;
             }
         });
+        gui.setImageUploadCallback([&sourceLoader](const std::string& imagePath) {
+            sourceLoader.request(imagePath);
+        });
+        
+        // Switching is a pointer swap in the swapper, no frame work
+        gui.setSourceCycleCallback([&faceWatcher, &gui](int step) {
+            if (faceWatcher.cycle(step)) {
+                gui.setSourceName(faceWatcher.getActiveName());
+            }
+        });
+        
+        // Takes effect at the next frame; all modes are already loaded
+        gui.setModeCycleCallback([&selector](int step) {
+            selector.cycle(step);
+        });
         
         // Set initial source face status
         gui.setSourceFaceLoaded(faceSwapper->isSourceFaceLoaded());
         
         // Set virtual camera status
         gui.setVirtualCameraStatus(virtualCam.isReady(), virtualCam.getDevicePath());
-        
-        // Set up mouse callback
-        g_gui = &gui;
-        cv::setMouseCallback("Face Swapper - Modern GUI", onMouse, nullptr);
     }
+    
+    // Ctrl+C / kill end the session the same way 'q' does
+    std::signal(SIGINT, onStopSignal);
+    std::signal(SIGTERM, onStopSignal);
 
     cv::Mat frame;
+    cv::Mat previewFrame;      // what the preview shows; never a capture target
     std::cout << "\n=== Face Swapper - Advanced Pipeline ===" << std::endl;
-    std::cout << "Mode: Advanced Deep Learning (YuNet → ArcFace → INSwapper → GFPGAN)" << std::endl;
-    std::cout << "Press 'q' or 'ESC' to exit." << std::endl;
-    std::cout << "Press 'U' to upload a source face image." << std::endl;
-    std::cout << "Camera resolution: " << width << "x" << height << std::endl;
+    if (processingMode == ProcessingMode::Advanced) {
+        std::cout << "Mode: Advanced Deep Learning (YuNet → ArcFace → INSwapper → GFPGAN)" << std::endl;
+    } else {
+        std::cout << "Mode: " << FrameProcessor::modeName(processingMode) << std::endl;
+    }
+    if (showPreview) {
+        std::cout << "Press 'q' or 'ESC' to exit." << std::endl;
+        std::cout << "Press 'U' to upload a source face image." << std::endl;
+        std::cout << "Press 'M' to switch between basic, advanced and anonymize mode." << std::endl;
+    } else {
+        std::cout << "Press Ctrl+C to exit." << std::endl;
+    }
+    std::cout << "Input: " << cap.describe() << " (" << width << "x" << height << ")" << std::endl;
     if (showPreview) {
         if (!faceSwapper->isSourceFaceLoaded()) {
             std::cout << "No source face loaded. Press 'U' to upload a face image." << std::endl;
@@ -351,60 +1014,225 @@ int main(int argc, char** argv) {
     auto lastTime = std::chrono::steady_clock::now();
     int frameCount = 0;
     float fps = 0.0f;
+    uint64_t lastDelivered = 0;
+    uint64_t captureIndex = 0;
+    bool pipelineIdle = true;
+    bool swapperSettingsStale = false;     // published settings not yet applied to the swapper here
 
-    while (true) {
+    while (!g_stopRequested) {
         auto currentTime = std::chrono::steady_clock::now();
         auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(currentTime - lastTime).count();
         
-        cap >> frame;
+        auto captureTime = std::chrono::steady_clock::now();
+        TraceRecorder::setThreadFrame(captureIndex);
+        if (pacer.isRunning()) {
+            // The pacer may still hold the last frame's pixels
+            frame.release();
+        }
+        {
+            ScopedProfile profile(ProfileStage::Capture);
+            if (!cap.read(frame)) {
+                frame.release();
+            }
+        }
         if (frame.empty()) {
-            std::cerr << "Error: Captured empty frame." << std::endl;
+            if (cap.isFile()) {
+                std::cout << "End of input: " << cap.describe() << std::endl;
+            } else {
+                std::cerr << "Error: Captured empty frame." << std::endl;
+            }
             break;
         }
+        metrics.recordCapture();
+        if (recorder.isOpen()) {
+            recorder.recordFrame(captureIndex, captureTime, frame);
+        }
 
-        // Process frame through the advanced pipeline
-        // Pipeline: Preprocessing → Detection → Landmarks → Alignment → 
-        // Embedding → Swap → Restoration → Mask → Blending → Stabilization → Output
-        if (faceSwapper->isSourceFaceLoaded()) {
-            faceSwapper->processFrame(frame);
+        // Mode switches and the governor's basic-mode fallback take effect here,
+        // between frames. Only the advanced mode runs on the pipeline.
+        FrameProcessor& processor = selector.acquire();
+        bool pipelined = pipeline && processor.getMode() == ProcessingMode::Advanced;
+        
+        // Fallback for the pacer while this frame is processed. Faces that
+        // are meant to be anonymized must never go out unprocessed.
+        if (pacer.isPassthroughEnabled()) {
+            if (processor.getMode() == ProcessingMode::Anonymize) {
+                pacer.dropRaw();
+            } else {
+                pacer.submitRaw(frame.clone(), captureTime);
+            }
+        }
+        
+        // So do runtime setting changes: one atomic check, applied only when
+        // something was published. The pipeline's inference stage applies
+        // them itself before its next frame.
+        if (runtimeSettings.poll()) {
+            const RuntimeSettings& settings = runtimeSettings.latest();
+            if (FrameProcessor* basic = selector.get(ProcessingMode::Basic)) {
+                basic->setBlendStrength(settings.blendStrength);
+            }
+            if (pipeline) {
+                pipeline->setRuntimeSettings(settings);
+            }
+            if (showPreview) {
+                gui.setBlendStrength(settings.blendStrength, false);
+            }
+            swapperSettingsStale = true;
         }
+        if (pipelined) {
+            // The pipeline composites in place and writes the virtual camera;
+            // the preview shows the most recently delivered frame
+            if (!pipeline->submit(frame)) {
+                metrics.recordCaptureDrop();
+            }
+            pipelineIdle = false;
+            // The pipeline owns the submitted pixels now, so the next capture
+            // must not decode into them
+            frame.release();
+            latestOutput.update();
+            previewFrame = latestOutput.read();
+        } else {
+            if (pipeline) {
+                // Deliver the frames still in the pipeline before this one, so
+                // a switch neither drops nor reorders frames
+                if (!pipelineIdle) {
+                    pipeline->drain();
+                    pipelineIdle = true;
+                    latestOutput.update();
+                    latestOutput.read().release();
+                }
+                pipeline->skipFrames(1);
+            }
+            if (swapperSettingsStale) {
+                faceSwapper->getSwapper().applyRuntimeSettings(runtimeSettings.latest());
+                swapperSettingsStale = false;
+            }
+            
+            // Process frame with the selected processor. Advanced mode runs:
+            // Preprocessing → Detection → Landmarks → Alignment → 
+            // Embedding → Swap → Restoration → Mask → Blending → Stabilization → Output
+            if (processor.isReady()) {
+                bool advanced = processor.getMode() == ProcessingMode::Advanced;
+                bool useRecordedFaces = advanced && replayDetections && cap.hasRecordedFaces();
+                processor.process(frame, useRecordedFaces ? &cap.getRecordedFaces() : nullptr);
+                metrics.recordFrame(processor.getLastFrameTimings(), processor.getFaceCount());
+                if (advanced && recordDetections && recorder.isOpen()) {
+                    recorder.recordDetections(captureIndex, faceSwapper->getSwapper().getLastDetections());
+                }
+                
+                // Let the governor react to this frame's stage timings. It
+                // runs for advanced mode and for its own basic fallback.
+                if (selector.getRequestedMode() == ProcessingMode::Advanced) {
+                    std::lock_guard<std::mutex> lock(governorMutex);
+                    if (governor.update(processor.getLastFrameTimings())) {
+                        faceSwapper->setQualitySettings(governor.getSettings());
+                        if (pipeline) {
+                            pipeline->setQualitySettings(governor.getSettings());
+                        }
+                        selector.setFallback(governor.getSettings().basicMode);
+                        profiler.setQualityLevel(governor.getLevel());
+                        metrics.setQualityLevel(governor.getLevel());
+                    }
+                }
+            }
 
-        // Write to virtual camera
-        if (virtualCam.isReady()) {
-            virtualCam.writeFrame(frame);
+            // Write to virtual camera
+            writeOutput(frame, captureTime);
+            previewFrame = frame;
+        }
+        profiler.tick();
+        AllocationTracker::endFrame();
+        captureIndex++;
+        
+        // Calculate FPS (delivered frames when pipelined)
+        if (pipeline) {
+            uint64_t delivered = pipeline->getDeliveredFrames();
+            frameCount += static_cast<int>(delivered - lastDelivered);
+            lastDelivered = delivered;
+        }
+        if (!pipelined) {
+            frameCount++;
+        }
+        if (elapsed >= 1000) { // Update FPS every second
+            fps = frameCount * 1000.0f / elapsed;
+            frameCount = 0;
+            lastTime = currentTime;
+            metrics.setFps(fps);
         }
 
-        // Update GUI
+        // Update GUI. The display thread shows the frame at its own rate;
+        // nothing here waits on the window.
         if (showPreview) {
+            // Nothing delivered by the pipeline yet - still handle input
+            if (previewFrame.empty()) {
+                if (!gui.pollEvents()) {
+                    break;
+                }
+                continue;
+            }
+            
             // Update GUI state
-            gui.setFaceCount(faceSwapper->getFaceCount());
+            gui.setFaceCount(selector.get(selector.getActiveMode())->getFaceCount());
+            std::string modeName = FrameProcessor::modeName(selector.getActiveMode());
+            if (selector.getActiveMode() != selector.getRequestedMode()) {
+                modeName += " (auto)";
+            }
+            gui.setModeName(modeName);
             gui.setSourceFaceLoaded(faceSwapper->isSourceFaceLoaded());
+            if (!faceDirectory.empty()) {
+                gui.setSourceName(faceWatcher.getActiveName());
+            }
             gui.setVirtualCameraStatus(virtualCam.isReady(), virtualCam.getDevicePath());
-            
-            // Calculate FPS
-            frameCount++;
-            if (elapsed >= 1000) { // Update FPS every second
-                fps = frameCount * 1000.0f / elapsed;
-                frameCount = 0;
-                lastTime = currentTime;
+            if (governor.isEnabled()) {
+                std::lock_guard<std::mutex> lock(governorMutex);
+                gui.setQualityStatus(governor.describe());
             }
             gui.setFPS(fps);
             
             // Process frame and check for exit
-            if (!gui.processFrame(frame)) {
-                break;
+            bool keepRunning;
+            {
+                ScopedProfile profile(ProfileStage::Gui);
+                keepRunning = gui.processFrame(previewFrame);
             }
-        } else {
-            // No GUI mode - just check for exit key
-            char c = (char)cv::waitKey(10);
-            if (c == 27 || c == 'q' || c == 'Q') {
+            if (!keepRunning) {
                 break;
             }
         }
     }
+    if (g_stopRequested) {
+        std::cout << "\nStop requested, shutting down." << std::endl;
+    }
 
+    gui.shutdown();
+    control.stop();
+    sourceLoader.stop();
+    faceWatcher.stop();
+    if (pipeline) {
+        pipeline->stop();
+        pipeline->printSummary(std::cout);
+    }
+    if (pacer.isRunning()) {
+        pacer.stop();
+        pacer.printSummary(std::cout);
+    }
+    recorder.close();
+    TraceRecorder::instance().stop();
+    if (faceWorkers > 1) {
+        faceSwapper->getSwapper().printFaceScalingReport(std::cout);
+    }
+    metrics.stop();
+    if (!profilePath.empty()) {
+        profiler.close();
+        profiler.printSummary(std::cout);
+    }
+    if (AllocationTracker::isAvailable()) {
+        AllocationTracker::printSummary(std::cout);
+    }
+    
     cap.release();
     virtualCam.release();
+    Logger::instance().flush();
     std::cout << "\nExiting..." << std::endl;
     return 0;
 }
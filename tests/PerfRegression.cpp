@@ -0,0 +1,288 @@
+// Performance regression check for the face swap pipeline.
+//
+// Runs a fixed clip through the file input path, compares every Nth output
+// frame with a stored golden frame and compares per-stage latencies with a
+// per-machine baseline. Exits non-zero if any frame differs by more than the
+// tolerance or any stage is slower than baseline * (1 + margin) + slack.
+//
+// --update regenerates the golden frames and the baseline instead.
+
+#include "AdvancedFaceSwapper.hpp"
+#include "FrameSource.hpp"
+#include "Logger.hpp"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace {
+struct Options {
+    std::string clipPath;
+    std::string sourcePath;
+    std::string detectionModel = "assets/face_detection_yunet_2023mar.onnx";
+    std::string arcFaceModel;
+    std::string inSwapperModel;
+    std::string baselinePath;
+    std::string goldenDir;
+    double margin = 0.20;           // allowed slowdown as a fraction of the baseline
+    double slackMs = 0.5;           // absolute allowance for near-zero stages
+    double tolerance = 2.0;         // mean absolute pixel difference per channel
+    int goldenEvery = 15;
+    int warmup = 5;
+    int maxFrames = 0;              // 0 = whole clip
+    bool update = false;
+};
+
+// One timed quantity: samples after warm-up and their p50/p95
+struct Metric {
+    std::string name;
+    std::vector<double> samples;
+    double p50 = 0.0;
+    double p95 = 0.0;
+
+    void finish() {
+        if (samples.empty()) return;
+        std::sort(samples.begin(), samples.end());
+        p50 = samples[(samples.size() - 1) / 2];
+        p95 = samples[static_cast<size_t>(0.95 * (samples.size() - 1) + 0.5)];
+    }
+};
+
+std::string goldenPath(const std::string& dir, int frameIndex) {
+    char name[64];
+    std::snprintf(name, sizeof(name), "/frame_%05d.png", frameIndex);
+    return dir + name;
+}
+
+// Mean absolute difference per channel value
+double frameDifference(const cv::Mat& a, const cv::Mat& b) {
+    if (a.size() != b.size() || a.type() != b.type()) {
+        return 255.0;
+    }
+    return cv::norm(a, b, cv::NORM_L1) / (static_cast<double>(a.total()) * a.channels());
+}
+
+void printUsage(const char* programName) {
+    std::cout << "Usage: " << programName << " --clip <video> --source <image> --baseline <file.yml> --golden <dir> [options]" << std::endl;
+    std::cout << "\nOptions:" << std::endl;
+    std::cout << "  --detection-model <path>  YuNet model (default: assets/face_detection_yunet_2023mar.onnx)" << std::endl;
+    std::cout << "  --arcface <path>          ArcFace model (optional)" << std::endl;
+    std::cout << "  --inswapper <path>        INSwapper model (optional)" << std::endl;
+    std::cout << "  --margin <fraction>       Allowed slowdown vs. baseline (default: 0.20)" << std::endl;
+    std::cout << "  --slack-ms <ms>           Extra absolute allowance per stage (default: 0.5)" << std::endl;
+    std::cout << "  --tolerance <value>       Max mean abs pixel difference to golden frames (default: 2.0)" << std::endl;
+    std::cout << "  --golden-every <n>        Check every nth frame (default: 15)" << std::endl;
+    std::cout << "  --warmup <n>              Frames excluded from timing (default: 5)" << std::endl;
+    std::cout << "  --max-frames <n>          Stop after n frames (default: whole clip)" << std::endl;
+    std::cout << "  --update                  Regenerate golden frames and the baseline" << std::endl;
+}
+
+// Whole-string number of at least `minValue` for `option`
+template<typename T>
+bool parseNumber(const std::string& option, const std::string& text, T minValue, T& value) {
+    bool valid = false;
+    try {
+        size_t used = 0;
+        value = std::is_integral<T>::value ? static_cast<T>(std::stoi(text, &used))
+                                           : static_cast<T>(std::stod(text, &used));
+        valid = used == text.size() && value >= minValue;
+    } catch (const std::exception&) {
+        valid = false;
+    }
+    if (!valid) {
+        std::cerr << "Error: " << option << " needs a number of at least " << minValue << ": " << text << std::endl;
+    }
+    return valid;
+}
+
+bool parseArgs(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--clip" && i + 1 < argc) {
+            options.clipPath = argv[++i];
+        } else if (arg == "--source" && i + 1 < argc) {
+            options.sourcePath = argv[++i];
+        } else if (arg == "--detection-model" && i + 1 < argc) {
+            options.detectionModel = argv[++i];
+        } else if (arg == "--arcface" && i + 1 < argc) {
+            options.arcFaceModel = argv[++i];
+        } else if (arg == "--inswapper" && i + 1 < argc) {
+            options.inSwapperModel = argv[++i];
+        } else if (arg == "--baseline" && i + 1 < argc) {
+            options.baselinePath = argv[++i];
+        } else if (arg == "--golden" && i + 1 < argc) {
+            options.goldenDir = argv[++i];
+        } else if (arg == "--margin" && i + 1 < argc) {
+            if (!parseNumber(arg, argv[++i], 0.0, options.margin)) return false;
+        } else if (arg == "--slack-ms" && i + 1 < argc) {
+            if (!parseNumber(arg, argv[++i], 0.0, options.slackMs)) return false;
+        } else if (arg == "--tolerance" && i + 1 < argc) {
+            if (!parseNumber(arg, argv[++i], 0.0, options.tolerance)) return false;
+        } else if (arg == "--golden-every" && i + 1 < argc) {
+            if (!parseNumber(arg, argv[++i], 1, options.goldenEvery)) return false;
+        } else if (arg == "--warmup" && i + 1 < argc) {
+            if (!parseNumber(arg, argv[++i], 0, options.warmup)) return false;
+        } else if (arg == "--max-frames" && i + 1 < argc) {
+            if (!parseNumber(arg, argv[++i], 0, options.maxFrames)) return false;
+        } else if (arg == "--update") {
+            options.update = true;
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return false;
+        }
+    }
+    if (options.clipPath.empty() || options.sourcePath.empty() ||
+        options.baselinePath.empty() || options.goldenDir.empty()) {
+        std::cerr << "Error: --clip, --source, --baseline and --golden are required" << std::endl;
+        return false;
+    }
+    return true;
+}
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseArgs(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 2;
+    }
+    Logger::instance().setLevel(LogLevel::Error);
+
+    AdvancedFaceSwapper swapper;
+    if (!swapper.loadFaceDetectionModel(options.detectionModel)) {
+        return 2;
+    }
+    if (!options.arcFaceModel.empty()) {
+        swapper.loadArcFaceModel(options.arcFaceModel);
+    }
+    if (!options.inSwapperModel.empty()) {
+        swapper.loadInSwapperModel(options.inSwapperModel);
+    }
+    if (!swapper.loadSourceFace(options.sourcePath)) {
+        return 2;
+    }
+
+    FrameSource source;
+    if (!source.openFile(options.clipPath)) {
+        return 2;
+    }
+
+    std::vector<Metric> metrics;
+    for (const char* name : {"preprocess", "detect", "swap", "restore", "stabilize", "blend", "total"}) {
+        metrics.push_back(Metric());
+        metrics.back().name = name;
+    }
+
+    bool passed = true;
+    int frameIndex = 0;
+    int goldenChecked = 0;
+    cv::Mat frame;
+    auto runStart = std::chrono::steady_clock::now();
+
+    while (source.read(frame)) {
+        if (options.maxFrames > 0 && frameIndex >= options.maxFrames) {
+            break;
+        }
+        swapper.detectAndSwap(frame);
+
+        if (frameIndex >= options.warmup) {
+            const FrameTimings& t = swapper.getLastFrameTimings();
+            const double values[] = {t.preprocessMs, t.detectMs, t.swapMs, t.restoreMs, t.stabilizeMs, t.blendMs, t.totalMs};
+            for (size_t m = 0; m < metrics.size(); m++) {
+                metrics[m].samples.push_back(values[m]);
+            }
+        }
+
+        if (frameIndex % options.goldenEvery == 0) {
+            std::string path = goldenPath(options.goldenDir, frameIndex);
+            if (options.update) {
+                if (!cv::imwrite(path, frame)) {
+                    std::cerr << "Error: Could not write golden frame: " << path << std::endl;
+                    return 2;
+                }
+            } else {
+                cv::Mat golden = cv::imread(path, cv::IMREAD_COLOR);
+                if (golden.empty()) {
+                    std::cerr << "FAIL: missing golden frame " << path << std::endl;
+                    passed = false;
+                } else {
+                    double difference = frameDifference(frame, golden);
+                    if (difference > options.tolerance) {
+                        std::cerr << "FAIL: frame " << frameIndex << " differs from golden by " << difference
+                                  << " (tolerance " << options.tolerance << ")" << std::endl;
+                        passed = false;
+                    }
+                }
+            }
+            goldenChecked++;
+        }
+        frameIndex++;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+    if (frameIndex <= options.warmup) {
+        std::cerr << "Error: Clip has only " << frameIndex << " frames (warm-up is " << options.warmup << ")" << std::endl;
+        return 2;
+    }
+    for (Metric& metric : metrics) {
+        metric.finish();
+    }
+
+    std::cout << frameIndex << " frames in " << std::fixed << std::setprecision(2) << seconds << " s ("
+              << frameIndex / seconds << " FPS), " << goldenChecked << " golden frames "
+              << (options.update ? "written" : "checked") << std::endl;
+
+    if (options.update) {
+        cv::FileStorage fs(options.baselinePath, cv::FileStorage::WRITE);
+        if (!fs.isOpened()) {
+            std::cerr << "Error: Could not write baseline: " << options.baselinePath << std::endl;
+            return 2;
+        }
+        fs << "clip" << options.clipPath;
+        fs << "frames" << frameIndex;
+        fs << "stages" << "{";
+        for (const Metric& metric : metrics) {
+            fs << metric.name << "{" << "p50" << metric.p50 << "p95" << metric.p95 << "}";
+        }
+        fs << "}";
+        std::cout << "Baseline written: " << options.baselinePath << std::endl;
+        return 0;
+    }
+
+    cv::FileStorage fs(options.baselinePath, cv::FileStorage::READ);
+    if (!fs.isOpened()) {
+        std::cerr << "FAIL: no baseline at " << options.baselinePath
+                  << " - generate one for this machine with --update (or the perf_baseline target)" << std::endl;
+        return 1;
+    }
+
+    std::cout << "  stage        stat   baseline    current      limit" << std::endl;
+    cv::FileNode stages = fs["stages"];
+    for (const Metric& metric : metrics) {
+        cv::FileNode node = stages[metric.name];
+        if (node.empty()) {
+            std::cerr << "FAIL: baseline has no entry for " << metric.name << std::endl;
+            passed = false;
+            continue;
+        }
+        const std::pair<const char*, double> stats[] = {{"p50", metric.p50}, {"p95", metric.p95}};
+        for (const auto& stat : stats) {
+            double baseline = static_cast<double>(node[stat.first]);
+            double limit = baseline * (1.0 + options.margin) + options.slackMs;
+            bool ok = stat.second <= limit;
+            std::cout << "  " << std::left << std::setw(12) << metric.name << " " << std::setw(4) << stat.first
+                      << std::right << std::setprecision(3) << std::setw(11) << baseline
+                      << std::setw(11) << stat.second << std::setw(11) << limit
+                      << (ok ? "" : "  FAIL") << std::endl;
+            passed = passed && ok;
+        }
+    }
+
+    std::cout << (passed ? "PASS" : "FAIL") << std::endl;
+    return passed ? 0 : 1;
+}